@@ -0,0 +1,143 @@
+#!/bin/sh
+#
+# License: GNU GPL-3.0
+#
+# Time mdoc's count, list, details and sort on a synthetic documents tree,
+# with warm and cold caches, next to a find based baseline. Every result is
+# the best of the runs, in seconds and in scanned entries per second.
+#
+# The tree is shaped by these variables (see bench/gentree -h):
+#   BENCH_DEPTH, BENCH_FANOUT, BENCH_FILES, BENCH_NAMES (MIN-MAX),
+#   BENCH_DIST (uniform or normal), BENCH_MATCH (ratio), BENCH_SEED
+# and the runs by BENCH_RUNS and BENCH_DIR, where the tree is generated
+# (default: a temporary directory, removed at the end). An existing tree
+# in BENCH_DIR with the same shape is reused.
+#
+# The cold runs need to write to /proc/sys/vm/drop_caches, i.e. root,
+# otherwise they're skipped.
+
+set -eu
+
+MDOC=${MDOC:-./mdoc}
+GENTREE=${GENTREE:-./build/bench/gentree}
+
+DEPTH=${BENCH_DEPTH:-3}
+FANOUT=${BENCH_FANOUT:-8}
+FILES=${BENCH_FILES:-100000}
+NAMES=${BENCH_NAMES:-8-24}
+DIST=${BENCH_DIST:-uniform}
+MATCH=${BENCH_MATCH:-0.1}
+SEED=${BENCH_SEED:-1}
+RUNS=${BENCH_RUNS:-5}
+TOKEN=match
+
+
+if [ -n "${BENCH_DIR:-}" ]; then
+	WORKDIR=$BENCH_DIR
+	mkdir -p "$WORKDIR"
+else
+	WORKDIR=$(mktemp -d "${TMPDIR:-/tmp}/mdoc-bench.XXXXXX")
+	trap 'rm -rf "$WORKDIR"' EXIT
+fi
+
+TREE=$WORKDIR/tree
+SHAPE="-d $DEPTH -f $FANOUT -n $FILES -l $NAMES -D $DIST -m $MATCH -t $TOKEN -s $SEED"
+
+# The tree is reused only if it was generated with the same shape
+if [ ! -f "$WORKDIR/shape" ] || [ "$(cat "$WORKDIR/shape")" != "$SHAPE" ]; then
+	rm -rf "$TREE" "$WORKDIR/shape"
+	echo "Generating the tree ($SHAPE)..."
+	# shellcheck disable=SC2086
+	"$GENTREE" $SHAPE "$TREE" > "$WORKDIR/stats"
+	echo "$SHAPE" > "$WORKDIR/shape"
+fi
+read -r DIRS TREE_FILES MATCHES < "$WORKDIR/stats"
+ENTRIES=$((DIRS + TREE_FILES))
+
+# mdoc reads it's configurations from the home directory
+export HOME=$WORKDIR/home
+mkdir -p "$HOME/.config"
+printf '[root]\npath = %s\n\n[viewer]\nprogram = true\n' "$TREE" > "$HOME/.config/mdoc"
+
+
+now_ns()
+{
+	date +%s%N
+}
+
+
+can_drop_caches()
+{
+	[ -w /proc/sys/vm/drop_caches ]
+}
+
+
+drop_caches()
+{
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+}
+
+
+# Print the best time of the command in nanoseconds, dropping the caches
+# before every run if the mode is cold, otherwise warming them up first.
+best_time()
+{
+	mode=$1
+	shift
+	best=
+
+	[ "$mode" = warm ] && "$@" > /dev/null
+
+	i=0
+	while [ $i -lt "$RUNS" ]; do
+		[ "$mode" = cold ] && drop_caches
+		start=$(now_ns)
+		"$@" > /dev/null
+		elapsed=$(($(now_ns) - start))
+
+		if [ -z "$best" ] || [ $elapsed -lt "$best" ]; then
+			best=$elapsed
+		fi
+		i=$((i + 1))
+	done
+	echo "$best"
+}
+
+
+report()
+{
+	awk -v name="$1" -v mode="$2" -v ns="$3" -v entries="$ENTRIES" 'BEGIN {
+		printf "%-16s %-5s %10.4f s %14.0f entries/s\n",
+			   name, mode, ns / 1e9, entries / (ns / 1e9)
+	}'
+}
+
+
+bench_case()
+{
+	name=$1
+	shift
+
+	for mode in warm cold; do
+		if [ $mode = cold ] && ! can_drop_caches; then
+			continue
+		fi
+		report "$name" $mode "$(best_time $mode "$@")"
+	done
+}
+
+
+echo "Tree: $DIRS directories, $TREE_FILES files, $MATCHES matching '$TOKEN'"
+echo "Runs: best of $RUNS"
+can_drop_caches || echo "Cold runs: skipped, /proc/sys/vm/drop_caches isn't writable"
+echo
+
+bench_case "find"            find "$TREE" -type f -name "*$TOKEN*"
+bench_case "find (stat)"     find "$TREE" -type f -name "*$TOKEN*" -printf '%s %T@ %m %p\n'
+bench_case "mdoc count"      "$MDOC" -C -c "$TOKEN"
+bench_case "mdoc list"       "$MDOC" -C -l "$TOKEN"
+bench_case "mdoc details"    "$MDOC" -C -d "$TOKEN"
+bench_case "mdoc sort name"  "$MDOC" -C -l -s "$TOKEN"
+bench_case "mdoc sort size"  "$MDOC" -C -l --sort=-size "$TOKEN"
+bench_case "mdoc count all"  "$MDOC" -C -c -a
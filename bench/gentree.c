@@ -0,0 +1,344 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the generator of the synth- |
+| etic documents trees the benchmarks are run on. The   |
+| same options and seed always generate the same tree.  |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NAME_MAX_LEN 200
+#define SIZE_MAX_KB 4096
+/* The mtimes are spread over the year before this time */
+#define MTIME_BASE 1700000000
+#define MTIME_SPREAD (365 * 24 * 60 * 60)
+
+
+enum name_dist {
+	DIST_UNIFORM,
+	/* Most names are around the middle of the range */
+	DIST_NORMAL
+};
+
+struct tree_spec {
+	const char *root;
+	unsigned int depth;
+	unsigned int fanout;
+	unsigned long files;
+	unsigned int name_min;
+	unsigned int name_max;
+	enum name_dist dist;
+	double match_ratio;
+	const char *token;
+	const char *ext;
+	uint64_t seed;
+};
+
+struct tree_stats {
+	unsigned long dirs;
+	unsigned long files;
+	unsigned long matches;
+	/* The files every directory gets, and the first rem get one more */
+	unsigned long per_dir;
+	unsigned long rem;
+};
+
+
+/* Static Functions Prototype */
+static uint64_t next_rand(uint64_t *);
+static unsigned int rand_below(uint64_t *, unsigned int);
+static unsigned int rand_name_len(const struct tree_spec *, uint64_t *);
+static void rand_name(const struct tree_spec *, uint64_t *, char *, bool *);
+static int create_doc(const char *, uint64_t *);
+static int gen_dir(const struct tree_spec *, struct tree_stats *, uint64_t *,
+				   char *, size_t, unsigned int);
+static unsigned long count_dirs(unsigned int, unsigned int);
+static int parse_range(const char *, unsigned int *, unsigned int *);
+static void usage(const char *);
+
+
+static const char name_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_-";
+
+
+
+/*
+ * xorshift64*, so the tree doesn't depend on the libc's rand().
+ */
+static uint64_t next_rand(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+
+	return *state * 2685821657736338717ull;
+}
+
+
+static unsigned int rand_below(uint64_t *state, unsigned int n)
+{
+	return (unsigned int) (next_rand(state) >> 32) % n;
+}
+
+
+static unsigned int rand_name_len(const struct tree_spec *spec, uint64_t *state)
+{
+	const unsigned int range = spec->name_max - spec->name_min + 1;
+
+	if (spec->dist == DIST_NORMAL)
+		/* The sum of 3 uniform values is close enough to a normal one */
+		return spec->name_min + (rand_below(state, range) +
+								 rand_below(state, range) +
+								 rand_below(state, range)) / 3;
+
+	return spec->name_min + rand_below(state, range);
+}
+
+
+/*
+ * Write a random name with the extension to name, containing the
+ * token in match_ratio of the times. Set matched accordingly.
+ */
+static void rand_name(const struct tree_spec *spec, uint64_t *state,
+					  char *name, bool *matched)
+{
+	const size_t token_len = strlen(spec->token);
+	unsigned int len = rand_name_len(spec, state);
+	unsigned int pos;
+	unsigned int i;
+
+	for (i=0; i<len; i++)
+		name[i] = name_chars[rand_below(state, sizeof(name_chars) - 1)];
+
+	*matched = (next_rand(state) >> 11) * (1.0 / 9007199254740992.0) < spec->match_ratio;
+
+	if (*matched) {
+		if (len < token_len)
+			len = token_len;
+		pos = rand_below(state, len - token_len + 1);
+		memcpy(name + pos, spec->token, token_len);
+	} else {
+		/* A random name might contain the token by chance */
+		for (i=0; i+token_len<=len; i++)
+			if (memcmp(name + i, spec->token, token_len) == 0)
+				name[i] = '.';
+	}
+	sprintf(name + len, ".%s", spec->ext);
+}
+
+
+/*
+ * Create an empty document with a random size and mtime,
+ * so the sorting by them has something to sort.
+ */
+static int create_doc(const char *path, uint64_t *state)
+{
+	struct timespec times[2];
+	int fd;
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		fprintf(stderr, "gentree: can't create '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+	/* Sparse, so it takes no space */
+	if (ftruncate(fd, (off_t) rand_below(state, SIZE_MAX_KB) * 1024)) {
+		fprintf(stderr, "gentree: can't resize '%s': %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	times[0].tv_sec = times[1].tv_sec = MTIME_BASE - rand_below(state, MTIME_SPREAD);
+	times[0].tv_nsec = times[1].tv_nsec = 0;
+	futimens(fd, times);
+
+	return close(fd);
+}
+
+
+/*
+ * Fill the directory in path, which has room for PATH_MAX bytes, with
+ * it's documents and then it's sub directories, depth levels deep.
+ */
+static int gen_dir(const struct tree_spec *spec, struct tree_stats *stats,
+				   uint64_t *state, char *path, size_t len, unsigned int depth)
+{
+	unsigned long files = stats->per_dir + (stats->dirs < stats->rem);
+	char name[NAME_MAX_LEN + 16];
+	unsigned long i;
+	bool matched;
+
+	if (mkdir(path, 0755) && errno != EEXIST) {
+		fprintf(stderr, "gentree: can't create '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+	stats->dirs++;
+
+	for (i=0; i<files; i++) {
+		rand_name(spec, state, name, &matched);
+		/* Make the name unique in it's directory */
+		snprintf(path + len, PATH_MAX - len, "/%lu%s", i, name);
+
+		if (create_doc(path, state))
+			return -1;
+
+		stats->files++;
+		stats->matches += matched;
+	}
+	for (i=0; depth && i<spec->fanout; i++) {
+		snprintf(path + len, PATH_MAX - len, "/dir%lu", i);
+
+		if (gen_dir(spec, stats, state, path, strlen(path), depth - 1))
+			return -1;
+	}
+	path[len] = '\0';
+
+	return 0;
+}
+
+
+/*
+ * Return the number of directories in a tree of the given depth
+ * and fanout, the root included.
+ */
+static unsigned long count_dirs(unsigned int depth, unsigned int fanout)
+{
+	unsigned long level = 1;
+	unsigned long dirs = 1;
+	unsigned int i;
+
+	for (i=0; i<depth; i++)
+		dirs += (level *= fanout);
+
+	return dirs;
+}
+
+
+static int parse_range(const char *arg, unsigned int *min, unsigned int *max)
+{
+	char *end;
+
+	*min = strtoul(arg, &end, 10);
+	*max = (*end == '-') ? strtoul(end + 1, &end, 10) : *min;
+
+	return (*end != '\0' || !*min || *min > *max || *max > NAME_MAX_LEN) ? -1 : 0;
+}
+
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [OPTIONS]... ROOT\n"
+			"Generate a reproducible synthetic documents tree in ROOT and print\n"
+			"it's directories, files and matching files numbers.\n"
+			"\n"
+			" -d N \t The depth of the sub directories (default: 3)\n"
+			" -f N \t The sub directories of every directory (default: 4)\n"
+			" -n N \t The number of files, spread evenly (default: 10000)\n"
+			" -l MIN-MAX \t The names lengths without the extension (default: 8-24)\n"
+			" -D DIST \t The names lengths distribution, uniform or normal (default: uniform)\n"
+			" -m RATIO \t The ratio of the names containing the token (default: 0.1)\n"
+			" -t TOKEN \t The token of the matching names (default: match)\n"
+			" -e EXT \t The files extension (default: pdf)\n"
+			" -s SEED \t The random seed (default: 1)\n", name);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct tree_spec spec = {
+		.depth = 3,
+		.fanout = 4,
+		.files = 10000,
+		.name_min = 8,
+		.name_max = 24,
+		.dist = DIST_UNIFORM,
+		.match_ratio = 0.1,
+		.token = "match",
+		.ext = "pdf",
+		.seed = 1
+	};
+	struct tree_stats stats = {0};
+	char path[PATH_MAX];
+	uint64_t state;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:f:n:l:D:m:t:e:s:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			spec.depth = strtoul(optarg, NULL, 10);
+			break;
+		case 'f':
+			spec.fanout = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			spec.files = strtoul(optarg, NULL, 10);
+			break;
+		case 'l':
+			if (parse_range(optarg, &spec.name_min, &spec.name_max)) {
+				fprintf(stderr, "gentree: invalid names lengths '%s'\n", optarg);
+				return 1;
+			}
+			break;
+		case 'D':
+			if (strcmp(optarg, "uniform") == 0) {
+				spec.dist = DIST_UNIFORM;
+			} else if (strcmp(optarg, "normal") == 0) {
+				spec.dist = DIST_NORMAL;
+			} else {
+				fprintf(stderr, "gentree: unknown distribution '%s'\n", optarg);
+				return 1;
+			}
+			break;
+		case 'm':
+			spec.match_ratio = strtod(optarg, NULL);
+			break;
+		case 't':
+			spec.token = optarg;
+			break;
+		case 'e':
+			spec.ext = optarg;
+			break;
+		case 's':
+			spec.seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (optind != argc - 1 || !*spec.token || strlen(spec.token) > NAME_MAX_LEN ||
+		strlen(spec.ext) > 8) {
+		usage(argv[0]);
+		return 1;
+	}
+	spec.root = argv[optind];
+
+	/* xorshift's state must never be 0 */
+	state = spec.seed * 0x9E3779B97F4A7C15ull | 1;
+
+	stats.per_dir = spec.files / count_dirs(spec.depth, spec.fanout);
+	stats.rem = spec.files % count_dirs(spec.depth, spec.fanout);
+
+	if (strlen(spec.root) >= PATH_MAX - NAME_MAX_LEN * 2) {
+		fprintf(stderr, "gentree: the root's path is too long\n");
+		return 1;
+	}
+	strcpy(path, spec.root);
+
+	if (gen_dir(&spec, &stats, &state, path, strlen(path), spec.depth))
+		return 1;
+
+	printf("%lu %lu %lu\n", stats.dirs, stats.files, stats.matches);
+
+	return 0;
+}
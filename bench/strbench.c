@@ -0,0 +1,651 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the microbenchmark of the   |
+| strman string kernels. Every implementation of a      |
+| kernel is run over the same names corpora, timed in   |
+| cycles after a warmup, and it's results are checked   |
+| against the reference implementation's.               |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "strman.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define ITEMS_DEFAULT 4096
+#define REPS_DEFAULT 50
+#define WARMUP_REPS 3
+/* Longer than any generated name */
+#define SCRATCH_SIZE 1024
+
+
+/* The shape of a corpus' names */
+enum name_len {
+	NAMES_SHORT,
+	NAMES_LONG
+};
+
+enum name_charset {
+	NAMES_ASCII,
+	NAMES_UTF8
+};
+
+struct corpus {
+	/* The shape of the names, and with the needles' hit or miss */
+	char shape[24];
+	char name[32];
+	/* The names and the needles searched in them, item by item */
+	char **names;
+	char **needles;
+	size_t items;
+	/* The bytes every pass over the corpus reads */
+	size_t bytes;
+	/* If the needles are found in their names */
+	bool hit;
+};
+
+/*
+ * A kernel's implementation, run on the i'th item of the corpus.
+ * scratch has room for SCRATCH_SIZE bytes, for the kernels that
+ * modify their string. The returned value is compared against the
+ * reference's, so it must cover everything the kernel computes.
+ */
+typedef uint64_t (*kernel_fn)(const struct corpus *, size_t, char *);
+
+struct kernel_impl {
+	const char *kernel;
+	const char *impl;
+	kernel_fn fn;
+	/* If it searches the needles, so it's run on the miss corpora too */
+	bool needles;
+};
+
+
+/* Static Functions Prototype */
+static uint64_t next_rand(uint64_t *);
+static uint64_t hash_bytes(const char *, size_t);
+static uint64_t run_strstr_i(const struct corpus *, size_t, char *);
+static bool strstr_i_no_copy(const char *, const char *);
+static uint64_t run_strstr_i_no_copy(const struct corpus *, size_t, char *);
+static uint64_t run_alpha_cmp(const struct corpus *, size_t, char *);
+static uint64_t run_convert_to_lower(const struct corpus *, size_t, char *);
+static void convert_to_lower_table(char *);
+static uint64_t run_convert_to_lower_table(const struct corpus *, size_t, char *);
+static uint64_t run_count_words(const struct corpus *, size_t, char *);
+static uint64_t run_space_to_null(const struct corpus *, size_t, char *);
+static uint64_t run_copy_only(const struct corpus *, size_t, char *);
+static char *gen_name(uint64_t *, enum name_len, enum name_charset);
+static char *gen_needle(uint64_t *, const char *, bool);
+static int gen_corpus(struct corpus *, size_t, uint64_t, enum name_len,
+					  enum name_charset, bool);
+static void free_corpus(struct corpus *);
+static uint64_t read_cycles(void);
+static double get_ns_per_cycle(void);
+static uint64_t time_pass(const struct kernel_impl *, const struct corpus *, char *);
+static const struct kernel_impl *get_reference(const struct kernel_impl *);
+static int check_impl(const struct kernel_impl *, const struct corpus *, char *);
+static void bench_impl(const struct kernel_impl *, const struct corpus *,
+					   unsigned int, double, char *);
+static void usage(const char *);
+
+
+static const char *const ascii_words[] = {
+	"linear", "algebra", "done", "right", "notes", "lecture", "chapter",
+	"Calculus", "Physics", "paper", "draft", "final", "v2", "2023", "thesis",
+	"Intro", "to", "Algorithms", "CLRS", "homework", "solutions", "manual"
+};
+
+static const char *const utf8_words[] = {
+	"café", "naïve", "Übung", "Straße", "задача", "лекция", "論文", "講義",
+	"résumé", "Ärzte", "ηλεκτρονική", "notes", "chapter", "2023", "draft"
+};
+
+static const char separators[] = " _-.";
+
+/*
+ * The kernels' implementations, the first one of every kernel is the
+ * reference the others are checked against. A new implementation, e.g.
+ * a SIMD one, is added with a run_ function and a line here.
+ */
+static const struct kernel_impl impls[] = {
+	{"strstr_i", "reference", run_strstr_i, 1},
+	{"strstr_i", "no-copy", run_strstr_i_no_copy, 1},
+	{"alpha_cmp", "reference", run_alpha_cmp, 0},
+	{"convert_to_lower", "reference", run_convert_to_lower, 0},
+	{"convert_to_lower", "table", run_convert_to_lower_table, 0},
+	{"count_words", "reference", run_count_words, 0},
+	{"space_to_null", "reference", run_space_to_null, 0},
+	/* The copy the modifying kernels do first, to tell it's share */
+	{"copy", "memcpy", run_copy_only, 0}
+};
+
+#define IMPLS_NUM (sizeof(impls) / sizeof(impls[0]))
+
+
+
+/*
+ * xorshift64*, so the corpora don't depend on the libc's rand().
+ */
+static uint64_t next_rand(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+
+	return *state * 2685821657736338717ull;
+}
+
+
+/*
+ * FNV-1a, to compare the strings the modifying kernels leave.
+ */
+static uint64_t hash_bytes(const char *str, size_t len)
+{
+	uint64_t hash = 14695981039346656037ull;
+	size_t i;
+
+	for (i=0; i<len; i++) {
+		hash ^= (unsigned char) str[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+
+static uint64_t run_strstr_i(const struct corpus *corpus, size_t i, char *scratch)
+{
+	(void) scratch;
+
+	return strstr_i(corpus->names[i], corpus->needles[i]);
+}
+
+
+/*
+ * The same as strstr_i() without copying and lowering both strings first.
+ */
+static bool strstr_i_no_copy(const char *haystack, const char *needle)
+{
+	const unsigned char *h = (const unsigned char *) haystack;
+	const unsigned char *n = (const unsigned char *) needle;
+	const int first = tolower(*n);
+	size_t j;
+
+	if (!*n)
+		return 1;
+
+	for (; *h; h++) {
+		if (tolower(*h) != first)
+			continue;
+
+		for (j=1; n[j] && tolower(h[j]) == tolower(n[j]); j++)
+			;
+		if (!n[j])
+			return 1;
+	}
+
+	return 0;
+}
+
+
+static uint64_t run_strstr_i_no_copy(const struct corpus *corpus, size_t i,
+									 char *scratch)
+{
+	(void) scratch;
+
+	return strstr_i_no_copy(corpus->names[i], corpus->needles[i]);
+}
+
+
+/*
+ * Compare every name to the next one, so equal prefixes are common.
+ */
+static uint64_t run_alpha_cmp(const struct corpus *corpus, size_t i, char *scratch)
+{
+	(void) scratch;
+
+	return alpha_cmp(corpus->names[i], corpus->names[(i + 1) % corpus->items]);
+}
+
+
+static uint64_t run_convert_to_lower(const struct corpus *corpus, size_t i,
+									 char *scratch)
+{
+	const size_t len = strlen(corpus->names[i]);
+
+	memcpy(scratch, corpus->names[i], len + 1);
+	convert_to_lower(scratch);
+
+	return hash_bytes(scratch, len);
+}
+
+
+/*
+ * convert_to_lower() with a lookup table instead of isupper() and tolower().
+ */
+static void convert_to_lower_table(char *str)
+{
+	static unsigned char table[256];
+	static bool table_ready;
+	unsigned int c;
+
+	if (!table_ready) {
+		for (c=0; c<256; c++)
+			table[c] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+		table_ready = 1;
+	}
+	for (; *str; str++)
+		*str = table[(unsigned char) *str];
+}
+
+
+static uint64_t run_convert_to_lower_table(const struct corpus *corpus, size_t i,
+										   char *scratch)
+{
+	const size_t len = strlen(corpus->names[i]);
+
+	memcpy(scratch, corpus->names[i], len + 1);
+	convert_to_lower_table(scratch);
+
+	return hash_bytes(scratch, len);
+}
+
+
+static uint64_t run_count_words(const struct corpus *corpus, size_t i, char *scratch)
+{
+	(void) scratch;
+
+	return count_words(corpus->names[i]);
+}
+
+
+/*
+ * Split the whole name, like build_viewer() splits the viewer's arguments.
+ */
+static uint64_t run_space_to_null(const struct corpus *corpus, size_t i,
+								  char *scratch)
+{
+	const size_t len = strlen(corpus->names[i]);
+	uint64_t words = 0;
+	unsigned int ret;
+	char *str;
+
+	memcpy(scratch, corpus->names[i], len + 1);
+
+	for (str=scratch; (ret = space_to_null(str)); str+=ret)
+		words = words * 31 + ret;
+
+	return words;
+}
+
+
+static uint64_t run_copy_only(const struct corpus *corpus, size_t i, char *scratch)
+{
+	const size_t len = strlen(corpus->names[i]);
+
+	memcpy(scratch, corpus->names[i], len + 1);
+
+	return len;
+}
+
+
+/*
+ * A document's name of words and separators, e.g. "Linear_algebra-notes v2".
+ */
+static char *gen_name(uint64_t *state, enum name_len len, enum name_charset charset)
+{
+	const char *const *words = (charset == NAMES_UTF8) ? utf8_words : ascii_words;
+	const size_t words_num = (charset == NAMES_UTF8) ?
+		sizeof(utf8_words) / sizeof(utf8_words[0]) :
+		sizeof(ascii_words) / sizeof(ascii_words[0]);
+	const unsigned int words_wanted = (len == NAMES_SHORT) ?
+		1 + next_rand(state) % 2 : 8 + next_rand(state) % 12;
+	char name[SCRATCH_SIZE];
+	size_t name_len = 0;
+	const char *word;
+	unsigned int i;
+
+	for (i=0; i<words_wanted; i++) {
+		word = words[next_rand(state) % words_num];
+
+		if (name_len + strlen(word) + 2 >= SCRATCH_SIZE / 2)
+			break;
+		if (i)
+			name[name_len++] = separators[next_rand(state) % (sizeof(separators) - 1)];
+
+		memcpy(name + name_len, word, strlen(word));
+		name_len += strlen(word);
+	}
+	memcpy(name + name_len, ".pdf", sizeof(".pdf"));
+
+	return strcpy_dynamic(name);
+}
+
+
+/*
+ * A needle that's found in the name, a piece of it with it's case
+ * flipped, or one that isn't found in it.
+ */
+static char *gen_needle(uint64_t *state, const char *name, bool hit)
+{
+	const size_t name_len = strlen(name);
+	char needle[SCRATCH_SIZE];
+	size_t begin;
+	size_t len;
+	size_t i;
+
+	if (!hit) {
+		/* None of the words has a 'q' */
+		len = 3 + next_rand(state) % 4;
+
+		for (i=0; i<len; i++)
+			needle[i] = (i == len / 2) ? 'q' : 'a' + next_rand(state) % 26;
+		needle[len] = '\0';
+
+		return strcpy_dynamic(needle);
+	}
+	len = 3 + next_rand(state) % 6;
+	if (len > name_len)
+		len = name_len;
+	begin = next_rand(state) % (name_len - len + 1);
+
+	for (i=0; i<len; i++) {
+		needle[i] = name[begin+i];
+
+		if (next_rand(state) & 1)
+			needle[i] = isupper((unsigned char) needle[i]) ?
+				tolower((unsigned char) needle[i]) : toupper((unsigned char) needle[i]);
+	}
+	needle[len] = '\0';
+
+	return strcpy_dynamic(needle);
+}
+
+
+static int gen_corpus(struct corpus *corpus, size_t items, uint64_t seed,
+					  enum name_len len, enum name_charset charset, bool hit)
+{
+	uint64_t state = seed * 0x9E3779B97F4A7C15ull | 1;
+	size_t i;
+
+	snprintf(corpus->shape, sizeof(corpus->shape), "%s-%s",
+			 len == NAMES_SHORT ? "short" : "long",
+			 charset == NAMES_ASCII ? "ascii" : "utf8");
+	snprintf(corpus->name, sizeof(corpus->name), "%s-%s-%s",
+			 len == NAMES_SHORT ? "short" : "long",
+			 charset == NAMES_ASCII ? "ascii" : "utf8", hit ? "hit" : "miss");
+	corpus->items = items;
+	corpus->bytes = 0;
+	corpus->hit = hit;
+
+	if (!(corpus->names = calloc(items, sizeof(char *))) ||
+		!(corpus->needles = calloc(items, sizeof(char *))))
+		return -1;
+
+	for (i=0; i<items; i++) {
+		if (!(corpus->names[i] = gen_name(&state, len, charset)) ||
+			!(corpus->needles[i] = gen_needle(&state, corpus->names[i], hit)))
+			return -1;
+
+		corpus->bytes += strlen(corpus->names[i]);
+	}
+
+	return 0;
+}
+
+
+static void free_corpus(struct corpus *corpus)
+{
+	size_t i;
+
+	for (i=0; corpus->names && i<corpus->items; i++) {
+		free(corpus->names[i]);
+		if (corpus->needles)
+			free(corpus->needles[i]);
+	}
+	free(corpus->names);
+	free(corpus->needles);
+}
+
+
+/*
+ * The time stamp counter where there's one, otherwise nanoseconds.
+ */
+static uint64_t read_cycles(void)
+{
+#if HAVE_TSC
+	/* Don't let the timed code move across the reading */
+	_mm_lfence();
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+
+/*
+ * Measure the cycles' length against the monotonic clock.
+ */
+static double get_ns_per_cycle(void)
+{
+#if HAVE_TSC
+	const struct timespec delay = {.tv_sec = 0, .tv_nsec = 100000000};
+	struct timespec begin, end;
+	uint64_t cycles;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	cycles = read_cycles();
+	nanosleep(&delay, NULL);
+	cycles = read_cycles() - cycles;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / cycles;
+#else
+	return 1.0;
+#endif
+}
+
+
+/* Keeps the results alive, so the calls aren't optimized out */
+static volatile uint64_t results_sink;
+
+
+static uint64_t time_pass(const struct kernel_impl *impl,
+						  const struct corpus *corpus, char *scratch)
+{
+	uint64_t results = 0;
+	uint64_t begin;
+	uint64_t cycles;
+	size_t i;
+
+	begin = read_cycles();
+
+	for (i=0; i<corpus->items; i++)
+		results += impl->fn(corpus, i, scratch);
+
+	cycles = read_cycles() - begin;
+	results_sink = results;
+
+	return cycles;
+}
+
+
+static const struct kernel_impl *get_reference(const struct kernel_impl *impl)
+{
+	unsigned int i;
+
+	for (i=0; strcmp(impls[i].kernel, impl->kernel) != 0; i++)
+		;
+
+	return &impls[i];
+}
+
+
+/*
+ * Return -1 if the implementation's result differs from the
+ * reference's on any of the corpus' items, otherwise 0.
+ */
+static int check_impl(const struct kernel_impl *impl, const struct corpus *corpus,
+					  char *scratch)
+{
+	const struct kernel_impl *reference = get_reference(impl);
+	uint64_t expected;
+	size_t i;
+
+	if (reference == impl)
+		return 0;
+
+	for (i=0; i<corpus->items; i++) {
+		expected = reference->fn(corpus, i, scratch);
+
+		if (impl->fn(corpus, i, scratch) != expected) {
+			fprintf(stderr, "strbench: %s/%s differs from the reference on %s "
+					"item %zu: '%s' '%s'\n", impl->kernel, impl->impl,
+					corpus->name, i, corpus->names[i], corpus->needles[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Print the best of reps passes over the corpus, after the warmup.
+ */
+static void bench_impl(const struct kernel_impl *impl, const struct corpus *corpus,
+					   unsigned int reps, double ns_per_cycle, char *scratch)
+{
+	uint64_t best = UINT64_MAX;
+	uint64_t cycles;
+	unsigned int i;
+
+	for (i=0; i<WARMUP_REPS; i++)
+		time_pass(impl, corpus, scratch);
+
+	for (i=0; i<reps; i++)
+		if ((cycles = time_pass(impl, corpus, scratch)) < best)
+			best = cycles;
+
+	if (!best)
+		best = 1;
+
+	printf("%-18s %-10s %-16s %10.2f %10.3f\n", impl->kernel, impl->impl,
+		   impl->needles ? corpus->name : corpus->shape, best * ns_per_cycle / corpus->items,
+		   (double) corpus->bytes / best);
+}
+
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [OPTIONS]...\n"
+			"Time the strman kernels over names corpora and check every\n"
+			"implementation against the reference one.\n"
+			"\n"
+			" -n N \t The names in every corpus (default: %d)\n"
+			" -r N \t The timed passes over every corpus, the best is kept (default: %d)\n"
+			" -k KERNEL \t Run only the implementations of KERNEL\n"
+			" -s SEED \t The random seed of the corpora (default: 1)\n",
+			name, ITEMS_DEFAULT, REPS_DEFAULT);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct corpus corpora[8] = {0};
+	const char *only_kernel = NULL;
+	size_t items = ITEMS_DEFAULT;
+	unsigned int reps = REPS_DEFAULT;
+	unsigned int corpora_num = 0;
+	char scratch[SCRATCH_SIZE];
+	double ns_per_cycle;
+	uint64_t seed = 1;
+	int retval = 0;
+	unsigned int i, j;
+	int len, charset, hit;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:k:s:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			items = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			reps = strtoul(optarg, NULL, 10);
+			break;
+		case 'k':
+			only_kernel = optarg;
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (!items || !reps) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (len=NAMES_SHORT; len<=NAMES_LONG; len++)
+		for (charset=NAMES_ASCII; charset<=NAMES_UTF8; charset++)
+			for (hit=1; hit>=0; hit--)
+				/* Every corpus has a seed of it's own */
+				if (gen_corpus(&corpora[corpora_num], items, seed + corpora_num,
+							   len, charset, hit)) {
+					fprintf(stderr, "strbench: can't allocate the corpora\n");
+					corpora_num++;
+					retval = 1;
+					goto out;
+				} else {
+					corpora_num++;
+				}
+
+	ns_per_cycle = get_ns_per_cycle();
+
+	printf("%-18s %-10s %-16s %10s %10s\n", "kernel", "impl", "corpus", "ns/call",
+		   HAVE_TSC ? "bytes/cyc" : "bytes/ns");
+
+	for (i=0; i<IMPLS_NUM; i++) {
+		if (only_kernel && strcmp(impls[i].kernel, only_kernel) != 0)
+			continue;
+
+		for (j=0; j<corpora_num; j++) {
+			/* Only the needles' search tells a hit from a miss */
+			if (!impls[i].needles && !corpora[j].hit)
+				continue;
+
+			if (check_impl(&impls[i], &corpora[j], scratch)) {
+				retval = 1;
+				continue;
+			}
+			bench_impl(&impls[i], &corpora[j], reps, ns_per_cycle, scratch);
+		}
+	}
+
+out:
+	for (i=0; i<corpora_num; i++)
+		free_corpus(&corpora[i]);
+
+	return retval;
+}
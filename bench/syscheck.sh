@@ -0,0 +1,213 @@
+#!/bin/sh
+#
+# License: GNU GPL-3.0
+#
+# Check that mdoc's calls to the functions its performance depends on stay
+# within their bounds on a synthetic documents tree, e.g. that counting the
+# documents stats none of them. The calls are counted by the bench/syscount.so
+# interposer, so a change that regresses them fails here instead of only
+# showing up as a slower benchmark.
+#
+# The tree is shaped by CHECK_DEPTH, CHECK_FANOUT, CHECK_FILES, CHECK_MATCH
+# (ratio) and CHECK_SEED, see bench/gentree -h. It's generated in a temporary
+# directory, removed at the end.
+
+set -eu
+
+MDOC=${MDOC:-./mdoc}
+GENTREE=${GENTREE:-./build/bench/gentree}
+SYSCOUNT=${SYSCOUNT:-./build/bench/syscount.so}
+
+DEPTH=${CHECK_DEPTH:-3}
+FANOUT=${CHECK_FANOUT:-4}
+FILES=${CHECK_FILES:-20000}
+MATCH=${CHECK_MATCH:-0.01}
+SEED=${CHECK_SEED:-1}
+TOKEN=match
+
+# The size of mdoc's output buffer, see src/output.c
+OUT_BUF=65536
+# The smallest arguments limit mdoc assumes for --batch, see src/mdoc.c
+ARGS_MIN=131072
+
+
+# LD_PRELOAD needs an absolute path when mdoc isn't run from here
+SYSCOUNT=$(cd "$(dirname "$SYSCOUNT")" && pwd)/$(basename "$SYSCOUNT")
+
+WORKDIR=$(mktemp -d "${TMPDIR:-/tmp}/mdoc-check.XXXXXX")
+trap 'rm -rf "$WORKDIR"' EXIT
+
+TREE=$WORKDIR/tree
+COUNTS=$WORKDIR/counts
+OUT=$WORKDIR/out
+
+"$GENTREE" -d "$DEPTH" -f "$FANOUT" -n "$FILES" -m "$MATCH" -t "$TOKEN" \
+	-s "$SEED" "$TREE" > "$WORKDIR/stats"
+read -r DIRS TREE_FILES MATCHES < "$WORKDIR/stats"
+
+# mdoc reads it's configurations from the home directory
+export HOME=$WORKDIR/home
+mkdir -p "$HOME/.config"
+printf '[root]\npath = %s\n\n[viewer]\nprogram = true\n' "$TREE" > "$HOME/.config/mdoc"
+
+FAILED=0
+
+
+# Run mdoc with the interposer, it's output is kept in $OUT
+run_counted()
+{
+	if ! SYSCOUNT_OUT=$COUNTS LD_PRELOAD=$SYSCOUNT "$MDOC" -C "$@" > "$OUT"; then
+		echo "FAIL mdoc -C $* exited with an error"
+		exit 1
+	fi
+}
+
+
+# Print the sum of the named counters of the last run
+count()
+{
+	awk -v names=" $* " 'index(names, " " $1 " ") { sum += $2 } END { print sum + 0 }' "$COUNTS"
+}
+
+
+# Check that the sum of the counters, in quotes, is at most bound
+check()
+{
+	desc=$1
+	counters=$2
+	bound=$3
+	# shellcheck disable=SC2086
+	actual=$(count $counters)
+
+	if [ "$actual" -le "$bound" ]; then
+		printf 'ok   %-22s %-16s %8d <= %d\n' "$desc" "$counters" "$actual" "$bound"
+	else
+		printf 'FAIL %-22s %-16s %8d >  %d\n' "$desc" "$counters" "$actual" "$bound"
+		FAILED=$((FAILED + 1))
+	fi
+}
+
+
+# Check that the last run's output is the same as the expected file's
+check_output()
+{
+	if cmp -s "$2" "$OUT"; then
+		printf 'ok   %-22s %-16s\n' "$1" "output"
+	else
+		printf 'FAIL %-22s %-16s differs from %s\n' "$1" "output" "$(basename "$2")"
+		FAILED=$((FAILED + 1))
+	fi
+}
+
+
+# Every directory is opened once and read to it's end: it's entries,
+# "." and ".." and the end of the stream
+check_scan()
+{
+	check "$1" opendir "$DIRS"
+	check "$1" readdir $((TREE_FILES + DIRS * 4))
+}
+
+
+echo "Tree: $DIRS directories, $TREE_FILES files, $MATCHES matching '$TOKEN'"
+echo
+
+# The configurations file is the only thing stat'ed without -d or a
+# metadata sort key, the documents' types come from readdir()
+run_counted -c "$TOKEN"
+check_scan "count"
+check "count" "stat fstatat" 1
+check "count" write 1
+
+run_counted -c -a
+check_scan "count all"
+check "count all" "stat fstatat" 1
+
+run_counted -l "$TOKEN"
+check_scan "list"
+check "list" "stat fstatat" 1
+check "list" write $(($(wc -c < "$OUT") / OUT_BUF + 1))
+
+run_counted -l -s "$TOKEN"
+check "list sorted by name" "stat fstatat" 1
+
+# Only the found documents are stat'ed, once each
+run_counted -d "$TOKEN"
+check_scan "details"
+check "details" "stat fstatat" $((MATCHES + 1))
+check "details" write $(($(wc -c < "$OUT") / OUT_BUF + 1))
+
+run_counted -l --sort=-size "$TOKEN"
+check "list sorted by size" "stat fstatat" $((MATCHES + 1))
+
+run_counted -l --sort=-size --limit=10 "$TOKEN"
+check "top 10 by size" "stat fstatat" $((MATCHES + 1))
+
+run_counted -d --mem-limit=16M "$TOKEN"
+check "details streamed" "stat fstatat" $((MATCHES + 1))
+
+# Several patterns are searched for in a single scan, each counted just
+# like on it's own
+run_counted -c "$TOKEN" ab x9
+check_scan "count patterns"
+check "count patterns" "stat fstatat" 1
+: > "$WORKDIR/patterns"
+for pattern in "$TOKEN" ab x9; do
+	run_counted -c "$pattern"
+	{ echo "[PATTERN] $pattern"; cat "$OUT"; } >> "$WORKDIR/patterns"
+done
+run_counted -c "$TOKEN" ab x9
+check_output "count patterns" "$WORKDIR/patterns"
+
+run_counted -l "$TOKEN" ab x9
+check_scan "list patterns"
+: > "$WORKDIR/patterns"
+for pattern in "$TOKEN" ab x9; do
+	run_counted -l "$pattern"
+	{ echo "[PATTERN] $pattern"; cat "$OUT"; } >> "$WORKDIR/patterns"
+done
+run_counted -l "$TOKEN" ab x9
+check_output "list patterns" "$WORKDIR/patterns"
+
+# A cached query only stats the directories it read, until one of them
+# changes. The directories changed within a second of a search aren't
+# cached, so the tree's are moved to the past.
+CACHE=$WORKDIR/cache
+find "$TREE" -type d -exec touch -t 202001010000 {} +
+
+run_counted -c "$TOKEN" --cache="$CACHE"
+cp "$OUT" "$WORKDIR/cached"
+run_counted -c "$TOKEN" --cache="$CACHE"
+check "cached count" opendir 0
+check "cached count" "stat fstatat" $((DIRS + 1))
+check_output "cached count" "$WORKDIR/cached"
+
+SUB=$(find "$TREE" -mindepth 2 -type d | head -n 1)
+: > "$SUB/new-$TOKEN"
+run_counted -c "$TOKEN"
+cp "$OUT" "$WORKDIR/changed"
+run_counted -c "$TOKEN" --cache="$CACHE"
+check_scan "changed cached count"
+check_output "changed cached count" "$WORKDIR/changed"
+rm "$SUB/new-$TOKEN"
+
+# One viewer per document, or per batch of documents
+run_counted -l -0 "$TOKEN"
+PATHS_BYTES=$(wc -c < "$OUT")
+
+run_counted -o -n "$TOKEN"
+check "open" "fork exec spawn" "$MATCHES"
+check "open" "stat fstatat" 1
+
+run_counted -o -n --concurrent "$TOKEN"
+check "open concurrently" "fork exec spawn" "$MATCHES"
+
+run_counted -o -n --batch "$TOKEN"
+check "open batched" "fork exec spawn" $((PATHS_BYTES / ARGS_MIN + 1))
+
+echo
+if [ "$FAILED" -ne 0 ]; then
+	echo "$FAILED checks failed"
+	exit 1
+fi
+echo "All checks passed"
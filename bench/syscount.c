@@ -0,0 +1,293 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains an LD_PRELOAD interposer    |
+| that counts the calls mdoc makes to the functions its |
+| performance depends on, e.g. the stat() calls per     |
+| entry or the forks per opened document. The counts    |
+| are written to $SYSCOUNT_OUT when the program exits.  |
+---------------------------------------------------------
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <spawn.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+
+
+enum sys_counter {
+	SYS_OPENDIR,
+	SYS_READDIR,
+	/* stat(), lstat() and fstat() */
+	SYS_STAT,
+	SYS_FSTATAT,
+	/*
+	 * Only the direct calls, since readdir() calls the getdents64
+	 * system call from inside the C library, where it can't be seen.
+	 */
+	SYS_GETDENTS,
+	SYS_FORK,
+	/* The exec*() functions */
+	SYS_EXEC,
+	/* posix_spawn() and posix_spawnp() */
+	SYS_SPAWN,
+	/* write() and writev() */
+	SYS_WRITE,
+	SYS_COUNTERS_NUM
+};
+
+
+static unsigned long counts[SYS_COUNTERS_NUM];
+
+static const char *const counters_names[SYS_COUNTERS_NUM] = {
+	[SYS_OPENDIR] = "opendir",
+	[SYS_READDIR] = "readdir",
+	[SYS_STAT] = "stat",
+	[SYS_FSTATAT] = "fstatat",
+	[SYS_GETDENTS] = "getdents64",
+	[SYS_FORK] = "fork",
+	[SYS_EXEC] = "exec",
+	[SYS_SPAWN] = "spawn",
+	[SYS_WRITE] = "write"
+};
+
+/* Taken out of the environment, so the spawned viewers aren't counted */
+static char *out_path;
+
+
+/* The sort's threads count too */
+#define COUNT(counter) __atomic_fetch_add(&counts[(counter)], 1, __ATOMIC_RELAXED)
+
+/* Set fn to the C library's function of it's own name on the first call */
+#define REAL(fn) \
+	do { \
+		if (!real_##fn) \
+			real_##fn = dlsym(RTLD_NEXT, #fn); \
+	} while (0)
+
+
+/* Static Functions Prototype */
+static void syscount_init(void) __attribute__((constructor));
+static void syscount_fini(void) __attribute__((destructor));
+
+
+
+static void syscount_init(void)
+{
+	const char *path;
+
+	if ((path = getenv("SYSCOUNT_OUT")))
+		out_path = strdup(path);
+
+	unsetenv("SYSCOUNT_OUT");
+	unsetenv("LD_PRELOAD");
+}
+
+
+/*
+ * Write the counts as "NAME COUNT" lines, or to stderr if
+ * $SYSCOUNT_OUT wasn't set.
+ */
+static void syscount_fini(void)
+{
+	FILE *fp = stderr;
+	unsigned int i;
+
+	if (out_path && !(fp = fopen(out_path, "w"))) {
+		perror("syscount: can't open $SYSCOUNT_OUT");
+		return;
+	}
+
+	for (i=0; i<SYS_COUNTERS_NUM; i++)
+		fprintf(fp, "%s %lu\n", counters_names[i], counts[i]);
+
+	if (fp != stderr)
+		fclose(fp);
+	free(out_path);
+}
+
+
+DIR *opendir(const char *name)
+{
+	static DIR *(*real_opendir)(const char *);
+
+	REAL(opendir);
+	COUNT(SYS_OPENDIR);
+
+	return real_opendir(name);
+}
+
+
+DIR *fdopendir(int fd)
+{
+	static DIR *(*real_fdopendir)(int);
+
+	REAL(fdopendir);
+	COUNT(SYS_OPENDIR);
+
+	return real_fdopendir(fd);
+}
+
+
+struct dirent *readdir(DIR *dirp)
+{
+	static struct dirent *(*real_readdir)(DIR *);
+
+	REAL(readdir);
+	COUNT(SYS_READDIR);
+
+	return real_readdir(dirp);
+}
+
+
+int stat(const char *restrict path, struct stat *restrict statbuf)
+{
+	static int (*real_stat)(const char *, struct stat *);
+
+	REAL(stat);
+	COUNT(SYS_STAT);
+
+	return real_stat(path, statbuf);
+}
+
+
+int lstat(const char *restrict path, struct stat *restrict statbuf)
+{
+	static int (*real_lstat)(const char *, struct stat *);
+
+	REAL(lstat);
+	COUNT(SYS_STAT);
+
+	return real_lstat(path, statbuf);
+}
+
+
+int fstat(int fd, struct stat *statbuf)
+{
+	static int (*real_fstat)(int, struct stat *);
+
+	REAL(fstat);
+	COUNT(SYS_STAT);
+
+	return real_fstat(fd, statbuf);
+}
+
+
+int fstatat(int dirfd, const char *restrict path, struct stat *restrict statbuf,
+			int flags)
+{
+	static int (*real_fstatat)(int, const char *, struct stat *, int);
+
+	REAL(fstatat);
+	COUNT(SYS_FSTATAT);
+
+	return real_fstatat(dirfd, path, statbuf, flags);
+}
+
+
+ssize_t getdents64(int fd, void *buf, size_t count)
+{
+	static ssize_t (*real_getdents64)(int, void *, size_t);
+
+	REAL(getdents64);
+	COUNT(SYS_GETDENTS);
+
+	return real_getdents64(fd, buf, count);
+}
+
+
+pid_t fork(void)
+{
+	static pid_t (*real_fork)(void);
+
+	REAL(fork);
+	COUNT(SYS_FORK);
+
+	return real_fork();
+}
+
+
+int execv(const char *path, char *const argv[])
+{
+	static int (*real_execv)(const char *, char *const *);
+
+	REAL(execv);
+	COUNT(SYS_EXEC);
+
+	return real_execv(path, argv);
+}
+
+
+int execvp(const char *file, char *const argv[])
+{
+	static int (*real_execvp)(const char *, char *const *);
+
+	REAL(execvp);
+	COUNT(SYS_EXEC);
+
+	return real_execvp(file, argv);
+}
+
+
+int posix_spawn(pid_t *restrict pid, const char *restrict path,
+				const posix_spawn_file_actions_t *restrict file_actions,
+				const posix_spawnattr_t *restrict attrp,
+				char *const argv[restrict], char *const envp[restrict])
+{
+	static int (*real_posix_spawn)(pid_t *, const char *,
+								   const posix_spawn_file_actions_t *,
+								   const posix_spawnattr_t *,
+								   char *const *, char *const *);
+
+	REAL(posix_spawn);
+	COUNT(SYS_SPAWN);
+
+	return real_posix_spawn(pid, path, file_actions, attrp, argv, envp);
+}
+
+
+int posix_spawnp(pid_t *restrict pid, const char *restrict file,
+				 const posix_spawn_file_actions_t *restrict file_actions,
+				 const posix_spawnattr_t *restrict attrp,
+				 char *const argv[restrict], char *const envp[restrict])
+{
+	static int (*real_posix_spawnp)(pid_t *, const char *,
+									const posix_spawn_file_actions_t *,
+									const posix_spawnattr_t *,
+									char *const *, char *const *);
+
+	REAL(posix_spawnp);
+	COUNT(SYS_SPAWN);
+
+	return real_posix_spawnp(pid, file, file_actions, attrp, argv, envp);
+}
+
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+	static ssize_t (*real_write)(int, const void *, size_t);
+
+	REAL(write);
+	COUNT(SYS_WRITE);
+
+	return real_write(fd, buf, count);
+}
+
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	static ssize_t (*real_writev)(int, const struct iovec *, int);
+
+	REAL(writev);
+	COUNT(SYS_WRITE);
+
+	return real_writev(fd, iov, iovcnt);
+}
@@ -0,0 +1,104 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+struct docs_root;
+struct search_ctx;
+struct doc_list;
+
+/* A searched directory as it was before it was read */
+struct dir_stamp {
+	uint64_t dev;
+	uint64_t ino;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	/* The offset of it's path in the stamps' paths */
+	uint64_t path;
+};
+
+/* The directories a search read, recorded if it's search_ctx->stamps is set */
+struct dir_stamps {
+	struct dir_stamp *stamps;
+	size_t num;
+	size_t size;
+	char *paths;
+	size_t paths_len;
+	size_t paths_size;
+	/* When the search began */
+	time_t begin;
+	/* A directory changed too close to the search for it's stamp to be trusted */
+	bool racy;
+};
+
+/* The found documents of a query, either read from it's cache file or just found */
+struct query_cache {
+	/* The normalized query, what the cache file is checked against */
+	char *key;
+	size_t key_len;
+	char *file;
+	/* The cache file's content, or only the paths if they were just found */
+	char *buf;
+	/* The documents' paths one after another, each null terminated */
+	const char *paths;
+	size_t paths_len;
+	size_t docs_num;
+};
+
+/* The hashes of a file computed so far, or'ed in it's flags */
+enum file_hash_flags {
+	/* The entry is taken */
+	FILE_HASH_USED = 1 << 0,
+	FILE_HASH_EDGE = 1 << 1,
+	FILE_HASH_FULL = 1 << 2,
+	/* Looked up since the file was read, never saved */
+	FILE_HASH_SEEN = 1 << 3
+};
+
+/* A file's hashes, valid as long as it's size and mtime are unchanged */
+struct file_hash {
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	/* Of the file's first and last bytes, then of all of them */
+	uint64_t edge;
+	uint64_t full;
+	uint64_t flags;
+	/* The times the hashes were saved without the file being looked up */
+	uint64_t unseen;
+};
+
+/* The computed hashes of the files, by their device and inode */
+struct hash_cache {
+	/* NULL if the hashes are only kept in memory */
+	char *file;
+	/* An open addressing table, with linear probing */
+	struct file_hash *table;
+	size_t size;
+	size_t num;
+	/* If a hash was computed since the file was read */
+	bool changed;
+};
+
+void init_dir_stamps(struct dir_stamps *);
+int add_dir_stamp(struct dir_stamps *, const char *, int);
+void free_dir_stamps(struct dir_stamps *);
+int open_query_cache(struct query_cache *, const char *, const struct docs_root *,
+					 unsigned int, const struct search_ctx *);
+int load_query_cache(struct query_cache *);
+int fill_query_cache(struct query_cache *, const struct doc_list *);
+int save_query_cache(const struct query_cache *, const struct dir_stamps *);
+void free_query_cache(struct query_cache *);
+int open_hash_cache(struct hash_cache *, const char *);
+int reserve_hash_cache(struct hash_cache *, size_t);
+struct file_hash *find_file_hash(struct hash_cache *, const struct stat *);
+int save_hash_cache(const struct hash_cache *);
+void free_hash_cache(struct hash_cache *);
+
+#endif
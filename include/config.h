@@ -1,10 +1,40 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdbool.h>
+#include "viewers.h"
+
+/* No limit for the depth of a root's search */
+#define ROOT_DEPTH_UNLIMITED (-1)
+
+/* A documents directory to search in and how */
+struct docs_root {
+	char *path;
+	/* How many levels of sub directories to search, or ROOT_DEPTH_UNLIMITED */
+	int max_depth;
+	/* Don't search the sub directories on other file systems */
+	bool one_file_system;
+	/* Skip the entries starting with a dot */
+	bool skip_hidden;
+	/* If not NULL, search only the documents with these extensions */
+	char **exts;
+	unsigned int exts_num;
+};
+
+/*
+ * All the strings point into buf, the configurations file's content
+ * which is read at once and parsed in place.
+ */
 struct users_configs {
-	char *docs_dir_path; 
+	struct docs_root *roots;
+	unsigned int roots_num;
 	char *pdf_viewer;
 	char *add_args; /* Additional arguments */
+	/* The viewer of pdf_viewer and add_args, for any other extension */
+	struct viewer viewer;
+	/* The viewers of specific extensions */
+	struct viewer_map *viewers;
+	char *buf;
 };
 
 int generate_config(const char *);
@@ -0,0 +1,9 @@
+#ifndef DUPES_H
+#define DUPES_H
+
+struct doc_list;
+struct hash_cache;
+
+int find_dup_sets(struct doc_list *, struct hash_cache *, struct doc_list ***, unsigned int *);
+
+#endif
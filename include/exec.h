@@ -1,6 +1,15 @@
 #ifndef EXEC_H
 #define EXEC_H
 
+#include <stdbool.h>
+
+struct launcher;
+
 int execvp_process(const char *, char *const *);
+struct launcher *alloc_launcher(bool);
+int launch_process(struct launcher *, const char *, char *const *);
+int wait_launched(struct launcher *);
+void reap_detached(void);
+void free_launcher(struct launcher *);
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include <stdbool.h>
+#include "libmdoc.h"
+
+#define FIELDS_MAX 8
+
+enum doc_field {
+	FIELD_PATH,
+	FIELD_NAME,
+	FIELD_SIZE,
+	FIELD_MTIME,
+	FIELD_MODE
+};
+
+/* How to print the documents as machine readable records */
+struct record_spec {
+	enum doc_field fields[FIELDS_MAX];
+	unsigned int fields_num;
+	bool json;
+	/* The records terminator, '\n' or '\0' */
+	char terminator;
+};
+
+/* The field leading the records of a group, e.g. the batched pattern they were found by */
+struct record_group {
+	const char *name;
+	/* The field's string, or if it's NULL it's number */
+	const char *str;
+	unsigned int num;
+};
+
+int parse_fields_spec(struct record_spec *, const char *);
+int print_doc_record(struct mdoc_doc *, const struct record_spec *,
+					 const struct record_group *);
+void print_docs_num_record(const unsigned int, const struct record_spec *,
+						   const struct record_group *);
+
+#endif
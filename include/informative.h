@@ -3,18 +3,32 @@
 
 #include <time.h>
 #include <stdio.h>
+#include <spawn.h>
 #include <dirent.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include "memstats.h"
 
 extern char *prog_name_inf; 
 
+void set_error_handler_inf(void (*)(const char *, void *), void *);
+void error_inf(const char *, ...) __attribute__((format(printf, 1, 2)));
+void clear_error_inf(void);
+const char *get_last_error_inf(void);
+int get_last_errno_inf(void);
 
 void *malloc_inf(size_t);
+void *malloc_site_inf(size_t, enum mem_site);
+void *calloc_inf(size_t, size_t);
+void free_inf(void *);
 char *fgets_inf(char *, int, FILE *);
 FILE *fopen_inf(const char *, const char *);
 int fclose_inf(FILE *);
 DIR *opendir_inf(const char *);
+int open_inf(const char *, int);
+ssize_t read_inf(int, void *, size_t);
+int fstat_inf(int, struct stat *);
 int stat_inf(const char *, struct stat *);
 int closedir_inf(DIR *);
 struct dirent *readdir_inf(DIR *);
@@ -22,9 +36,13 @@ pid_t fork_inf(void);
 pid_t waitpid_inf(pid_t, int *, int);
 int execv_inf(const char *, char *const *);
 void *realloc_inf(void *, size_t);
+void *realloc_site_inf(void *, size_t, enum mem_site);
 int execvp_inf(const char *, char *const *);
 void *reallocarray_inf(void *, size_t, size_t);
 char *getenv_inf(const char *);
-char *ctime_r_inf(const time_t *, char *);
+struct tm *localtime_r_inf(const time_t *, struct tm *);
+ssize_t writev_inf(int, const struct iovec *, int);
+int epoll_create1_inf(int);
+int posix_spawnp_inf(pid_t *, const char *, const posix_spawnattr_t *, char *const *);
 
 #endif
@@ -0,0 +1,134 @@
+#ifndef LIBMDOC_H
+#define LIBMDOC_H
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+/*
+ * The search engine of mdoc, for the programs that search for documents
+ * without executing it. Every function returns a status, and the errors
+ * are only kept for the calling thread, see mdoc_last_error(), unless
+ * an error handler was set.
+ *
+ * A context holds the configurations and a query what to search for,
+ * neither is changed by the searches, so both can be used by several
+ * threads at once and reused for as many searches as needed. The
+ * phases timed by the mdoc program's --stats are only the ones of the
+ * thread that enabled it, it's main thread.
+ */
+
+enum mdoc_status {
+	MDOC_OK = 0,
+	MDOC_ERR_NOMEM,
+	/* The configurations file is missing or invalid */
+	MDOC_ERR_CONFIG,
+	/* A system call failed, e.g. a directory couldn't be opened */
+	MDOC_ERR_SYSTEM,
+	MDOC_ERR_INVALID,
+	/* A callback returned non-zero */
+	MDOC_ERR_CALLBACK
+};
+
+/* How a query matches the documents, or'ed together */
+enum mdoc_query_flags {
+	MDOC_QUERY_IGNORE_CASE = 1 << 0,
+	/* Search only the roots themselves, not their sub directories */
+	MDOC_QUERY_NO_RECURSE = 1 << 1,
+	/* Compare the numbers in the names by their values, like ls -v */
+	MDOC_QUERY_NATURAL = 1 << 2,
+	MDOC_QUERY_REVERSE = 1 << 3
+};
+
+/* What mdoc_query_set_filter() filters the documents by, besides their names */
+enum mdoc_filter {
+	/* Comma separated extensions, e.g. "pdf,djvu" */
+	MDOC_FILTER_EXT,
+	/* Sizes with an optional K, M or G suffix, e.g. "5M" */
+	MDOC_FILTER_LARGER,
+	MDOC_FILTER_SMALLER,
+	/* The mtimes' ages with an optional s, m, h, d or w suffix, e.g. "30d" */
+	MDOC_FILTER_NEWER,
+	MDOC_FILTER_OLDER,
+	/* Octal permission bits the documents all have, e.g. "644" */
+	MDOC_FILTER_PERM
+};
+
+#define MDOC_FILTERS_NUM (MDOC_FILTER_PERM + 1)
+
+/* How the viewers are executed by mdoc_open_results() */
+enum mdoc_launch {
+	/* One after another, each after the previous one exits */
+	MDOC_LAUNCH_WAIT,
+	/* All at once, then wait for them to exit */
+	MDOC_LAUNCH_CONCURRENT,
+	/* All at once, without waiting for them */
+	MDOC_LAUNCH_DETACH
+};
+
+struct mdoc_ctx;
+struct mdoc_query;
+struct mdoc_results;
+struct mdoc_index;
+/* The sets of the found documents with the same content */
+struct mdoc_dupes;
+/* A found document, valid only until it's callback returns or it's results are freed */
+struct mdoc_doc;
+
+enum mdoc_status mdoc_ctx_new(struct mdoc_ctx **, const char *);
+void mdoc_ctx_free(struct mdoc_ctx *);
+enum mdoc_status mdoc_ctx_set_cache(struct mdoc_ctx *, const char *);
+enum mdoc_status mdoc_config_generate(const char *);
+
+enum mdoc_status mdoc_query_new(struct mdoc_query **, const char *, unsigned int);
+enum mdoc_status mdoc_query_set_sort(struct mdoc_query *, const char *);
+void mdoc_query_set_limit(struct mdoc_query *, unsigned int);
+enum mdoc_status mdoc_query_set_filter(struct mdoc_query *, enum mdoc_filter, const char *);
+bool mdoc_query_sorted(const struct mdoc_query *);
+void mdoc_query_free(struct mdoc_query *);
+
+enum mdoc_status mdoc_search(const struct mdoc_ctx *, const struct mdoc_query *,
+							 int (*)(struct mdoc_doc *, void *), void *);
+enum mdoc_status mdoc_count(const struct mdoc_ctx *, const struct mdoc_query *,
+							unsigned int *);
+enum mdoc_status mdoc_search_results(const struct mdoc_ctx *, const struct mdoc_query *,
+									 struct mdoc_results **);
+struct mdoc_doc *mdoc_results_first(const struct mdoc_results *);
+unsigned int mdoc_results_num(const struct mdoc_results *);
+void mdoc_results_free(struct mdoc_results *);
+enum mdoc_status mdoc_open_results(const struct mdoc_ctx *, const struct mdoc_results *,
+								   enum mdoc_launch, bool,
+								   int (*)(struct mdoc_doc *, void *), void *);
+void mdoc_reap_detached(void);
+enum mdoc_status mdoc_count_batch(const struct mdoc_ctx *, const struct mdoc_query *const *,
+								  unsigned int, unsigned int *);
+enum mdoc_status mdoc_search_results_batch(const struct mdoc_ctx *,
+										   const struct mdoc_query *const *, unsigned int,
+										   struct mdoc_results **);
+enum mdoc_status mdoc_watch(const struct mdoc_ctx *, const struct mdoc_query *,
+							int (*)(struct mdoc_doc *, void *), void *);
+enum mdoc_status mdoc_find_dupes(const struct mdoc_ctx *, const struct mdoc_query *,
+								 struct mdoc_dupes **);
+unsigned int mdoc_dupes_num(const struct mdoc_dupes *);
+struct mdoc_doc *mdoc_dupes_set(const struct mdoc_dupes *, unsigned int);
+void mdoc_dupes_free(struct mdoc_dupes *);
+
+enum mdoc_status mdoc_index_new(struct mdoc_index **, const struct mdoc_ctx *, unsigned int);
+unsigned int mdoc_index_num(const struct mdoc_index *);
+void mdoc_index_free(struct mdoc_index *);
+enum mdoc_status mdoc_index_search(const struct mdoc_index *, const struct mdoc_query *,
+								   int (*)(struct mdoc_doc *, void *), void *);
+enum mdoc_status mdoc_index_count(const struct mdoc_index *, const struct mdoc_query *,
+								  unsigned int *);
+enum mdoc_status mdoc_index_search_results(const struct mdoc_index *, const struct mdoc_query *,
+										   struct mdoc_results **);
+
+const char *mdoc_doc_path(const struct mdoc_doc *);
+const char *mdoc_doc_name(const struct mdoc_doc *);
+const struct stat *mdoc_doc_stat(struct mdoc_doc *);
+struct mdoc_doc *mdoc_doc_next(const struct mdoc_doc *);
+
+const char *mdoc_strerror(enum mdoc_status);
+const char *mdoc_last_error(void);
+void mdoc_set_error_handler(void (*)(const char *, void *), void *);
+
+#endif
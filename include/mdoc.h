@@ -4,29 +4,76 @@
 #include <stdbool.h>
 #include <sys/stat.h>
 #include "config.h"
+#include "plan.h"
 
 /* To indicate if an previous error eccoured in a functions
    that could overwrite errno with 0 (success) before returning */
-extern bool prev_error; 
+extern _Thread_local bool prev_error; 
 
 
+struct sort_spec;
+struct pattern_set;
+struct top_docs;
+struct launcher;
+struct doc_list;
+
+/* What to search for and how, shared by the whole search */
+struct search_ctx {
+	const char *str;
+	/* If not NULL, the documents with any of the patterns in their names are found instead */
+	const struct pattern_set *patterns;
+	bool ignore_case;
+	bool recursive;
+	/* The query's filter, in the order it's checked in */
+	struct search_plan plan;
+	/*
+	 * If not 0, keep only the first limit found documents, or if sort
+	 * has keys, only the top limit documents by it.
+	 */
+	unsigned int limit;
+	const struct sort_spec *sort;
+	/*
+	 * If not NULL, every found document is passed to it with stream_arg,
+	 * in the order it'd be listed in, then freed instead of being kept,
+	 * so the search returns NULL. The document's path and metadata are
+	 * freed right after it returns, which must be 0 unless it failed.
+	 */
+	int (*stream)(struct doc_list *, void *);
+	void *stream_arg;
+	/*
+	 * If not NULL, called with every directory, it's file descriptor and
+	 * it's depth in root before it's read, e.g. to record or watch it.
+	 * It gets dir_arg in the search_ctx and must return 0 unless it failed.
+	 */
+	int (*dir_fn)(const struct search_ctx *, const char *, int, int);
+	void *dir_arg;
+	/* Used by the search itself */
+	unsigned int found;
+	struct top_docs *top;
+	/* The root being searched and it's device */
+	const struct docs_root *root;
+	dev_t root_dev;
+};
+
 struct doc_list {
 	char *path;
 	char *name;
+	/* Fetched lazily, use get_doc_stat() */
 	struct stat *stbuf; 
 	struct doc_list *next;
 };
 
-struct doc_list *sort_docs_names_alpha(const struct doc_list *);
 void free_doc_list(struct doc_list *);
-void display_doc_name(const char *, bool);
+char *get_entry_path(const char *, const char *);
+bool check_str_occurrence(const char *, const char *, bool);
 unsigned int count_doc_list_nodes(const struct doc_list *);
 struct doc_list *reverse_doc_list(const struct doc_list *);
-void print_docs_num(const unsigned int, bool);
-void display_help(const char *);
-struct doc_list *search_for_doc_multi_dir(const char *, const char *, bool, bool);
-int open_doc_path(const struct users_configs *, const char *);
-void print_opening_doc(const char *, bool);
-int print_doc_details(const struct doc_list *, bool);
+struct doc_list *search_for_doc_multi_dir(const struct docs_root *, unsigned int, 
+										  struct search_ctx *);
+int search_dir_entry(struct search_ctx *, const char *, const char *, int);
+int open_doc_path(const struct users_configs *, const char *, struct launcher *);
+int open_doc_list_batched(const struct users_configs *, const struct doc_list *, 
+						  struct launcher *, int (*)(struct doc_list *, void *), void *);
+const struct stat *get_doc_stat(struct doc_list *);
 
 #endif
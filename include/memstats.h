@@ -0,0 +1,33 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* What the memory is allocated for, the allocations are counted by it */
+enum mem_site {
+	MEM_SITE_NODE,
+	MEM_SITE_PATH,
+	MEM_SITE_NAME,
+	MEM_SITE_STAT,
+	MEM_SITE_LINE,
+	MEM_SITE_KEY,
+	MEM_SITE_OTHER,
+	MEM_SITES_NUM
+};
+
+/*
+ * Set by memstats_enable(), the memory is accounted only if it's 1,
+ * so the allocations pay nothing but a predicted branch when it's off.
+ */
+extern bool memstats_on;
+
+void memstats_enable(void);
+void memstats_set_limit(size_t);
+size_t memstats_get_limit(void);
+bool memstats_exceeds(size_t);
+void memstats_alloced(enum mem_site, size_t, long long);
+void memstats_freed(size_t);
+void memstats_print(void);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+/* Append a string literal, it's length is known at compile time */
+#define OUT_LITERAL(str) out_write(str, sizeof(str) - 1)
+
+void out_write(const char *, size_t);
+void out_str(const char *);
+void out_char(char);
+void out_uint(unsigned long);
+void out_int(long);
+int out_flush(void);
+
+#endif
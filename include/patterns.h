@@ -0,0 +1,13 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include <stdbool.h>
+
+struct pattern_set;
+
+struct pattern_set *build_pattern_set(const char *const *, unsigned int, bool);
+void free_pattern_set(struct pattern_set *);
+bool match_any_pattern(const struct pattern_set *, const char *);
+unsigned int match_patterns(const struct pattern_set *, const char *, unsigned int *, bool *);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+struct docs_root;
+
+/* The metadata predicates a filter has, or'ed in it's flags */
+enum filter_flags {
+	FILTER_LARGER = 1 << 0,
+	FILTER_SMALLER = 1 << 1,
+	FILTER_NEWER = 1 << 2,
+	FILTER_OLDER = 1 << 3,
+	FILTER_PERM = 1 << 4
+};
+
+/* What the found documents are filtered by, besides their names */
+struct query_filter {
+	/* If not NULL, the documents' extensions, pointing into exts_buf */
+	char **exts;
+	unsigned int exts_num;
+	char *exts_buf;
+	unsigned int flags;
+	/* The sizes the documents are larger and smaller than */
+	uint64_t larger;
+	uint64_t smaller;
+	/* The ages in seconds the documents are newer and older than */
+	int64_t newer;
+	int64_t older;
+	/* The permission bits the documents all have */
+	mode_t perm;
+};
+
+/* The predicates that need the metadata */
+enum plan_pred {
+	PRED_PERM,
+	PRED_LARGER,
+	PRED_SMALLER,
+	PRED_NEWER,
+	PRED_OLDER,
+	PRED_NUM
+};
+
+/*
+ * The order a search checks the filter in, the cheapest first: the
+ * entry's type from readdir(), the extension, the name and only then
+ * the predicates that need the entry stat'ed.
+ */
+struct search_plan {
+	const struct query_filter *filter;
+	/* The metadata predicates, or none so no entry is stat'ed for them */
+	enum plan_pred preds[PRED_NUM];
+	unsigned int preds_num;
+	/* The mtimes' bounds, resolved when the search starts */
+	time_t newer_than;
+	time_t older_than;
+	/* No document can pass, e.g. with --larger=5M --smaller=1M */
+	bool empty;
+};
+
+int set_filter_exts(struct query_filter *, const char *);
+int parse_filter_size(const char *, uint64_t *);
+int parse_filter_age(const char *, int64_t *);
+int parse_filter_perm(const char *, mode_t *);
+bool filter_needs_stat(const struct query_filter *);
+bool query_filters_equal(const struct query_filter *, const struct query_filter *);
+void free_query_filter(struct query_filter *);
+void plan_search(struct search_plan *, const struct query_filter *);
+bool plan_rules_out_root(const struct search_plan *, const struct docs_root *);
+bool plan_matches_ext(const struct search_plan *, const char *);
+bool plan_matches_stat(const struct search_plan *, const struct stat *);
+
+#endif
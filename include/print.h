@@ -0,0 +1,33 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdbool.h>
+#include "timefmt.h"
+
+struct mdoc_doc;
+struct record_spec;
+struct record_group;
+
+/* How the found documents are printed */
+struct doc_printer {
+	bool color;
+	bool details;
+	const struct record_spec *record;
+	struct time_cache cache;
+	/* If a document was already printed, to separate the details */
+	bool printed;
+	/* If not NULL, the group of the documents, e.g. their batched pattern, for their records */
+	const struct record_group *group;
+};
+
+void display_doc_name(const char *, bool);
+void print_opening_doc(const char *, bool);
+void print_docs_num(const unsigned int, bool);
+void print_pattern(const char *, bool);
+void print_dupes_set(const unsigned int, bool);
+int print_doc_details(struct mdoc_doc *, bool, struct time_cache *);
+void display_help(const char *);
+int print_doc(struct mdoc_doc *, void *);
+int print_opened_doc(struct mdoc_doc *, void *);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include <stdbool.h>
+#include "libmdoc.h"
+
+struct doc_printer;
+
+/* The command line's options the interactive mode's commands use */
+struct repl_opts {
+	/* The mdoc_query_flags */
+	unsigned int query_flags;
+	/* Checked before, NULL if none */
+	const char *sort_keys;
+	unsigned int limit;
+	/* The arguments of the filters by their mdoc_filter, checked before, NULL if unset */
+	const char *const *filters;
+	/* The -o options */
+	bool numerous;
+	enum mdoc_launch launch;
+	bool batch;
+	/* The --cache option, NULL for the default directory */
+	bool cache;
+	const char *cache_dir;
+};
+
+int run_repl(const struct repl_opts *, struct doc_printer *);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdbool.h>
+#include "mdoc.h"
+
+#define SORT_KEYS_MAX 8
+
+enum sort_field {
+	SORT_NAME,
+	SORT_PATH,
+	SORT_SIZE,
+	SORT_MTIME
+};
+
+struct sort_key {
+	enum sort_field field;
+	bool descending;
+};
+
+struct sort_spec {
+	struct sort_key keys[SORT_KEYS_MAX];
+	unsigned int keys_num;
+	/* Compare the names and paths in natural order */
+	bool natural;
+};
+
+int parse_sort_spec(struct sort_spec *, const char *);
+bool sort_spec_needs_stat(const struct sort_spec *);
+struct doc_list *sort_doc_list(struct doc_list *, const struct sort_spec *);
+struct top_docs *alloc_top_docs(const struct sort_spec *, unsigned int);
+void free_top_docs(struct top_docs *);
+int add_top_doc(struct top_docs *, struct doc_list *);
+struct doc_list *get_top_docs_list(struct top_docs *);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+/* The phases the run's time is split to, by the --stats option */
+enum stats_phase {
+	STATS_CONFIG,
+	STATS_SCAN,
+	/*
+	 * The documents' metadata fetched all at once, e.g. for the sort keys,
+	 * the lone stat() calls are only counted in the phase they're made in
+	 */
+	STATS_METADATA,
+	STATS_SORT,
+	STATS_OUTPUT,
+	STATS_EXEC,
+	/* The documents' contents, by --dupes */
+	STATS_HASH,
+	STATS_PHASES_NUM
+};
+
+enum stats_counter {
+	STATS_DIRS_OPENED,
+	STATS_ENTRIES_READ,
+	STATS_STATS,
+	STATS_MATCHES,
+	STATS_WRITES,
+	STATS_ALLOCS,
+	STATS_ALLOC_BYTES,
+	STATS_HASHED_BYTES,
+	STATS_COUNTERS_NUM
+};
+
+/*
+ * Every thread counts in it's own counters, without any locking, and
+ * adds them to the totals with stats_flush_thread() before it exits.
+ */
+extern _Thread_local unsigned long long stats_counts[STATS_COUNTERS_NUM];
+
+#define STATS_COUNT(counter, n) (stats_counts[(counter)] += (n))
+
+void stats_enable(void);
+bool stats_enabled(void);
+void stats_enter(enum stats_phase);
+void stats_leave(void);
+void stats_flush_thread(void);
+void stats_print(void);
+
+#endif
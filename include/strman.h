@@ -1,8 +1,13 @@
 #ifndef STRMAN_H
 #define STRMAN_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+/* The maximum length of a natural_collation_key() key for a len long string */
+#define NATURAL_KEY_MAX_LEN(len) (4 * (len) + 1)
+
 
 bool strstr_i(const char *, const char *);
 int strsort_alpha(char **, char **, const unsigned int);
@@ -10,7 +15,10 @@ unsigned int count_words(const char *);
 unsigned int space_to_null(char *);
 char *strcpy_dynamic(const char *);
 bool alpha_cmp(const char *, const char *);
+size_t alpha_collation_key(char *, const char *);
+size_t natural_collation_key(char *, const char *);
 char *small_let_copy(const char *);
 void convert_to_lower(char *);
+uint64_t fnv1a_hash(const char *, size_t, bool);
 
 #endif
@@ -0,0 +1,28 @@
+#ifndef TIMEFMT_H
+#define TIMEFMT_H
+
+#include <time.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Big enough for both formats, with room for 5+ digits years */
+#define TIME_STR_MAX 48
+
+/*
+ * The broken-down local time of the last formatted day, so the documents
+ * modified in the same day don't convert their time again.
+ */
+struct time_cache {
+	/* The cached times are [begin, end) */
+	time_t begin;
+	time_t end;
+	struct tm tm;
+	bool valid;
+	/* Format in ISO 8601 instead of the ctime() format */
+	bool iso;
+};
+
+void init_time_cache(struct time_cache *, bool);
+size_t format_time(struct time_cache *, time_t, char *);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Set by trace_start(), the events are recorded only if it's 1 */
+extern bool trace_on;
+
+/*
+ * The time a traced span began, or 0 if the tracing is off, so
+ * nothing but a predicted branch is paid when it's off.
+ */
+#define TRACE_BEGIN() (__builtin_expect(trace_on, 0) ? trace_now() : 0)
+
+/* Record the span that began at begin, with an optional arg, e.g. a path */
+#define TRACE_END(name, arg, begin) \
+	do { \
+		if (__builtin_expect(trace_on, 0)) \
+			trace_event(name, arg, begin); \
+	} while (0)
+
+uint64_t trace_now(void);
+void trace_event(const char *, const char *, uint64_t);
+int trace_start(const char *);
+int trace_finish(void);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef VIEWERS_H
+#define VIEWERS_H
+
+/* A viewer's argv, built once with the documents' paths left out */
+struct viewer {
+	char **argv;
+	/* The number of the viewer's own arguments, the program included */
+	unsigned int argc;
+};
+
+struct viewer_map;
+
+int build_viewer(struct viewer *, char *, char *);
+void free_viewer(struct viewer *);
+struct viewer_map *alloc_viewer_map(void);
+void free_viewer_map(struct viewer_map *);
+int add_viewer(struct viewer_map *, char *, char *);
+int add_viewer_line(struct viewer_map *, char *);
+const struct viewer *find_viewer(const struct viewer_map *, const char *);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+struct search_ctx;
+struct doc_watch;
+
+struct doc_watch *alloc_doc_watch(void);
+void free_doc_watch(struct doc_watch *);
+int watch_dir(const struct search_ctx *, const char *, int, int);
+int watch_new_doc(struct doc_watch *, const char *);
+int run_doc_watch(struct doc_watch *, struct search_ctx *);
+
+#endif
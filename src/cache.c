@@ -0,0 +1,860 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions of the query  |
+| cache, which keeps the found documents of a query on  |
+| disk with the directories that were searched, so the  |
+| next time they're checked with a stat() each instead  |
+| of being read again.                                  |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "informative.h"
+#include "strman.h"
+#include "config.h"
+#include "mdoc.h"
+#include "stats.h"
+#include "cache.h"
+
+/* Changed whenever the format of the cache files or the keys is */
+#define CACHE_MAGIC "mdocqc2"
+/* Changed whenever the format of the hashes file or the hashes is */
+#define HASHES_MAGIC "mdochc2"
+
+/* The initial sizes of the stamps' buffers, doubled when they're full */
+#define STAMPS_INIT 64
+#define STAMPS_PATHS_INIT 4096
+
+#define KEY_INIT 256
+
+/* The initial size of a read cache file's buffer, doubled when it's full */
+#define FILE_BUF_INIT 65536
+
+#define HASHES_INIT 1024
+/* The saves a file's hashes are kept for without it being looked up */
+#define HASHES_UNSEEN_MAX 16
+
+
+/*
+ * What a cache file starts with, followed by the stamps, the key,
+ * the stamps' paths and the documents' paths. The files are only
+ * read by the machine that wrote them, so they're in it's byte order.
+ */
+struct cache_header {
+	char magic[8];
+	uint64_t key_len;
+	uint64_t stamps_num;
+	uint64_t stamps_paths_len;
+	uint64_t docs_num;
+	uint64_t docs_paths_len;
+};
+
+/* What the hashes file starts with, followed by the hashes */
+struct hashes_header {
+	char magic[8];
+	uint64_t num;
+};
+
+/* The key of a query, built a field at a time */
+struct key_buf {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+
+/* Static Functions Prototype */
+static int grow_dir_stamps(struct dir_stamps *, size_t);
+static int add_key_field(struct key_buf *, const char *, size_t);
+static int add_key_str(struct key_buf *, const char *);
+static int add_key_num(struct key_buf *, long long);
+static int build_query_key(struct key_buf *, const struct docs_root *, unsigned int,
+						   const struct search_ctx *);
+static char *read_cache_file(const char *, size_t, size_t *);
+static bool check_paths(const char *, size_t, uint64_t);
+static bool check_dir_stamps(const struct dir_stamp *, uint64_t, const char *, uint64_t);
+static int parse_cache_file(struct query_cache *, char *, size_t);
+static void make_parent_dirs(const char *);
+static FILE *create_tmp_file(const char *, char *, size_t);
+static int replace_file(FILE *, bool, const char *, const char *);
+static bool write_cache_file(FILE *, const struct query_cache *, const struct dir_stamps *);
+static uint64_t hash_file_id(uint64_t, uint64_t);
+static struct file_hash *find_hash_entry(const struct hash_cache *, uint64_t, uint64_t);
+static int grow_hash_table(struct hash_cache *, size_t);
+static void load_hash_cache(struct hash_cache *);
+static bool keep_file_hash(const struct file_hash *, struct file_hash *);
+
+
+
+void init_dir_stamps(struct dir_stamps *stamps)
+{
+	memset(stamps, 0, sizeof(struct dir_stamps));
+	stamps->begin = time(NULL);
+}
+
+
+static int grow_dir_stamps(struct dir_stamps *stamps, size_t path_len)
+{
+	struct dir_stamp *new_stamps;
+	char *paths;
+	size_t size;
+
+	if (stamps->num == stamps->size) {
+		size = stamps->size ? 2 * stamps->size : STAMPS_INIT;
+		if (!(new_stamps = reallocarray_inf(stamps->stamps, size, sizeof(struct dir_stamp))))
+			return -1;
+
+		stamps->stamps = new_stamps;
+		stamps->size = size;
+	}
+
+	if (stamps->paths_size - stamps->paths_len < path_len) {
+		for (size=stamps->paths_size ? stamps->paths_size : STAMPS_PATHS_INIT;
+			 size - stamps->paths_len < path_len; size*=2)
+			;
+		if (!(paths = realloc_site_inf(stamps->paths, size, MEM_SITE_PATH)))
+			return -1;
+
+		stamps->paths = paths;
+		stamps->paths_size = size;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Record the directory at path, open at fd, before it's read, so
+ * any change while it's read makes it's stamp outdated.
+ */
+int add_dir_stamp(struct dir_stamps *stamps, const char *path, int fd)
+{
+	const size_t len = strlen(path) + 1;
+	struct dir_stamp *stamp;
+	struct stat stbuf;
+
+	if (fstat_inf(fd, &stbuf) || grow_dir_stamps(stamps, len))
+		return -1;
+
+	stamp = &stamps->stamps[stamps->num++];
+	stamp->dev = stbuf.st_dev;
+	stamp->ino = stbuf.st_ino;
+	stamp->mtime_sec = stbuf.st_mtim.tv_sec;
+	stamp->mtime_nsec = stbuf.st_mtim.tv_nsec;
+	stamp->path = stamps->paths_len;
+
+	memcpy(&stamps->paths[stamps->paths_len], path, len);
+	stamps->paths_len += len;
+
+	/*
+	 * A change in the same tick of the clock as the stamp doesn't change
+	 * the mtime, so a directory changed that recently could hide the next
+	 * change. Such a search isn't cached.
+	 */
+	if (stbuf.st_mtim.tv_sec >= stamps->begin - 1)
+		stamps->racy = 1;
+
+	return 0;
+}
+
+
+void free_dir_stamps(struct dir_stamps *stamps)
+{
+	free_inf(stamps->stamps);
+	free_inf(stamps->paths);
+}
+
+
+/*
+ * Append the field to the key with it's length before it, so no
+ * two different queries have the same key.
+ */
+static int add_key_field(struct key_buf *key, const char *field, size_t len)
+{
+	char prefix[24];
+	size_t prefix_len;
+	size_t size;
+	char *buf;
+
+	prefix_len = snprintf(prefix, sizeof(prefix), "%zu:", len);
+
+	if (key->size - key->len < prefix_len + len + 1) {
+		for (size=key->size ? key->size : KEY_INIT;
+			 size - key->len < prefix_len + len + 1; size*=2)
+			;
+		if (!(buf = realloc_site_inf(key->buf, size, MEM_SITE_OTHER)))
+			return -1;
+
+		key->buf = buf;
+		key->size = size;
+	}
+	memcpy(&key->buf[key->len], prefix, prefix_len);
+	memcpy(&key->buf[key->len + prefix_len], field, len);
+	key->len += prefix_len + len;
+	key->buf[key->len++] = '\n';
+
+	return 0;
+}
+
+
+static int add_key_str(struct key_buf *key, const char *str)
+{
+	return add_key_field(key, str, strlen(str));
+}
+
+
+static int add_key_num(struct key_buf *key, long long num)
+{
+	char field[24];
+
+	return add_key_field(key, field, snprintf(field, sizeof(field), "%lld", num));
+}
+
+
+/*
+ * Build the key of everything the found documents depend on: the
+ * searched string, how it's searched for, and the roots with their
+ * policies. The sort and the limit are applied after the cache.
+ */
+static int build_query_key(struct key_buf *key, const struct docs_root *roots,
+						   unsigned int roots_num, const struct search_ctx *search)
+{
+	char *str = NULL;
+	unsigned int i;
+	unsigned int j;
+	int retval = -1;
+
+	/* Without case distinctions, the strings of any case are the same query */
+	if (search->str && search->ignore_case && !(str = small_let_copy(search->str)))
+		return -1;
+
+	if (add_key_str(key, CACHE_MAGIC) ||
+		add_key_num(key, search->str != NULL) ||
+		add_key_str(key, str ? str : search->str ? search->str : "") ||
+		add_key_num(key, search->ignore_case) ||
+		add_key_num(key, search->recursive) ||
+		add_key_num(key, roots_num))
+		goto out;
+
+	/* Only the filters of the names, the metadata's ones aren't cached */
+	if (add_key_num(key, search->plan.filter->exts ?
+					(long long) search->plan.filter->exts_num : -1))
+		goto out;
+
+	for (i=0; search->plan.filter->exts && i<search->plan.filter->exts_num; i++)
+		if (add_key_str(key, search->plan.filter->exts[i]))
+			goto out;
+
+	for (i=0; i<roots_num; i++) {
+		if (add_key_str(key, roots[i].path) ||
+			add_key_num(key, roots[i].max_depth) ||
+			add_key_num(key, roots[i].one_file_system) ||
+			add_key_num(key, roots[i].skip_hidden) ||
+			add_key_num(key, roots[i].exts ? (long long) roots[i].exts_num : -1))
+			goto out;
+
+		for (j=0; roots[i].exts && j<roots[i].exts_num; j++)
+			if (add_key_str(key, roots[i].exts[j]))
+				goto out;
+	}
+	retval = 0;
+
+out:
+	free_inf(str);
+
+	return retval;
+}
+
+
+/*
+ * Prepare the cache of the search for the documents in the roots,
+ * in the cache directory dir. Nothing is read nor written yet.
+ */
+int open_query_cache(struct query_cache *cache, const char *dir,
+					 const struct docs_root *roots, unsigned int roots_num,
+					 const struct search_ctx *search)
+{
+	struct key_buf key = {.buf = NULL, .len = 0, .size = 0};
+	size_t len;
+
+	memset(cache, 0, sizeof(struct query_cache));
+
+	if (build_query_key(&key, roots, roots_num, search)) {
+		free_inf(key.buf);
+		return -1;
+	}
+	cache->key = key.buf;
+	cache->key_len = key.len;
+
+	len = strlen(dir) + 18;
+	if (!(cache->file = malloc_site_inf(sizeof(char) * len, MEM_SITE_PATH))) {
+		free_query_cache(cache);
+		return -1;
+	}
+	snprintf(cache->file, len, "%s/%016llx", dir,
+			 (unsigned long long) fnv1a_hash(cache->key, cache->key_len, 0));
+
+	return 0;
+}
+
+
+/*
+ * Return the content of the file at path and save it's size in size,
+ * or NULL if it can't be read or it's shorter than min_size. Only the
+ * allocation failure is an error, in which case prev_error is set.
+ * The file is read to it's end rather than sized with a fstat(), the
+ * loaded cache costs just the stats of it's directories.
+ */
+static char *read_cache_file(const char *path, size_t min_size, size_t *size)
+{
+	char *buf = NULL;
+	char *new_buf;
+	size_t buf_size = 0;
+	size_t done = 0;
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return NULL;
+
+	for (;;) {
+		if (done == buf_size) {
+			buf_size = buf_size ? 2 * buf_size : FILE_BUF_INIT;
+			if (!(new_buf = realloc_site_inf(buf, buf_size, MEM_SITE_PATH))) {
+				prev_error = 1;
+				goto fail;
+			}
+			buf = new_buf;
+		}
+
+		if ((n = read(fd, buf + done, buf_size - done)) == 0)
+			break;
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			goto fail;
+		}
+		done += n;
+	}
+
+	if (done < min_size)
+		goto fail;
+
+	*size = done;
+	close(fd);
+
+	return buf;
+
+fail:
+	free_inf(buf);
+	close(fd);
+
+	return NULL;
+}
+
+
+/*
+ * Return 1 if the len bytes of paths are num null terminated paths,
+ * otherwise 0.
+ */
+static bool check_paths(const char *paths, size_t len, uint64_t num)
+{
+	const char *end = paths + len;
+	const char *ptr;
+	uint64_t found = 0;
+
+	if (len && paths[len - 1] != '\0')
+		return 0;
+
+	for (ptr=paths; ptr<end && (ptr = memchr(ptr, '\0', end - ptr)); ptr++)
+		found++;
+
+	return found == num;
+}
+
+
+/*
+ * Return 1 if every directory is just like it's stamp, so no entry was
+ * added, removed or renamed in any of them since they were searched.
+ */
+static bool check_dir_stamps(const struct dir_stamp *stamps, uint64_t stamps_num,
+							 const char *paths, uint64_t paths_len)
+{
+	struct stat stbuf;
+	uint64_t i;
+
+	for (i=0; i<stamps_num; i++) {
+		if (stamps[i].path >= paths_len)
+			return 0;
+
+		STATS_COUNT(STATS_STATS, 1);
+
+		if (stat(&paths[stamps[i].path], &stbuf) ||
+			stamps[i].dev != (uint64_t) stbuf.st_dev ||
+			stamps[i].ino != (uint64_t) stbuf.st_ino ||
+			stamps[i].mtime_sec != stbuf.st_mtim.tv_sec ||
+			stamps[i].mtime_nsec != stbuf.st_mtim.tv_nsec)
+			return 0;
+	}
+
+	return 1;
+}
+
+
+/*
+ * Take the documents from the cache file's content in buf if it's of
+ * the cache's key and still valid, and return 0. Otherwise return 1
+ * and leave buf to the caller.
+ */
+static int parse_cache_file(struct query_cache *cache, char *buf, size_t size)
+{
+	struct cache_header header;
+	const struct dir_stamp *stamps;
+	const char *stamps_paths;
+	const char *key;
+	size_t left = size - sizeof(struct cache_header);
+
+	memcpy(&header, buf, sizeof(struct cache_header));
+
+	/* Every section is checked against what's left, so nothing overflows */
+	if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) ||
+		header.stamps_num > left / sizeof(struct dir_stamp))
+		return 1;
+	left -= header.stamps_num * sizeof(struct dir_stamp);
+
+	if (header.key_len != cache->key_len || header.key_len > left)
+		return 1;
+	left -= header.key_len;
+
+	if (header.stamps_paths_len > left)
+		return 1;
+	left -= header.stamps_paths_len;
+
+	if (header.docs_paths_len != left)
+		return 1;
+
+	stamps = (const struct dir_stamp *) (buf + sizeof(struct cache_header));
+	key = (const char *) (stamps + header.stamps_num);
+	stamps_paths = key + header.key_len;
+
+	if (memcmp(key, cache->key, cache->key_len) ||
+		!check_paths(stamps_paths, header.stamps_paths_len, header.stamps_num) ||
+		!check_paths(stamps_paths + header.stamps_paths_len, header.docs_paths_len,
+					 header.docs_num))
+		return 1;
+
+	if (!check_dir_stamps(stamps, header.stamps_num, stamps_paths, header.stamps_paths_len))
+		return 1;
+
+	cache->buf = buf;
+	cache->paths = stamps_paths + header.stamps_paths_len;
+	cache->paths_len = header.docs_paths_len;
+	cache->docs_num = header.docs_num;
+
+	return 0;
+}
+
+
+/*
+ * Read the cached documents of the query if they're still valid and
+ * return 0, or return 1 if they have to be searched for. A missing,
+ * outdated or damaged cache file is just a miss. Return -1 on failure.
+ */
+int load_query_cache(struct query_cache *cache)
+{
+	size_t size;
+	char *buf;
+
+	if (!(buf = read_cache_file(cache->file, sizeof(struct cache_header), &size)))
+		return prev_error ?
+			-1 : 1;
+
+	if (parse_cache_file(cache, buf, size)) {
+		free_inf(buf);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Keep the paths of the found documents in the cache, to be passed
+ * on and saved just like the read ones.
+ */
+int fill_query_cache(struct query_cache *cache, const struct doc_list *list)
+{
+	const struct doc_list *ptr;
+	size_t len = 0;
+	size_t path_len;
+	char *buf;
+
+	cache->docs_num = 0;
+	for (ptr=list; ptr; ptr=ptr->next) {
+		len += strlen(ptr->path) + 1;
+		cache->docs_num++;
+	}
+
+	if (!(buf = malloc_site_inf(len ? len : 1, MEM_SITE_PATH)))
+		return -1;
+
+	cache->buf = buf;
+	cache->paths = buf;
+	cache->paths_len = len;
+
+	for (ptr=list; ptr; ptr=ptr->next) {
+		path_len = strlen(ptr->path) + 1;
+		memcpy(buf, ptr->path, path_len);
+		buf += path_len;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Create the missing directories of the path, like mkdir -p does for
+ * it's parent. Their failures show when the file is created.
+ */
+static void make_parent_dirs(const char *path)
+{
+	char dir[PATH_MAX];
+	char *slash;
+
+	if (snprintf(dir, sizeof(dir), "%s", path) >= (int) sizeof(dir))
+		return;
+
+	for (slash=strchr(dir + 1, '/'); slash; slash=strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(dir, 0700);
+		*slash = '/';
+	}
+}
+
+
+/*
+ * Create a temporary file next to the file at path and return it open
+ * for writing, it's path is saved in tmp. Return NULL on failure.
+ */
+static FILE *create_tmp_file(const char *path, char *tmp, size_t tmp_size)
+{
+	FILE *fp;
+	int fd;
+
+	if (snprintf(tmp, tmp_size, "%s.XXXXXX", path) >= (int) tmp_size)
+		return NULL;
+
+	make_parent_dirs(tmp);
+
+	if ((fd = mkstemp(tmp)) == -1)
+		return NULL;
+
+	if (!(fp = fdopen(fd, "wb"))) {
+		close(fd);
+		unlink(tmp);
+	}
+
+	return fp;
+}
+
+
+/*
+ * Close the temporary file at tmp and rename it over the file at path
+ * if it was written whole, so the concurrent runs read either one of
+ * them whole. Otherwise it's removed.
+ */
+static int replace_file(FILE *fp, bool written, const char *tmp, const char *path)
+{
+	if (fclose(fp) || !written || rename(tmp, path)) {
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static bool write_cache_file(FILE *fp, const struct query_cache *cache,
+							 const struct dir_stamps *stamps)
+{
+	struct cache_header header = {
+		.magic = CACHE_MAGIC,
+		.key_len = cache->key_len,
+		.stamps_num = stamps->num,
+		.stamps_paths_len = stamps->paths_len,
+		.docs_num = cache->docs_num,
+		.docs_paths_len = cache->paths_len
+	};
+
+	return fwrite(&header, sizeof(struct cache_header), 1, fp) == 1 &&
+		   fwrite(stamps->stamps, sizeof(struct dir_stamp), stamps->num, fp) == stamps->num &&
+		   fwrite(cache->key, 1, cache->key_len, fp) == cache->key_len &&
+		   fwrite(stamps->paths, 1, stamps->paths_len, fp) == stamps->paths_len &&
+		   fwrite(cache->paths, 1, cache->paths_len, fp) == cache->paths_len;
+}
+
+
+/*
+ * Save the documents of the cache with the stamps of the directories
+ * they were found in. The file is written aside and renamed over the
+ * old one. The cache is only an optimization, so it's failures are
+ * silent.
+ */
+int save_query_cache(const struct query_cache *cache, const struct dir_stamps *stamps)
+{
+	char tmp[PATH_MAX];
+	FILE *fp;
+
+	if (!(fp = create_tmp_file(cache->file, tmp, sizeof(tmp))))
+		return -1;
+
+	return replace_file(fp, write_cache_file(fp, cache, stamps), tmp, cache->file);
+}
+
+
+void free_query_cache(struct query_cache *cache)
+{
+	free_inf(cache->key);
+	free_inf(cache->file);
+	free_inf(cache->buf);
+}
+
+
+/* Mixed like splitmix64's finalizer, the inodes are mostly sequential */
+static uint64_t hash_file_id(uint64_t dev, uint64_t ino)
+{
+	uint64_t hash = dev * 0x9e3779b97f4a7c15u ^ ino;
+
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9u;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebu;
+
+	return hash ^ (hash >> 31);
+}
+
+
+/*
+ * Return the entry of the file, or the free entry it'd be added to.
+ */
+static struct file_hash *find_hash_entry(const struct hash_cache *cache, uint64_t dev,
+										 uint64_t ino)
+{
+	const size_t mask = cache->size - 1;
+	struct file_hash *entry;
+	size_t i;
+
+	for (i=hash_file_id(dev, ino) & mask; ; i=(i + 1) & mask) {
+		entry = &cache->table[i];
+
+		if (!entry->flags || (entry->dev == dev && entry->ino == ino))
+			return entry;
+	}
+}
+
+
+/*
+ * Grow the table to hold num more files, kept at most half full.
+ */
+static int grow_hash_table(struct hash_cache *cache, size_t num)
+{
+	struct hash_cache grown = *cache;
+	size_t i;
+
+	for (grown.size=cache->size ? cache->size : HASHES_INIT;
+		 grown.size / 2 < cache->num + num; grown.size*=2)
+		;
+	if (grown.size == cache->size)
+		return 0;
+
+	if (!(grown.table = calloc_inf(grown.size, sizeof(struct file_hash))))
+		return -1;
+
+	for (i=0; i<cache->size; i++)
+		if (cache->table[i].flags)
+			*find_hash_entry(&grown, cache->table[i].dev, cache->table[i].ino) =
+				cache->table[i];
+
+	free_inf(cache->table);
+	*cache = grown;
+
+	return 0;
+}
+
+
+/*
+ * Read the hashes file into the table, a missing or damaged one is
+ * just left out.
+ */
+static void load_hash_cache(struct hash_cache *cache)
+{
+	struct hashes_header header;
+	const struct file_hash *hashes;
+	struct file_hash *entry;
+	size_t size;
+	char *buf;
+	size_t i;
+
+	if (!(buf = read_cache_file(cache->file, sizeof(struct hashes_header), &size)))
+		return;
+
+	memcpy(&header, buf, sizeof(struct hashes_header));
+
+	if (memcmp(header.magic, HASHES_MAGIC, sizeof(HASHES_MAGIC)) ||
+		header.num != (size - sizeof(struct hashes_header)) / sizeof(struct file_hash) ||
+		(size - sizeof(struct hashes_header)) % sizeof(struct file_hash) ||
+		grow_hash_table(cache, header.num)) {
+		free_inf(buf);
+		return;
+	}
+
+	hashes = (const struct file_hash *) (buf + sizeof(struct hashes_header));
+
+	for (i=0; i<header.num; i++) {
+		if (!(hashes[i].flags & FILE_HASH_USED))
+			continue;
+
+		if (!(entry = find_hash_entry(cache, hashes[i].dev, hashes[i].ino))->flags) {
+			*entry = hashes[i];
+			entry->flags &= ~FILE_HASH_SEEN;
+			cache->num++;
+		}
+	}
+	free_inf(buf);
+}
+
+
+/*
+ * Prepare the cache of the files' hashes in the directory dir, and read
+ * the ones computed before. If dir is NULL they're only kept in memory.
+ */
+int open_hash_cache(struct hash_cache *cache, const char *dir)
+{
+	size_t len;
+
+	memset(cache, 0, sizeof(struct hash_cache));
+
+	if (dir) {
+		len = strlen(dir) + sizeof("/hashes");
+		if (!(cache->file = malloc_site_inf(sizeof(char) * len, MEM_SITE_PATH)))
+			return -1;
+		snprintf(cache->file, len, "%s/hashes", dir);
+
+		load_hash_cache(cache);
+	}
+
+	if ((!cache->table && grow_hash_table(cache, 0)) || prev_error) {
+		free_hash_cache(cache);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Make room for num more files, so the entries returned by
+ * find_file_hash() stay where they are until then.
+ */
+int reserve_hash_cache(struct hash_cache *cache, size_t num)
+{
+	return grow_hash_table(cache, num);
+}
+
+
+/*
+ * Return the hashes entry of the file by it's metadata, with the hashes
+ * computed before unless the file changed since, or a new entry. The
+ * caller sets the computed hashes and the cache's changed flag. Return
+ * NULL if there's no room for it, see reserve_hash_cache().
+ */
+struct file_hash *find_file_hash(struct hash_cache *cache, const struct stat *stbuf)
+{
+	struct file_hash *entry = find_hash_entry(cache, stbuf->st_dev, stbuf->st_ino);
+
+	if (!entry->flags) {
+		if (2 * (cache->num + 1) > cache->size)
+			return NULL;
+		cache->num++;
+	}
+
+	if (!entry->flags || entry->size != (uint64_t) stbuf->st_size ||
+		entry->mtime_sec != stbuf->st_mtim.tv_sec ||
+		entry->mtime_nsec != stbuf->st_mtim.tv_nsec) {
+		entry->dev = stbuf->st_dev;
+		entry->ino = stbuf->st_ino;
+		entry->size = stbuf->st_size;
+		entry->mtime_sec = stbuf->st_mtim.tv_sec;
+		entry->mtime_nsec = stbuf->st_mtim.tv_nsec;
+		entry->flags = FILE_HASH_USED;
+	}
+	entry->flags |= FILE_HASH_SEEN;
+
+	return entry;
+}
+
+
+/*
+ * Save the entry in saved as it's written to the hashes file, aged if
+ * it wasn't looked up. Return 0 if it's aged out instead, e.g. the
+ * file was removed, so the hashes file doesn't keep growing.
+ */
+static bool keep_file_hash(const struct file_hash *entry, struct file_hash *saved)
+{
+	if (!entry->flags)
+		return 0;
+
+	*saved = *entry;
+	saved->flags &= ~FILE_HASH_SEEN;
+	saved->unseen = (entry->flags & FILE_HASH_SEEN) ? 0 : entry->unseen + 1;
+
+	return saved->unseen < HASHES_UNSEEN_MAX;
+}
+
+
+/*
+ * Write the hashes file if a hash was computed since it was read, aside
+ * and renamed over the old one just like the queries' cache files. The
+ * failures are silent too. The files that weren't looked up by the last
+ * HASHES_UNSEEN_MAX runs that saved it are left out.
+ */
+int save_hash_cache(const struct hash_cache *cache)
+{
+	struct hashes_header header = {.magic = HASHES_MAGIC, .num = 0};
+	struct file_hash saved;
+	char tmp[PATH_MAX];
+	bool written;
+	FILE *fp;
+	size_t i;
+
+	if (!cache->file || !cache->changed)
+		return 0;
+
+	for (i=0; i<cache->size; i++)
+		header.num += keep_file_hash(&cache->table[i], &saved);
+
+	if (!(fp = create_tmp_file(cache->file, tmp, sizeof(tmp))))
+		return -1;
+
+	written = fwrite(&header, sizeof(struct hashes_header), 1, fp) == 1;
+
+	for (i=0; written && i<cache->size; i++)
+		if (keep_file_hash(&cache->table[i], &saved))
+			written = fwrite(&saved, sizeof(struct file_hash), 1, fp) == 1;
+
+	return replace_file(fp, written, tmp, cache->file);
+}
+
+
+void free_hash_cache(struct hash_cache *cache)
+{
+	free_inf(cache->file);
+	free_inf(cache->table);
+}
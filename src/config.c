@@ -8,16 +8,38 @@
 */
 
 #include <stdio.h>
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "informative.h"
+#include "strman.h"
 #include "input.h"
 #include "config.h"
 
 
+/* The user's answers when generating the configurations */
+struct configs_input {
+	char *docs_dir_path;
+	char *pdf_viewer;
+	char *add_args;
+};
+
+enum config_section {
+	SECTION_NONE,
+	SECTION_ROOT,
+	SECTION_VIEWER,
+	SECTION_VIEWERS
+};
+
+
 /* Static Functions Prototype */
-static struct users_configs *input_configs();
-static void write_configs(FILE *, const struct users_configs *);
+static struct configs_input *input_configs();
+static void free_configs_input(struct configs_input *);
+static void write_configs(FILE *, struct configs_input *);
 static char *get_line_inf(FILE *);
 static char *input_docs_dir_path();
 static char *input_pdf_viewer_name();
@@ -25,7 +47,22 @@ static char *input_add_args();
 static void null_users_configs_members(struct users_configs *);
 static void *alloc_users_configs();
 static void free_and_null_users_configs(struct users_configs **);
-static struct users_configs * read_config_file(FILE *);
+static char *read_config_buf(const char *);
+static char *next_line(char **);
+static char *trim(char *);
+static bool is_ini_configs(const char *);
+static int add_root(struct users_configs *, char *);
+static int parse_positional_configs(struct users_configs *);
+static int config_line_err(unsigned int, const char *);
+static int parse_section(enum config_section *, char *, unsigned int);
+static int parse_bool_value(bool *, const char *, unsigned int);
+static int parse_depth_value(int *, const char *, unsigned int);
+static int parse_exts_value(struct docs_root *, char *);
+static int set_root_key(struct docs_root *, const char *, char *, unsigned int);
+static int set_config_key(struct users_configs *, enum config_section,
+						  char *, char *, unsigned int);
+static int check_ini_configs(const struct users_configs *);
+static int parse_ini_configs(struct users_configs *);
 
 
 static char *get_line_inf(FILE *stream) 
@@ -33,7 +70,7 @@ static char *get_line_inf(FILE *stream)
 	char *retval;
 
 	if (!(retval = get_line(stream)))
-		fprintf(stderr, "%s: an necessary input is missing\n", prog_name_inf);
+		error_inf("an necessary input is missing");
 
 	return retval;
 }
@@ -76,12 +113,14 @@ static char *input_add_args()
  * and the third is for additional arguments. Then it'll take the user's 
  * answers as an input.
  */
-static struct users_configs *input_configs() 
+static struct configs_input *input_configs() 
 { 
-    struct users_configs *input;
+    struct configs_input *input;
 
-	if ((input = alloc_users_configs())) {
-		null_users_configs_members(input);
+	if ((input = malloc_inf(sizeof(struct configs_input)))) {
+		input->docs_dir_path = NULL;
+		input->pdf_viewer = NULL;
+		input->add_args = NULL;
 		/*
 		 * Get all the necessary input from the user.
 		 * Note: inputting add_args is optional, so the program
@@ -89,15 +128,26 @@ static struct users_configs *input_configs()
 		 */
 		if (!(input->docs_dir_path = input_docs_dir_path()) ||
 			!(input->pdf_viewer = input_pdf_viewer_name())  ||
-			(!(input->add_args = input_add_args()) && errno))
+			(!(input->add_args = input_add_args()) && errno)) {
 			/* Failure */
-			 free_and_null_users_configs(&input);
+			free_configs_input(input);
+			input = NULL;
+		}
 	}
 
     return input; 
 }
 
 
+static void free_configs_input(struct configs_input *input) 
+{
+	free_inf(input->docs_dir_path);
+	free_inf(input->pdf_viewer);
+	free_inf(input->add_args);
+	free_inf(input);
+}
+
+
 static void free_and_null_users_configs(struct users_configs **ptr) 
 {
 	free_users_configs(*ptr);
@@ -117,65 +167,94 @@ static void *alloc_users_configs()
  */
 int generate_config(const char *abs_config_path) 
 {
-	struct users_configs *configs;
+	struct configs_input *input;
 	int retval = -1;
 	FILE *fp;
 
 	if ((fp = fopen_inf(abs_config_path, "w"))) {
-		if ((configs = input_configs())) {
-			write_configs(fp, configs);			
-			free_users_configs(configs); 
-			
+		if ((input = input_configs())) {
+			write_configs(fp, input);
+			free_configs_input(input);
+
 			printf("\nYour configurations were generated succesfully.\n");
 			retval = 0;
 		}
 		if (fclose_inf(fp))
 			retval = -1;
-	}	
+	}
 
 	return retval;
 }
 
 
-static void write_configs(FILE *fp, const struct users_configs *configs) 
+/*
+ * Write the configurations in sections, a [root] section for
+ * every one of the space separated directories.
+ */
+static void write_configs(FILE *fp, struct configs_input *input) 
 {
-	fprintf(fp, "%s\n%s\n", configs->docs_dir_path, configs->pdf_viewer);
-	
-	if (configs->add_args)
-		fprintf(fp, "%s\n", configs->add_args);
+	char *dirs_path = input->docs_dir_path;
+	unsigned int ret;
+
+	for (; (ret = space_to_null(dirs_path)); dirs_path+=ret)
+		if (*dirs_path != '\0')
+			fprintf(fp, "[root]\npath = %s\n\n", dirs_path);
+
+	fprintf(fp, "[viewer]\nprogram = %s\n", input->pdf_viewer);
+
+	if (input->add_args)
+		fprintf(fp, "args = %s\n", input->add_args);
 }
 
 
-struct users_configs *read_configs(const char *abs_config_path) 
+/*
+ * Read the whole file at once, terminated with a null byte.
+ */
+static char *read_config_buf(const char *abs_config_path) 
 {
-	struct users_configs *configs = NULL;
-	FILE *fp;
-	
-	if ((fp = fopen_inf(abs_config_path, "r"))) {
-		configs = read_config_file(fp);
-
-		if (fclose_inf(fp) && configs)
-			free_and_null_users_configs(&configs);
+	struct stat stbuf;
+	char *buf = NULL;
+	ssize_t ret = 0;
+	size_t len = 0;
+	int fd;
+
+	if ((fd = open_inf(abs_config_path, O_RDONLY)) == -1)
+		return NULL;
+
+	if (fstat_inf(fd, &stbuf) || !(buf = malloc_inf(stbuf.st_size + 1)))
+		goto out;
+
+	/* A single read, unless the file is shorter than it was */
+	while (len < (size_t) stbuf.st_size &&
+		   (ret = read_inf(fd, &buf[len], stbuf.st_size - len)) > 0)
+		len += ret;
+
+	if (ret == -1) {
+		free_inf(buf);
+		buf = NULL;
+	} else {
+		buf[len] = '\0';
 	}
 
-	return configs;
+out:
+	close(fd);
+
+	return buf;
 }
 
 
-static struct users_configs *read_config_file(FILE *fp) 
+struct users_configs *read_configs(const char *abs_config_path) 
 {
 	struct users_configs *configs;
-	
+
 	if ((configs = alloc_users_configs())) {
 		null_users_configs_members(configs);
-		/*
-		 * Get all the necessary config sections from the file.
-		 * Note: reading add_args is optional, so the program
-		 * will fail only if it's missing due to an error.
-		 */
-		if (!(configs->docs_dir_path = get_line_inf(fp)) ||
-		    !(configs->pdf_viewer = get_line_inf(fp))    ||
-		    (!(configs->add_args = get_line(fp)) && errno))
+
+		if (!(configs->buf = read_config_buf(abs_config_path)) ||
+			!(configs->viewers = alloc_viewer_map())           ||
+			(is_ini_configs(configs->buf) ?
+			 parse_ini_configs(configs) : parse_positional_configs(configs)) ||
+			build_viewer(&configs->viewer, configs->pdf_viewer, configs->add_args))
 			/* Failure */
 			free_and_null_users_configs(&configs);
 	}
@@ -184,22 +263,364 @@ static struct users_configs *read_config_file(FILE *fp)
 }
 
 
+/*
+ * Return the next line in *buf, terminated with a null byte, and advance
+ * *buf after it. Return NULL at the end of the buffer.
+ */
+static char *next_line(char **buf) 
+{
+	char *line = *buf;
+	char *end;
+
+	if (*line == '\0')
+		return NULL;
+
+	if ((end = strchr(line, '\n'))) {
+		*end = '\0';
+		*buf = end + 1;
+	} else {
+		*buf = line + strlen(line);
+	}
+
+	return line;
+}
+
+
+/*
+ * Remove the leading and trailing white characters in place.
+ */
+static char *trim(char *str) 
+{
+	char *end;
+
+	while (isspace((unsigned char) *str))
+		str++;
+
+	for (end=str+strlen(str); end>str && isspace((unsigned char) end[-1]); end--)
+		;
+	*end = '\0';
+
+	return str;
+}
+
+
+/*
+ * Return 1 if the first line that isn't empty or a comment is a section,
+ * otherwise 0 for the positional format.
+ */
+static bool is_ini_configs(const char *buf) 
+{
+	for (;;) {
+		while (isspace((unsigned char) *buf))
+			buf++;
+
+		if (*buf != '#' && *buf != ';')
+			return *buf == '[';
+
+		if (!(buf = strchr(buf, '\n')))
+			return 0;
+	}
+}
+
+
+static int add_root(struct users_configs *configs, char *path) 
+{
+	struct docs_root *roots;
+
+	if (!(roots = reallocarray_inf(configs->roots, configs->roots_num + 1,
+								   sizeof(struct docs_root))))
+		return -1;
+
+	configs->roots = roots;
+	roots = &configs->roots[configs->roots_num++];
+
+	roots->path = path;
+	roots->max_depth = ROOT_DEPTH_UNLIMITED;
+	roots->one_file_system = 0;
+	roots->skip_hidden = 0;
+	roots->exts = NULL;
+	roots->exts_num = 0;
+
+	return 0;
+}
+
+
+/*
+ * The original format: the space separated directories, the viewer, the
+ * optional additional arguments and then the optional viewer lines of
+ * specific extensions, a line each.
+ */
+static int parse_positional_configs(struct users_configs *configs) 
+{
+	char *cursor = configs->buf;
+	char *dirs_path;
+	char *line;
+	unsigned int ret;
+
+	if (!(dirs_path = next_line(&cursor)) || *dirs_path == '\0' ||
+		!(configs->pdf_viewer = next_line(&cursor)) || *configs->pdf_viewer == '\0') {
+		error_inf("an necessary input is missing");
+		return -1;
+	}
+	for (; (ret = space_to_null(dirs_path)); dirs_path+=ret)
+		if (*dirs_path != '\0' && add_root(configs, dirs_path))
+			return -1;
+
+	if ((configs->add_args = next_line(&cursor)) && *configs->add_args == '\0')
+		configs->add_args = NULL;
+
+	while ((line = next_line(&cursor)))
+		if (add_viewer_line(configs->viewers, line))
+			return -1;
+
+	return 0;
+}
+
+
+static int config_line_err(unsigned int line_num, const char *msg) 
+{
+	error_inf("line %u of the configurations: %s", line_num, msg);
+
+	return -1;
+}
+
+
+static int parse_section(enum config_section *section, char *line,
+						 unsigned int line_num) 
+{
+	const size_t len = strlen(line);
+
+	if (line[len-1] != ']')
+		return config_line_err(line_num, "invalid section");
+
+	line[len-1] = '\0';
+	line = trim(line + 1);
+
+	if (strcmp(line, "root") == 0)
+		*section = SECTION_ROOT;
+	else if (strcmp(line, "viewer") == 0)
+		*section = SECTION_VIEWER;
+	else if (strcmp(line, "viewers") == 0)
+		*section = SECTION_VIEWERS;
+	else
+		return config_line_err(line_num, "unknown section");
+
+	return 0;
+}
+
+
+static int parse_bool_value(bool *flag, const char *value, 
+							unsigned int line_num) 
+{
+	if (strcmp(value, "yes") == 0 || strcmp(value, "true") == 0 ||
+		strcmp(value, "1") == 0)
+		*flag = 1;
+	else if (strcmp(value, "no") == 0 || strcmp(value, "false") == 0 ||
+			 strcmp(value, "0") == 0)
+		*flag = 0;
+	else
+		return config_line_err(line_num, "expected yes or no");
+
+	return 0;
+}
+
+
+static int parse_depth_value(int *depth, const char *value, 
+							 unsigned int line_num) 
+{
+	unsigned long val;
+	char *end;
+
+	if (strcmp(value, "unlimited") == 0) {
+		*depth = ROOT_DEPTH_UNLIMITED;
+		return 0;
+	}
+	errno = 0;
+	val = strtoul(value, &end, 10);
+
+	if (!isdigit((unsigned char) *value) || *end != '\0' || errno || val > INT_MAX)
+		return config_line_err(line_num, "invalid depth");
+
+	*depth = (int) val;
+
+	return 0;
+}
+
+
+/*
+ * Split the comma separated extensions without the dots, e.g. "pdf, djvu",
+ * in place. A later extensions key replaces an earlier one.
+ */
+static int parse_exts_value(struct docs_root *root, char *value) 
+{
+	unsigned int exts_num = 1;
+	char *ext;
+	char *c;
+
+	for (c=value; *c; c++)
+		if (*c == ',')
+			exts_num++;
+
+	free_inf(root->exts);
+	root->exts_num = 0;
+
+	if (!(root->exts = malloc_inf(sizeof(char *) * exts_num)))
+		return -1;
+
+	while ((ext = strsep(&value, ",")))
+		if (*(ext = trim(ext)) != '\0')
+			root->exts[root->exts_num++] = ext;
+
+	return 0;
+}
+
+
+static int set_root_key(struct docs_root *root, const char *key, 
+						char *value, unsigned int line_num) 
+{
+	if (*value == '\0')
+		return config_line_err(line_num, "empty value");
+
+	if (strcmp(key, "path") == 0) {
+		root->path = value;
+		return 0;
+	} else if (strcmp(key, "max-depth") == 0) {
+		return parse_depth_value(&root->max_depth, value, line_num);
+	} else if (strcmp(key, "one-file-system") == 0) {
+		return parse_bool_value(&root->one_file_system, value, line_num);
+	} else if (strcmp(key, "skip-hidden") == 0) {
+		return parse_bool_value(&root->skip_hidden, value, line_num);
+	} else if (strcmp(key, "extensions") == 0) {
+		return parse_exts_value(root, value);
+	}
+
+	return config_line_err(line_num, "unknown key");
+}
+
+
+static int set_config_key(struct users_configs *configs,
+						  enum config_section section, char *key,
+						  char *value, unsigned int line_num) 
+{
+	switch (section) {
+	case SECTION_ROOT:
+		return set_root_key(&configs->roots[configs->roots_num-1], 
+							key, value, line_num);
+	case SECTION_VIEWER:
+		if (strcmp(key, "program") == 0 && *value != '\0') {
+			configs->pdf_viewer = value;
+			return 0;
+		} else if (strcmp(key, "args") == 0) {
+			configs->add_args = (*value != '\0') ? value : NULL;
+			return 0;
+		}
+		break;
+	case SECTION_VIEWERS:
+		return add_viewer(configs->viewers, key, value);
+	case SECTION_NONE:
+		return config_line_err(line_num, "a key outside of a section");
+	}
+
+	return config_line_err(line_num, "unknown key or empty value");
+}
+
+
+static int check_ini_configs(const struct users_configs *configs) 
+{
+	unsigned int i;
+
+	for (i=0; i<configs->roots_num; i++)
+		if (!configs->roots[i].path)
+			break;
+
+	if (!configs->roots_num || i < configs->roots_num || !configs->pdf_viewer) {
+		error_inf("the configurations need a path in every [root] "
+				  "section and a [viewer] program");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * The sectioned format, e.g.
+ *
+ * [root]
+ * path = /home/user/My Documents
+ * max-depth = 2
+ * one-file-system = yes
+ * skip-hidden = yes
+ * extensions = pdf, djvu
+ *
+ * [viewer]
+ * program = zathura
+ * args = --fork
+ *
+ * [viewers]
+ * djvu,ps = evince
+ *
+ * Every [root] section is a directory to search in, only the path is
+ * required. Empty lines and lines starting with '#' or ';' are ignored.
+ */
+static int parse_ini_configs(struct users_configs *configs) 
+{
+	enum config_section section = SECTION_NONE;
+	char *cursor = configs->buf;
+	unsigned int line_num = 0;
+	char *value;
+	char *line;
+
+	while ((line = next_line(&cursor))) {
+		line_num++;
+		line = trim(line);
+
+		if (*line == '\0' || *line == '#' || *line == ';')
+			continue;
+
+		if (*line == '[') {
+			if (parse_section(&section, line, line_num))
+				return -1;
+			/* Every [root] section is another root */
+			if (section == SECTION_ROOT && add_root(configs, NULL))
+				return -1;
+			continue;
+		}
+		if (!(value = strchr(line, '=')))
+			return config_line_err(line_num, "missing '='");
+
+		*value++ = '\0';
+
+		if (set_config_key(configs, section, trim(line), trim(value), line_num))
+			return -1;
+	}
+	return check_ini_configs(configs);
+}
+
+
 static void null_users_configs_members(struct users_configs *configs) 
 {
-	configs->docs_dir_path = NULL;
+	configs->roots = NULL;
+	configs->roots_num = 0;
 	configs->pdf_viewer = NULL;
 	configs->add_args = NULL;
+	configs->viewer.argv = NULL;
+	configs->viewers = NULL;
+	configs->buf = NULL;
 }
 
 
 void free_users_configs(struct users_configs *ptr) 
 {
-	if (ptr->docs_dir_path)
-		free(ptr->docs_dir_path);
-	if (ptr->pdf_viewer)
-		free(ptr->pdf_viewer);
-	if (ptr->add_args)
-		free(ptr->add_args);
-	
-	free(ptr);
+	unsigned int i;
+
+	for (i=0; i<ptr->roots_num; i++)
+		free_inf(ptr->roots[i].exts);
+	if (ptr->viewers)
+		free_viewer_map(ptr->viewers);
+	free_viewer(&ptr->viewer);
+	free_inf(ptr->roots);
+	free_inf(ptr->buf);
+
+	free_inf(ptr);
 }
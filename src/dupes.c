@@ -0,0 +1,807 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for finding   |
+| the duplicate documents, narrowed down by their sizes |
+| then by the hashes of their edges, so only the likely |
+| duplicates are read whole.                            |
+---------------------------------------------------------
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "informative.h"
+#include "cache.h"
+#include "mdoc.h"
+#include "stats.h"
+#include "trace.h"
+#include "dupes.h"
+
+/* The bytes hashed from the start and from the end of a document */
+#define EDGE_SIZE 4096
+
+/* The bytes a whole document is read by at a time */
+#define HASH_CHUNK_SIZE (64 * 1024)
+
+#define HASH_THREADS_MAX 16
+/* Below this number of documents to hash a single thread does */
+#define PARALLEL_HASH_MIN 8
+
+/* What a listed document is to the sets */
+#define NOT_IN_SET 0
+#define SET_HEAD 1
+#define SET_MEMBER 2
+
+#define PRIME64_1 0x9e3779b185ebca87u
+#define PRIME64_2 0xc2b2ae3d27d4eb4fu
+#define PRIME64_3 0x165667b19e3779f9u
+#define PRIME64_4 0x85ebca77c2b2ae63u
+#define PRIME64_5 0x27d4eb2f165667c5u
+
+/* The bytes the four accumulators of XXH64 consume at a time */
+#define XXH64_STRIPE 32
+
+
+/* An XXH64 hash fed a piece at a time */
+struct xxh64_state {
+	uint64_t acc[4];
+	uint64_t seed;
+	uint64_t len;
+	/* The bytes short of a whole stripe, hashed once there are enough */
+	unsigned char buf[XXH64_STRIPE];
+	size_t buf_len;
+};
+
+/* A found document and what it's compared by */
+struct dup_file {
+	struct doc_list *doc;
+	/* The file the path leads to, after the symbolic links */
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	/* The document's hashes, shared by the paths of the same file */
+	struct file_hash *hash;
+	/* It's index in the listing, so the sets keep the listing's order */
+	unsigned int order;
+};
+
+/* A file to hash */
+struct hash_job {
+	struct file_hash *hash;
+	const char *path;
+	/* The errno of the failure, or 0 */
+	int err;
+};
+
+/* The jobs of a stage, taken by the threads one at a time */
+struct hash_pool {
+	struct hash_job *jobs;
+	size_t jobs_num;
+	/* The full hashes are computed, otherwise the edges' ones */
+	bool full;
+	atomic_size_t next;
+};
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static uint64_t read_u64(const unsigned char *);
+static uint32_t read_u32(const unsigned char *);
+static uint64_t rotl64(uint64_t, unsigned int);
+static uint64_t xxh64_round(uint64_t, uint64_t);
+static uint64_t xxh64_merge_round(uint64_t, uint64_t);
+static void xxh64_stripe(uint64_t *, const unsigned char *);
+static void xxh64_init(struct xxh64_state *, uint64_t);
+static void xxh64_update(struct xxh64_state *, const void *, size_t);
+static uint64_t xxh64_digest(const struct xxh64_state *);
+static uint64_t xxh64(const void *, size_t, uint64_t);
+static int read_all(int, unsigned char *, size_t, off_t);
+static int hash_small_file(int, struct file_hash *);
+static int hash_file_edges(int, struct file_hash *);
+static int hash_whole_file(int, struct file_hash *);
+static bool is_same_file(int, const struct file_hash *);
+static void run_hash_job(struct hash_job *, bool);
+static void *hash_thread(void *);
+static unsigned int get_hash_threads_num(size_t);
+static int hash_files(struct dup_file *, size_t *, struct hash_cache *, bool);
+static int cmp_file_ids(const void *, const void *);
+static bool is_symlink(const char *);
+static size_t drop_same_files(struct dup_file *, size_t);
+static int cmp_sizes(const void *, const void *);
+static int cmp_edges(const void *, const void *);
+static int cmp_full_hashes(const void *, const void *);
+static int cmp_orders(const void *, const void *);
+static size_t keep_equal_runs(struct dup_file *, size_t, int (*)(const void *, const void *));
+static int collect_files(struct doc_list *, struct doc_list **, struct dup_file *, size_t *);
+
+
+
+static uint64_t read_u64(const unsigned char *ptr)
+{
+	uint64_t val;
+
+	memcpy(&val, ptr, sizeof(uint64_t));
+
+	return val;
+}
+
+
+static uint32_t read_u32(const unsigned char *ptr)
+{
+	uint32_t val;
+
+	memcpy(&val, ptr, sizeof(uint32_t));
+
+	return val;
+}
+
+
+static uint64_t rotl64(uint64_t val, unsigned int bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+
+	return acc * PRIME64_1;
+}
+
+
+static uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+	acc ^= xxh64_round(0, val);
+
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+
+static void xxh64_stripe(uint64_t *acc, const unsigned char *ptr)
+{
+	acc[0] = xxh64_round(acc[0], read_u64(ptr));
+	acc[1] = xxh64_round(acc[1], read_u64(ptr + 8));
+	acc[2] = xxh64_round(acc[2], read_u64(ptr + 16));
+	acc[3] = xxh64_round(acc[3], read_u64(ptr + 24));
+}
+
+
+static void xxh64_init(struct xxh64_state *state, uint64_t seed)
+{
+	state->acc[0] = seed + PRIME64_1 + PRIME64_2;
+	state->acc[1] = seed + PRIME64_2;
+	state->acc[2] = seed;
+	state->acc[3] = seed - PRIME64_1;
+	state->seed = seed;
+	state->len = 0;
+	state->buf_len = 0;
+}
+
+
+/*
+ * Feed the len bytes at buf to the hash, the bytes short of a whole
+ * stripe are kept until the next ones.
+ */
+static void xxh64_update(struct xxh64_state *state, const void *buf, size_t len)
+{
+	const unsigned char *ptr = buf;
+	const unsigned char *const end = ptr + len;
+	size_t fill;
+
+	state->len += len;
+
+	if (state->buf_len) {
+		fill = XXH64_STRIPE - state->buf_len;
+		if (len < fill) {
+			memcpy(state->buf + state->buf_len, ptr, len);
+			state->buf_len += len;
+			return;
+		}
+		memcpy(state->buf + state->buf_len, ptr, fill);
+		xxh64_stripe(state->acc, state->buf);
+		ptr += fill;
+		state->buf_len = 0;
+	}
+
+	for (; end - ptr >= XXH64_STRIPE; ptr+=XXH64_STRIPE)
+		xxh64_stripe(state->acc, ptr);
+
+	memcpy(state->buf, ptr, end - ptr);
+	state->buf_len = end - ptr;
+}
+
+
+/*
+ * The hash of all the bytes fed so far. The words are read in the
+ * machine's byte order, the hashes are only compared on the machine
+ * that computed them.
+ */
+static uint64_t xxh64_digest(const struct xxh64_state *state)
+{
+	const unsigned char *ptr = state->buf;
+	const unsigned char *const end = ptr + state->buf_len;
+	const uint64_t *acc = state->acc;
+	uint64_t hash;
+
+	if (state->len >= XXH64_STRIPE) {
+		hash = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) +
+			   rotl64(acc[3], 18);
+		hash = xxh64_merge_round(hash, acc[0]);
+		hash = xxh64_merge_round(hash, acc[1]);
+		hash = xxh64_merge_round(hash, acc[2]);
+		hash = xxh64_merge_round(hash, acc[3]);
+	} else {
+		hash = state->seed + PRIME64_5;
+	}
+	hash += state->len;
+
+	for (; end - ptr >= 8; ptr+=8)
+		hash = rotl64(hash ^ xxh64_round(0, read_u64(ptr)), 27) * PRIME64_1 + PRIME64_4;
+
+	if (end - ptr >= 4) {
+		hash = rotl64(hash ^ (read_u32(ptr) * PRIME64_1), 23) * PRIME64_2 + PRIME64_3;
+		ptr += 4;
+	}
+
+	for (; ptr < end; ptr++)
+		hash = rotl64(hash ^ (*ptr * PRIME64_5), 11) * PRIME64_1;
+
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+
+	return hash ^ (hash >> 32);
+}
+
+
+/*
+ * XXH64 of the len bytes at buf, which hashes about as fast as they're
+ * read from memory.
+ */
+static uint64_t xxh64(const void *buf, size_t len, uint64_t seed)
+{
+	struct xxh64_state state;
+
+	xxh64_init(&state, seed);
+	xxh64_update(&state, buf, len);
+
+	return xxh64_digest(&state);
+}
+
+
+/*
+ * Read exactly len bytes at offset, or fail with errno set. A file
+ * shorter than it was stat'ed fails with EIO.
+ */
+static int read_all(int fd, unsigned char *buf, size_t len, off_t offset)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = pread(fd, buf, len, offset)) == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0) {
+			errno = EIO;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+		offset += n;
+	}
+
+	return 0;
+}
+
+
+/*
+ * A file that's no bigger than it's edges is read whole right away,
+ * both of it's hashes are the same one.
+ */
+static int hash_small_file(int fd, struct file_hash *hash)
+{
+	unsigned char buf[2 * EDGE_SIZE];
+
+	if (read_all(fd, buf, hash->size, 0))
+		return -1;
+
+	hash->edge = hash->full = xxh64(buf, hash->size, 0);
+	hash->flags |= FILE_HASH_EDGE | FILE_HASH_FULL;
+	STATS_COUNT(STATS_HASHED_BYTES, hash->size);
+
+	return 0;
+}
+
+
+static int hash_file_edges(int fd, struct file_hash *hash)
+{
+	unsigned char buf[2 * EDGE_SIZE];
+
+	if (read_all(fd, buf, EDGE_SIZE, 0) ||
+		read_all(fd, buf + EDGE_SIZE, EDGE_SIZE, hash->size - EDGE_SIZE))
+		return -1;
+
+	/* Seeded by the size, so the edges of different sizes never collide */
+	hash->edge = xxh64(buf, sizeof(buf), hash->size);
+	hash->flags |= FILE_HASH_EDGE;
+	STATS_COUNT(STATS_HASHED_BYTES, sizeof(buf));
+
+	return 0;
+}
+
+
+/*
+ * Hash the file a chunk at a time, read ahead by the kernel since it's
+ * read once from it's start to it's end. A file that shrank since it
+ * was stat'ed fails with EIO, see read_all().
+ */
+static int hash_whole_file(int fd, struct file_hash *hash)
+{
+	unsigned char buf[HASH_CHUNK_SIZE];
+	struct xxh64_state state;
+	uint64_t offset;
+	size_t len;
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	xxh64_init(&state, 0);
+
+	for (offset=0; offset<hash->size; offset+=len) {
+		len = (hash->size - offset < HASH_CHUNK_SIZE) ? hash->size - offset : HASH_CHUNK_SIZE;
+		if (read_all(fd, buf, len, offset))
+			return -1;
+		xxh64_update(&state, buf, len);
+	}
+
+	hash->full = xxh64_digest(&state);
+	hash->flags |= FILE_HASH_FULL;
+	STATS_COUNT(STATS_HASHED_BYTES, hash->size);
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the open file is still the one the entry was made for,
+ * with the same size and mtime, otherwise 0.
+ */
+static bool is_same_file(int fd, const struct file_hash *hash)
+{
+	struct stat stbuf;
+
+	if (fstat(fd, &stbuf))
+		return 0;
+
+	return (uint64_t) stbuf.st_dev == hash->dev && (uint64_t) stbuf.st_ino == hash->ino &&
+		   (uint64_t) stbuf.st_size == hash->size &&
+		   stbuf.st_mtim.tv_sec == hash->mtime_sec && stbuf.st_mtim.tv_nsec == hash->mtime_nsec;
+}
+
+
+/*
+ * Compute the job's full hash or the hash of it's edges. The failure
+ * is saved in the job, since it runs in a thread of it's own. A file
+ * that changed since it was stat'ed, or while it was hashed, fails
+ * with ESTALE and is left without the hash.
+ */
+static void run_hash_job(struct hash_job *job, bool full)
+{
+	struct file_hash *hash = job->hash;
+	const uint64_t flags = hash->flags;
+	int retval;
+	int fd;
+
+	if ((fd = open(job->path, O_RDONLY | O_CLOEXEC)) == -1) {
+		job->err = errno;
+		return;
+	}
+
+	if (!is_same_file(fd, hash)) {
+		errno = ESTALE;
+		retval = -1;
+	} else if (hash->size <= 2 * EDGE_SIZE) {
+		retval = hash_small_file(fd, hash);
+	} else if (full) {
+		retval = hash_whole_file(fd, hash);
+	} else {
+		retval = hash_file_edges(fd, hash);
+	}
+
+	if (!retval && !is_same_file(fd, hash)) {
+		hash->flags = flags;
+		errno = ESTALE;
+		retval = -1;
+	}
+
+	if (retval)
+		job->err = errno;
+	close(fd);
+}
+
+
+static void *hash_thread(void *arg)
+{
+	struct hash_pool *pool = arg;
+	size_t i;
+
+	while ((i = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed)) <
+		   pool->jobs_num)
+		run_hash_job(&pool->jobs[i], pool->full);
+
+	/* It's counters are gone when it exits */
+	stats_flush_thread();
+
+	return NULL;
+}
+
+
+static unsigned int get_hash_threads_num(size_t jobs_num)
+{
+	long cpus;
+
+	if (jobs_num < PARALLEL_HASH_MIN)
+		return 1;
+
+	if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+		return 1;
+
+	return (cpus > HASH_THREADS_MAX) ? HASH_THREADS_MAX : cpus;
+}
+
+
+/*
+ * Compute the full hashes of the files, or the hashes of their edges,
+ * unless they're in the cache already. The files are hashed by a pool
+ * of threads, each taking the next file until they're all done. The
+ * files that can't be hashed, e.g. removed or changed since they were
+ * found, are dropped and num is updated. Only running out of memory
+ * fails.
+ */
+static int hash_files(struct dup_file *files, size_t *num, struct hash_cache *cache, bool full)
+{
+	const uint64_t flag = full ? FILE_HASH_FULL : FILE_HASH_EDGE;
+	const uint64_t trace_begin = TRACE_BEGIN();
+	struct hash_pool pool = {.jobs_num = 0, .full = full};
+	pthread_t threads[HASH_THREADS_MAX];
+	bool started[HASH_THREADS_MAX];
+	unsigned int threads_num;
+	int retval = 0;
+	size_t kept;
+	size_t i;
+
+	if (!(pool.jobs = reallocarray_inf(NULL, *num ? *num : 1, sizeof(struct hash_job))))
+		return -1;
+
+	for (i=0; i<*num; i++)
+		if (!(files[i].hash->flags & flag)) {
+			pool.jobs[pool.jobs_num].hash = files[i].hash;
+			pool.jobs[pool.jobs_num].path = files[i].doc->path;
+			pool.jobs[pool.jobs_num++].err = 0;
+		}
+
+	atomic_init(&pool.next, 0);
+	threads_num = get_hash_threads_num(pool.jobs_num);
+
+	/* The calling thread is one of the pool */
+	for (i=1; i<threads_num; i++)
+		started[i] = !pthread_create(&threads[i], NULL, hash_thread, &pool);
+
+	while ((i = atomic_fetch_add_explicit(&pool.next, 1, memory_order_relaxed)) <
+		   pool.jobs_num)
+		run_hash_job(&pool.jobs[i], full);
+
+	for (i=1; i<threads_num; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+
+	for (i=0; i<pool.jobs_num && !retval; i++)
+		if (pool.jobs[i].err == ENOMEM) {
+			errno = ENOMEM;
+			error_inf("can't hash '%s': %s", pool.jobs[i].path, strerror(ENOMEM));
+			retval = -1;
+		}
+
+	for (i=0, kept=0; i<*num; i++)
+		if (files[i].hash->flags & flag)
+			files[kept++] = files[i];
+	*num = kept;
+
+	if (pool.jobs_num)
+		cache->changed = 1;
+
+	free_inf(pool.jobs);
+	TRACE_END(full ? "hash" : "hash edges", NULL, trace_begin);
+
+	return retval;
+}
+
+
+static int cmp_file_ids(const void *a, const void *b)
+{
+	const struct dup_file *file_a = a;
+	const struct dup_file *file_b = b;
+
+	if (file_a->dev != file_b->dev)
+		return (file_a->dev > file_b->dev) - (file_a->dev < file_b->dev);
+
+	if (file_a->ino != file_b->ino)
+		return (file_a->ino > file_b->ino) - (file_a->ino < file_b->ino);
+
+	return cmp_orders(a, b);
+}
+
+
+static bool is_symlink(const char *path)
+{
+	struct stat stbuf;
+
+	STATS_COUNT(STATS_STATS, 1);
+
+	return !lstat(path, &stbuf) && S_ISLNK(stbuf.st_mode);
+}
+
+
+/*
+ * Keep a single path of each file, the first one by the listing's order
+ * that isn't a symbolic link. The file's hard links and the symbolic
+ * links to it aren't copies of it, removing one of them as such would
+ * lose the only content. Return the number of the kept files.
+ */
+static size_t drop_same_files(struct dup_file *files, size_t num)
+{
+	size_t kept = 0;
+	size_t begin;
+	size_t end;
+	size_t i;
+
+	qsort(files, num, sizeof(struct dup_file), cmp_file_ids);
+
+	for (begin=0; begin<num; begin=end) {
+		for (end=begin + 1; end<num && files[end].dev == files[begin].dev &&
+			 files[end].ino == files[begin].ino; end++)
+			;
+
+		/* Only the paths of a file with several are lstat'ed */
+		for (i=begin; end - begin > 1 && i<end - 1 && is_symlink(files[i].doc->path); i++)
+			;
+		files[kept++] = files[i];
+	}
+
+	return kept;
+}
+
+
+static int cmp_sizes(const void *a, const void *b)
+{
+	const struct dup_file *file_a = a;
+	const struct dup_file *file_b = b;
+
+	if (file_a->size != file_b->size)
+		return (file_a->size > file_b->size) - (file_a->size < file_b->size);
+
+	return cmp_orders(a, b);
+}
+
+
+static int cmp_edges(const void *a, const void *b)
+{
+	const struct dup_file *file_a = a;
+	const struct dup_file *file_b = b;
+
+	if (file_a->size != file_b->size)
+		return (file_a->size > file_b->size) - (file_a->size < file_b->size);
+
+	if (file_a->hash->edge != file_b->hash->edge)
+		return (file_a->hash->edge > file_b->hash->edge) -
+			   (file_a->hash->edge < file_b->hash->edge);
+
+	return cmp_orders(a, b);
+}
+
+
+static int cmp_full_hashes(const void *a, const void *b)
+{
+	const struct dup_file *file_a = a;
+	const struct dup_file *file_b = b;
+
+	if (file_a->size != file_b->size)
+		return (file_a->size > file_b->size) - (file_a->size < file_b->size);
+
+	if (file_a->hash->full != file_b->hash->full)
+		return (file_a->hash->full > file_b->hash->full) -
+			   (file_a->hash->full < file_b->hash->full);
+
+	return cmp_orders(a, b);
+}
+
+
+static int cmp_orders(const void *a, const void *b)
+{
+	const struct dup_file *file_a = a;
+	const struct dup_file *file_b = b;
+
+	return (file_a->order > file_b->order) - (file_a->order < file_b->order);
+}
+
+
+/*
+ * Sort the files by cmp, whose last key is their order, and keep only
+ * the runs of at least two files that are equal by the other keys.
+ * Return the number of the kept files.
+ */
+static size_t keep_equal_runs(struct dup_file *files, size_t num,
+							  int (*cmp)(const void *, const void *))
+{
+	struct dup_file a;
+	struct dup_file b;
+	size_t kept = 0;
+	size_t begin;
+	size_t end;
+
+	qsort(files, num, sizeof(struct dup_file), cmp);
+
+	for (begin=0; begin<num; begin=end) {
+		for (end=begin + 1; end<num; end++) {
+			/* Equal but for their order */
+			a = files[begin];
+			b = files[end];
+			a.order = b.order = 0;
+			if (cmp(&a, &b))
+				break;
+		}
+
+		if (end - begin > 1) {
+			memmove(&files[kept], &files[begin], (end - begin) * sizeof(struct dup_file));
+			kept += end - begin;
+		}
+	}
+
+	return kept;
+}
+
+
+/*
+ * Save the list's nodes in nodes, by their order, and the non empty
+ * documents in files, whose number is saved in num.
+ */
+static int collect_files(struct doc_list *list, struct doc_list **nodes,
+						 struct dup_file *files, size_t *num)
+{
+	const struct stat *stbuf;
+	unsigned int order;
+	int retval = 0;
+
+	*num = 0;
+
+	stats_enter(STATS_METADATA);
+
+	for (order=0; list; list=list->next, order++) {
+		nodes[order] = list;
+
+		if (!(stbuf = get_doc_stat(list))) {
+			retval = -1;
+			break;
+		}
+
+		/* The empty documents are all the same, but hardly duplicates */
+		if (!stbuf->st_size)
+			continue;
+
+		files[*num].doc = list;
+		files[*num].dev = stbuf->st_dev;
+		files[*num].ino = stbuf->st_ino;
+		files[*num].size = stbuf->st_size;
+		files[*num].hash = NULL;
+		files[(*num)++].order = order;
+	}
+
+	stats_leave();
+
+	return retval;
+}
+
+
+/*
+ * Find the sets of the list's documents with the same content. The
+ * documents of the same size are compared by the hashes of their edges,
+ * and only the ones that are still equal are hashed whole. The contents
+ * aren't compared byte by byte, a set rests on equal 64-bit XXH64
+ * hashes, whose collisions are far less likely than a read error. The
+ * paths of the same file are a single document, see drop_same_files().
+ * The first document of each set is saved in sets, in the list's order,
+ * and the set's documents are linked after it. The rest of the list is
+ * freed. On failure the list is left as it was.
+ */
+int find_dup_sets(struct doc_list *list, struct hash_cache *cache,
+				  struct doc_list ***sets, unsigned int *sets_num)
+{
+	const unsigned int docs_num = count_doc_list_nodes(list);
+	struct doc_list **nodes;
+	struct dup_file *files;
+	unsigned char *in_set;
+	size_t num;
+	size_t begin;
+	size_t end;
+	size_t i;
+
+	*sets = NULL;
+	*sets_num = 0;
+
+	nodes = reallocarray_inf(NULL, docs_num ? docs_num : 1, sizeof(struct doc_list *));
+	files = reallocarray_inf(NULL, docs_num ? docs_num : 1, sizeof(struct dup_file));
+	in_set = calloc_inf(docs_num ? docs_num : 1, sizeof(unsigned char));
+
+	if (!nodes || !files || !in_set || collect_files(list, nodes, files, &num))
+		goto err_out;
+
+	/* Only the documents of the same size may be equal */
+	num = drop_same_files(files, num);
+	num = keep_equal_runs(files, num, cmp_sizes);
+
+	if (reserve_hash_cache(cache, num))
+		goto err_out;
+	for (i=0; i<num; i++)
+		files[i].hash = find_file_hash(cache, get_doc_stat(files[i].doc));
+
+	if (hash_files(files, &num, cache, 0))
+		goto err_out;
+	num = keep_equal_runs(files, num, cmp_edges);
+
+	if (hash_files(files, &num, cache, 1))
+		goto err_out;
+	num = keep_equal_runs(files, num, cmp_full_hashes);
+
+	/* A set has two documents at least */
+	if (num && !(*sets = reallocarray_inf(NULL, num / 2, sizeof(struct doc_list *))))
+		goto err_out;
+
+	/* Every set starts with it's first document by the list's order */
+	for (begin=0; begin<num; begin=end) {
+		in_set[files[begin].order] = SET_HEAD;
+
+		for (end=begin + 1; end<num && files[end].hash->full == files[begin].hash->full &&
+			 files[end].size == files[begin].size; end++) {
+			files[end-1].doc->next = files[end].doc;
+			in_set[files[end].order] = SET_MEMBER;
+		}
+		files[end-1].doc->next = NULL;
+	}
+
+	/* The sets by the order of their first documents */
+	for (i=0; i<docs_num; i++)
+		if (in_set[i] == SET_HEAD)
+			(*sets)[(*sets_num)++] = nodes[i];
+
+	for (i=0; i<docs_num; i++)
+		if (in_set[i] == NOT_IN_SET) {
+			nodes[i]->next = NULL;
+			free_doc_list(nodes[i]);
+		}
+
+	free_inf(nodes);
+	free_inf(files);
+	free_inf(in_set);
+
+	return 0;
+
+err_out:
+	free_inf(nodes);
+	free_inf(files);
+	free_inf(in_set);
+	free_inf(*sets);
+	*sets = NULL;
+
+	return -1;
+}
@@ -8,43 +8,361 @@
 ---------------------------------------------------------
 */
 
+/* For POSIX_SPAWN_SETSID */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <spawn.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
 #include "informative.h"
 #include "exec.h"
+#include "trace.h"
+
+#define EPOLL_EVENTS_MAX 16
+
+
+struct launched_child {
+    pid_t pid;
+    /* -1 if it's waited for without epoll */
+    int pidfd;
+};
+
+struct launcher {
+    struct launched_child *children;
+    unsigned int len;
+    unsigned int size;
+    int epoll_fd;
+    bool detach;
+};
+
+
+/*
+ * The detached children of all the launchers. Nothing waits for them,
+ * so they're reaped by reap_detached() once they exit instead of being
+ * left as zombies, e.g. for as long as the interactive mode runs.
+ */
+static pid_t *detached_pids;
+static unsigned int detached_len;
+static unsigned int detached_size;
+static pthread_mutex_t detached_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Static Functions Prototype */
+static int spawn_child(const char *, char *const *, bool, pid_t *);
+static bool child_succeeded(int);
+static int grow_children(struct launcher *);
+static void watch_child(struct launcher *, pid_t);
+static int reap_child(struct launcher *, struct launched_child *);
+static void reap_exited_detached(void);
+static int launch_detached(const char *, char *const *);
+
 
 
 /*
- * Fork a new child and execute the executable with the given argv,
- * using execvp().
+ * Spawn a new child executing the executable with the given argv,
+ * without waiting for it to exit. posix_spawnp() doesn't copy the
+ * page tables like fork(), so it takes the same time no matter how
+ * many documents are held in memory, and it returns the exec error
+ * itself. Return -1 if it couldn't be executed, otherwise 0 and set
+ * pid to the child's process id.
  */
-int execvp_process(const char *executable, char *const *argv) 
+static int spawn_child(const char *executable, char *const *argv,
+                       bool detach, pid_t *pid)
 {
-    int retval = -1;
+    const uint64_t trace_begin = TRACE_BEGIN();
+    posix_spawnattr_t attr;
+    int retval;
+
+    if (!detach) {
+        retval = posix_spawnp_inf(pid, executable, NULL, argv);
+    } else {
+        /* A session of it's own, so it doesn't get the terminal's signals.
+           It's reaped by reap_detached(), or by init after the program. */
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+        retval = posix_spawnp_inf(pid, executable, &attr, argv);
+        posix_spawnattr_destroy(&attr);
+    }
+    TRACE_END("spawn", executable, trace_begin);
+
+    return retval;
+}
+
+
+/*
+ * Return 1 if the child exited normally and it's exit status isn't 127,
+ * otherwise 0. The exit status of 127 is the value set by the shell when
+ * a command is not found and the recommended exit status by POSIX in
+ * these situations.
+ */
+static bool child_succeeded(int wstatus)
+{
+    return WIFEXITED(wstatus) && WEXITSTATUS(wstatus) != 127;
+}
+
+
+/*
+ * Execute the executable with the given argv, searching for it in PATH
+ * like execvp(), and wait for it to exit.
+ */
+int execvp_process(const char *executable, char *const *argv)
+{
+    uint64_t trace_begin;
     int wstatus;
     pid_t pid;
 
-    pid = fork_inf();
+    if (spawn_child(executable, argv, 0, &pid))
+        return -1;
+
+    /* Wait for child with process id of pid to get terminated
+       or change its state. Then continue executing the parent
+       process.                                                */
+    trace_begin = TRACE_BEGIN();
+    if (waitpid_inf(pid, &wstatus, 0) == -1)
+        return -1;
+    TRACE_END("wait", executable, trace_begin);
+
+    return child_succeeded(wstatus) ? 0 : -1;
+}
+
+
+/*
+ * Allocate a launcher for executing several programs at once. If detach
+ * is 1, they're detached from the program instead of being waited for.
+ */
+struct launcher *alloc_launcher(bool detach)
+{
+    struct launcher *launcher;
+
+    if (!(launcher = malloc_inf(sizeof(struct launcher))))
+        return NULL;
+
+    launcher->children = NULL;
+    launcher->len = 0;
+    launcher->size = 0;
+    launcher->detach = detach;
+    launcher->epoll_fd = -1;
+
+    if (!detach && (launcher->epoll_fd = epoll_create1_inf(EPOLL_CLOEXEC)) == -1) {
+        free_inf(launcher);
+        return NULL;
+    }
+
+    return launcher;
+}
+
+
+static int grow_children(struct launcher *launcher)
+{
+    const unsigned int new_size = launcher->size ? launcher->size * 2 : 8;
+    struct launched_child *children;
+
+    if (!(children = reallocarray_inf(launcher->children, new_size,
+                                      sizeof(struct launched_child))))
+        return -1;
+
+    launcher->children = children;
+    launcher->size = new_size;
+
+    return 0;
+}
+
+
+/*
+ * Keep track of the child with a pidfd in the epoll instance. If that's
+ * not possible, e.g. on kernels older than 5.3, it's waited for with
+ * waitpid() after the others.
+ */
+static void watch_child(struct launcher *launcher, pid_t pid)
+{
+    struct launched_child *child = &launcher->children[launcher->len];
+    struct epoll_event event;
+
+    child->pid = pid;
+
+    /* The pidfd has the close-on-exec flag set */
+    if ((child->pidfd = syscall(SYS_pidfd_open, pid, 0)) != -1) {
+        event.events = EPOLLIN;
+        event.data.u32 = launcher->len;
+
+        if (epoll_ctl(launcher->epoll_fd, EPOLL_CTL_ADD, child->pidfd, &event)) {
+            close(child->pidfd);
+            child->pidfd = -1;
+        }
+    }
+    launcher->len++;
+}
+
+
+/*
+ * Forget the detached children that exited, reaping them. Must be
+ * called with the detached_lock held.
+ */
+static void reap_exited_detached(void)
+{
+    unsigned int len = 0;
+    unsigned int i;
+
+    /* A child that's not ours anymore is forgotten as well */
+    for (i=0; i<detached_len; i++)
+        if (!waitpid(detached_pids[i], NULL, WNOHANG))
+            detached_pids[len++] = detached_pids[i];
+
+    detached_len = len;
+}
+
+
+/*
+ * Reap the detached children that exited since they were launched.
+ */
+void reap_detached(void)
+{
+    pthread_mutex_lock(&detached_lock);
+    reap_exited_detached();
+    pthread_mutex_unlock(&detached_lock);
+}
+
+
+static int launch_detached(const char *executable, char *const *argv)
+{
+    const unsigned int new_size = detached_size ? detached_size * 2 : 8;
+    int retval = -1;
+    pid_t *pids;
+    pid_t pid;
+
+    pthread_mutex_lock(&detached_lock);
+    reap_exited_detached();
+
+    /* Make room before spawning, so a child is never left unreaped */
+    if (detached_len == detached_size) {
+        if (!(pids = reallocarray_inf(detached_pids, new_size, sizeof(pid_t))))
+            goto unlock;
+        detached_pids = pids;
+        detached_size = new_size;
+    }
 
-    /* Child Process */
-    if (pid == 0) {
-        if (execvp_inf(executable, argv))
-        /* The exit status of 127 is the value set by the shell 
-           when a command is not found and the recommended exit 
-           status by POSIX in these situations.                 */
-            _Exit(127);
+    if (!spawn_child(executable, argv, 1, &pid)) {
+        detached_pids[detached_len++] = pid;
+        retval = 0;
     }
-    
-    /* Parent Process */
-    else if (pid > 0)
-        /* Wait for child with process id of pid to get terminated 
-           or change its state. Then continue executing the parent
-           process.                                                */
-        if (waitpid_inf(pid, &wstatus, 0) != -1)
-            /* If child exited normally and it's exit 
-               status isn't 127. See comment on line 30 */
-            if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) != 127)
-                retval = 0;
-    
-    return retval; 
+
+unlock:
+    pthread_mutex_unlock(&detached_lock);
+
+    return retval;
 }
 
+
+/*
+ * Start executing the executable with the given argv without waiting
+ * for it to exit. Return -1 if it couldn't be executed, otherwise 0.
+ */
+int launch_process(struct launcher *launcher, const char *executable,
+                   char *const *argv)
+{
+    pid_t pid;
+
+    if (launcher->detach)
+        return launch_detached(executable, argv);
+
+    /* Make room before forking, so a child is never left untracked */
+    if (launcher->len == launcher->size)
+        if (grow_children(launcher))
+            return -1;
+
+    if (spawn_child(executable, argv, 0, &pid))
+        return -1;
+
+    watch_child(launcher, pid);
+
+    return 0;
+}
+
+
+static int reap_child(struct launcher *launcher, struct launched_child *child)
+{
+    int wstatus;
+    int retval = -1;
+
+    if (waitpid_inf(child->pid, &wstatus, 0) != -1 && child_succeeded(wstatus))
+        retval = 0;
+
+    /* Closing it isn't enough, while any copy of it is still open it
+       stays in the epoll instance and would be reported again.       */
+    if (child->pidfd != -1) {
+        epoll_ctl(launcher->epoll_fd, EPOLL_CTL_DEL, child->pidfd, NULL);
+        close(child->pidfd);
+        child->pidfd = -1;
+    }
+
+    child->pid = 0;
+
+    return retval;
+}
+
+
+/*
+ * Wait for all the launched children to exit, in the order they exit.
+ * Return -1 if any of them failed, otherwise 0.
+ */
+int wait_launched(struct launcher *launcher)
+{
+    const uint64_t trace_begin = TRACE_BEGIN();
+    struct epoll_event events[EPOLL_EVENTS_MAX];
+    struct launched_child *child;
+    unsigned int watched = 0;
+    unsigned int i;
+    int retval = 0;
+    int ret;
+
+    for (i=0; i<launcher->len; i++)
+        if (launcher->children[i].pidfd != -1)
+            watched++;
+
+    while (watched) {
+        if ((ret = epoll_wait(launcher->epoll_fd, events, 
+                              EPOLL_EVENTS_MAX, -1)) == -1) {
+            if (errno == EINTR)
+                continue;
+            /* The rest are waited for below */
+            break;
+        }
+
+        for (i=0; i<(unsigned int) ret; i++) {
+            child = &launcher->children[events[i].data.u32];
+
+            /* Already reaped */
+            if (!child->pid)
+                continue;
+
+            if (reap_child(launcher, child))
+                retval = -1;
+            watched--;
+        }
+    }
+
+    /* The children that couldn't be watched */
+    for (i=0; i<launcher->len; i++)
+        if (launcher->children[i].pid && reap_child(launcher, &launcher->children[i]))
+            retval = -1;
+
+    launcher->len = 0;
+    TRACE_END("wait", NULL, trace_begin);
+
+    return retval;
+}
+
+
+void free_launcher(struct launcher *launcher)
+{
+    if (launcher->epoll_fd != -1)
+        close(launcher->epoll_fd);
+
+    free_inf(launcher->children);
+    free_inf(launcher);
+}
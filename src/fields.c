@@ -0,0 +1,307 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for printing  |
+| the documents as machine readable records, either     |
+| plain fields or JSON lines.                           |
+---------------------------------------------------------
+*/
+
+#include <string.h>
+#include "output.h"
+#include "fields.h"
+
+
+static const char *const fields_names[] = {
+	[FIELD_PATH] = "path",
+	[FIELD_NAME] = "name",
+	[FIELD_SIZE] = "size",
+	[FIELD_MTIME] = "mtime",
+	[FIELD_MODE] = "mode"
+};
+
+
+/* Static Functions Prototype */
+static int parse_field(enum doc_field *, const char *, size_t);
+static bool record_needs_stat(const struct record_spec *);
+static size_t utf8_seq_len(const unsigned char *);
+static void print_json_str(const char *);
+static void print_mode_octal(const mode_t);
+static void print_field_value(const struct mdoc_doc *, const struct stat *, enum doc_field, bool);
+static void print_group_field(const struct record_group *, const struct record_spec *);
+
+
+
+/*
+ * Parse a comma separated list of fields, e.g. "path,size,mtime".
+ */
+int parse_fields_spec(struct record_spec *spec, const char *str)
+{
+	const char *end;
+
+	for (spec->fields_num=0; ; str=end+1) {
+		if (!(end = strchr(str, ',')))
+			end = str + strlen(str);
+
+		if (spec->fields_num == FIELDS_MAX ||
+		    parse_field(&spec->fields[spec->fields_num++], str, end - str))
+			return -1;
+
+		if (*end == '\0')
+			break;
+	}
+
+	return 0;
+}
+
+
+static int parse_field(enum doc_field *field, const char *str, size_t len)
+{
+	unsigned int i;
+
+	for (i=0; i<sizeof(fields_names)/sizeof(fields_names[0]); i++)
+		if (strlen(fields_names[i]) == len && strncmp(fields_names[i], str, len) == 0) {
+			*field = i;
+			return 0;
+		}
+
+	return -1;
+}
+
+
+/*
+ * Return 1 if any of the fields needs the document's metadata,
+ * otherwise 0.
+ */
+static bool record_needs_stat(const struct record_spec *spec)
+{
+	unsigned int i;
+
+	for (i=0; i<spec->fields_num; i++)
+		if (spec->fields[i] != FIELD_PATH && spec->fields[i] != FIELD_NAME)
+			return 1;
+
+	return 0;
+}
+
+
+/*
+ * Return the length of the valid UTF-8 sequence str starts with, which
+ * isn't ASCII, or 0 if it's invalid. The overlong forms, the surrogates
+ * and what's beyond U+10FFFF are invalid too. The terminating null byte
+ * isn't a continuation byte, so a truncated sequence is never read past.
+ */
+static size_t utf8_seq_len(const unsigned char *str)
+{
+	unsigned char min = 0x80;
+	unsigned char max = 0xbf;
+	size_t len;
+	size_t i;
+
+	if (str[0] >= 0xc2 && str[0] <= 0xdf) {
+		len = 2;
+	} else if (str[0] >= 0xe0 && str[0] <= 0xef) {
+		len = 3;
+		if (str[0] == 0xe0)
+			min = 0xa0;
+		else if (str[0] == 0xed)
+			max = 0x9f;
+	} else if (str[0] >= 0xf0 && str[0] <= 0xf4) {
+		len = 4;
+		if (str[0] == 0xf0)
+			min = 0x90;
+		else if (str[0] == 0xf4)
+			max = 0x8f;
+	} else {
+		return 0;
+	}
+
+	/* Only the second byte's range depends on the first one */
+	for (i=1; i<len; i++, min=0x80, max=0xbf)
+		if (str[i] < min || str[i] > max)
+			return 0;
+
+	return len;
+}
+
+
+/*
+ * Print str as a JSON string. The valid UTF-8 sequences are passed as
+ * they are, so the names stay readable, while every byte of an invalid
+ * one is replaced with U+FFFD, so the output is still valid JSON.
+ */
+static void print_json_str(const char *str)
+{
+	const char hex[] = "0123456789abcdef";
+	const char *start;
+	size_t len;
+
+	out_char('"');
+
+	for (start=str; *str; str++) {
+		if ((unsigned char) *str >= 0x80) {
+			if ((len = utf8_seq_len((const unsigned char *) str))) {
+				str += len - 1;
+				continue;
+			}
+
+			out_write(start, str - start);
+			start = str + 1;
+			OUT_LITERAL("\\ufffd");
+			continue;
+		}
+
+		if (*str != '"' && *str != '\\' && (unsigned char) *str >= 0x20)
+			continue;
+
+		/* Write the run that doesn't need escaping at once */
+		out_write(start, str - start);
+		start = str + 1;
+
+		out_char('\\');
+		switch (*str) {
+		case '"':
+		case '\\':
+			out_char(*str);
+			break;
+		case '\n':
+			out_char('n');
+			break;
+		case '\t':
+			out_char('t');
+			break;
+		default:
+			OUT_LITERAL("u00");
+			out_char(hex[(unsigned char) *str >> 4]);
+			out_char(hex[*str & 0xf]);
+		}
+	}
+	out_write(start, str - start);
+	out_char('"');
+}
+
+
+/*
+ * Print the permission bits, with the setuid, setgid and sticky ones, in
+ * four octal digits, e.g. "0644" or "4755".
+ */
+static void print_mode_octal(const mode_t mode)
+{
+	out_char('0' + ((mode >> 9) & 07));
+	out_char('0' + ((mode >> 6) & 07));
+	out_char('0' + ((mode >> 3) & 07));
+	out_char('0' + (mode & 07));
+}
+
+
+static void print_field_value(const struct mdoc_doc *doc, const struct stat *stbuf,
+							  enum doc_field field, bool json)
+{
+	switch (field) {
+	case FIELD_PATH:
+	case FIELD_NAME:
+		if (json)
+			print_json_str((field == FIELD_PATH) ? mdoc_doc_path(doc) : mdoc_doc_name(doc));
+		else
+			out_str((field == FIELD_PATH) ? mdoc_doc_path(doc) : mdoc_doc_name(doc));
+		break;
+	case FIELD_SIZE:
+		out_uint(stbuf->st_size);
+		break;
+	case FIELD_MTIME:
+		out_int(stbuf->st_mtime);
+		break;
+	case FIELD_MODE:
+		if (json)
+			out_char('"');
+		print_mode_octal(stbuf->st_mode);
+		if (json)
+			out_char('"');
+		break;
+	}
+}
+
+
+/*
+ * Print the field of the record's group before it's own fields.
+ */
+static void print_group_field(const struct record_group *group, const struct record_spec *spec)
+{
+	if (spec->json) {
+		out_char('"');
+		out_str(group->name);
+		OUT_LITERAL("\":");
+	}
+
+	if (group->str && spec->json)
+		print_json_str(group->str);
+	else if (group->str)
+		out_str(group->str);
+	else
+		out_uint(group->num);
+
+	out_char(spec->json ? ',' : '\t');
+}
+
+
+/*
+ * Print the document's fields either separated by tabs or as a JSON
+ * object, after the group's field if it's not NULL. The metadata is fetched
+ * only if a field needs it.
+ */
+int print_doc_record(struct mdoc_doc *doc, const struct record_spec *spec,
+					 const struct record_group *group)
+{
+	const struct stat *stbuf = NULL;
+	unsigned int i;
+
+	if (record_needs_stat(spec) && !(stbuf = mdoc_doc_stat(doc)))
+		return -1;
+
+	if (spec->json)
+		out_char('{');
+
+	if (group)
+		print_group_field(group, spec);
+
+	for (i=0; i<spec->fields_num; i++) {
+		if (i)
+			out_char(spec->json ? ',' : '\t');
+
+		if (spec->json) {
+			out_char('"');
+			out_str(fields_names[spec->fields[i]]);
+			OUT_LITERAL("\":");
+		}
+		print_field_value(doc, stbuf, spec->fields[i], spec->json);
+	}
+
+	if (spec->json)
+		out_char('}');
+
+	out_char(spec->terminator);
+
+	return 0;
+}
+
+
+void print_docs_num_record(const unsigned int docs_num, const struct record_spec *spec,
+						   const struct record_group *group)
+{
+	if (spec->json)
+		out_char('{');
+
+	if (group)
+		print_group_field(group, spec);
+
+	if (spec->json)
+		OUT_LITERAL("\"count\":");
+
+	out_uint(docs_num);
+
+	if (spec->json)
+		out_char('}');
+
+	out_char(spec->terminator);
+}
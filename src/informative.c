@@ -13,31 +13,179 @@
 */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
+#include <sys/epoll.h>
 #include "informative.h"
+#include "stats.h"
+
+/* The longest error message kept, the longer ones are truncated */
+#define ERROR_MSG_MAX 512
+
+
+/* The environment passed to the spawned programs */
+extern char **environ;
+
+/* The name the errors are printed with, set by the program */
+char *prog_name_inf = "mdoc";
+
+/* If set, it's called with the message of every error, from any thread */
+static void (*error_handler)(const char *, void *);
+static void *error_handler_arg;
+
+/* The calling thread's last error and the errno it came with */
+static _Thread_local char last_error[ERROR_MSG_MAX];
+static _Thread_local int last_error_errno;
+
+
+/* Static Functions Prototype */
+static int check_mem_limit(size_t, size_t);
+
+
+
+/*
+ * Set the handler called with the errors' messages, e.g. to print them.
+ * Without one the errors are only kept, see get_last_error_inf().
+ */
+void set_error_handler_inf(void (*handler)(const char *, void *), void *arg) 
+{
+	error_handler = handler;
+	error_handler_arg = arg;
+}
+
+
+/*
+ * Keep the message of an error, which is formatted like printf() without
+ * the program's name nor a new line, and pass it to the error handler.
+ * errno is left as it was, and kept with the message.
+ */
+void error_inf(const char *format, ...) 
+{
+	const int saved_errno = errno;
+	va_list ap;
+
+	va_start(ap, format);
+	vsnprintf(last_error, ERROR_MSG_MAX, format, ap);
+	va_end(ap);
+
+	last_error_errno = saved_errno;
+
+	if (error_handler)
+		error_handler(last_error, error_handler_arg);
+
+	errno = saved_errno;
+}
+
+
+void clear_error_inf(void) 
+{
+	*last_error = '\0';
+	last_error_errno = 0;
+}
+
+
+/*
+ * Return the calling thread's last error message, or "" if none
+ * occurred since clear_error_inf().
+ */
+const char *get_last_error_inf(void) 
+{
+	return last_error;
+}
+
+
+int get_last_errno_inf(void) 
+{
+	return last_error_errno;
+}
+
+
+/*
+ * Return 0 if size bytes can be allocated in place of the old_size
+ * live ones without exceeding the --mem-limit, otherwise -1.
+ */
+static int check_mem_limit(size_t size, size_t old_size) 
+{
+	if (!memstats_exceeds((size > old_size) ? size - old_size : 0))
+		return 0;
+
+	errno = ENOMEM;
+	error_inf("can't allocate memory: The memory limit of %zu bytes was reached", 
+			  memstats_get_limit());
+
+	return -1;
+}
 
 
 void *malloc_inf(size_t size) 
+{
+	return malloc_site_inf(size, MEM_SITE_OTHER);
+}
+
+
+void *malloc_site_inf(size_t size, enum mem_site site) 
 {
 	void *ptr;
 
+	STATS_COUNT(STATS_ALLOCS, 1);
+	STATS_COUNT(STATS_ALLOC_BYTES, size);
+
+	if (memstats_on && check_mem_limit(size, 0))
+		return NULL;
+
 	if (!(ptr = malloc(size)))
-		fprintf(stderr, "%s: can't allocate memory: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't allocate memory: %s", strerror(errno));
+	else if (memstats_on)
+		memstats_alloced(site, size, malloc_usable_size(ptr));
 
 	return ptr;
 }
 
 
+void *calloc_inf(size_t nmemb, size_t size) 
+{
+	void *ptr;
+
+	STATS_COUNT(STATS_ALLOCS, 1);
+	STATS_COUNT(STATS_ALLOC_BYTES, nmemb * size);
+
+	if (memstats_on && check_mem_limit(nmemb * size, 0))
+		return NULL;
+
+	if (!(ptr = calloc(nmemb, size)))
+		error_inf("can't allocate memory: %s", strerror(errno));
+	else if (memstats_on)
+		memstats_alloced(MEM_SITE_OTHER, nmemb * size, malloc_usable_size(ptr));
+
+	return ptr;
+}
+
+
+/*
+ * Free ptr, which must have been allocated by one of the *_inf() wrappers.
+ */
+void free_inf(void *ptr) 
+{
+	if (memstats_on && ptr)
+		memstats_freed(malloc_usable_size(ptr));
+
+	free(ptr);
+}
+
+
 char *fgets_inf(char *str, int size, FILE *stream) 
 {
 	char *retval;
 
 	if (!(retval = fgets(str, size, stream)))
-		fprintf(stderr, "%s: can't read input\n", prog_name_inf);
+		error_inf("can't read input");
 
 	return retval;
 }
@@ -48,8 +196,7 @@ FILE *fopen_inf(const char *pathname, const char *mode)
 	FILE *fp;
 
 	if (!(fp = fopen(pathname, mode)))
-		fprintf(stderr, "%s: can't open '%s': %s\n", 
-				prog_name_inf, pathname, strerror(errno));
+		error_inf("can't open '%s': %s", pathname, strerror(errno));
 	
 	return fp;
 }
@@ -60,8 +207,7 @@ int fclose_inf(FILE *fp)
 	int retval;
 
 	if ((retval = fclose(fp)))
-		fprintf(stderr, "%s: can't close file: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't close file: %s", strerror(errno));
 
 	return retval;
 }
@@ -71,9 +217,10 @@ DIR *opendir_inf(const char *path)
 {
 	DIR *dp;
 
+	STATS_COUNT(STATS_DIRS_OPENED, 1);
+
 	if (!(dp = opendir(path)))
-		fprintf(stderr, "%s: can't open '%s': %s\n", 
-				prog_name_inf, path, strerror(errno));
+		error_inf("can't open '%s': %s", path, strerror(errno));
 
 	return dp;
 }
@@ -84,8 +231,42 @@ int closedir_inf(DIR *dp)
 	int retval;
 
 	if ((retval = closedir(dp)))
-		fprintf(stderr, "%s: can't close directory: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't close directory: %s", strerror(errno));
+
+	return retval;
+}
+
+
+int open_inf(const char *pathname, int flags) 
+{
+	int fd;
+
+	if ((fd = open(pathname, flags)) == -1)
+		error_inf("can't open '%s': %s", pathname, strerror(errno));
+	
+	return fd;
+}
+
+
+ssize_t read_inf(int fd, void *buf, size_t count) 
+{
+	ssize_t retval;
+
+	if ((retval = read(fd, buf, count)) == -1)
+		error_inf("can't read file: %s", strerror(errno));
+
+	return retval;
+}
+
+
+int fstat_inf(int fd, struct stat *statbuf) 
+{
+	int retval;
+
+	STATS_COUNT(STATS_STATS, 1);
+
+	if ((retval = fstat(fd, statbuf)))
+		error_inf("can't get info on file: %s", strerror(errno));
 
 	return retval;
 }
@@ -95,21 +276,28 @@ int stat_inf(const char *pathname, struct stat *statbuf)
 {
 	int retval;
 
+	STATS_COUNT(STATS_STATS, 1);
+
 	if ((retval = stat(pathname, statbuf)))
-		fprintf(stderr, "%s: can't get info on '%s': %s\n", 
-				prog_name_inf, pathname, strerror(errno));
+		error_inf("can't get info on '%s': %s", pathname, strerror(errno));
 
 	return retval;
 }
 
 
+/*
+ * errno is cleared before every readdir(), so the end of the stream
+ * isn't taken for an error left by the calls made between them.
+ */
 struct dirent *readdir_inf(DIR *dp) 
 {
 	struct dirent *entry;
 
+	errno = 0;
 	if (!(entry = readdir(dp)) && errno)
-		fprintf(stderr, "%s: can't read file's entry: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't read file's entry: %s", strerror(errno));
+	else if (entry)
+		STATS_COUNT(STATS_ENTRIES_READ, 1);
 
 	return entry;
 }
@@ -120,8 +308,7 @@ pid_t fork_inf(void)
 	pid_t retval;
 	
 	if ((retval = fork()) == -1)
-		fprintf(stderr, "%s: can't fork new child process: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't fork new child process: %s", strerror(errno));
 
 	return retval;
 }
@@ -132,8 +319,7 @@ pid_t waitpid_inf(pid_t pid, int *wstatus, int options)
 	pid_t retval; 
 
 	if ((retval = waitpid(pid, wstatus, options)) == -1)
-		fprintf(stderr, "%s: can't wait for state in the new child process: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't wait for state in the new child process: %s", strerror(errno));
 
 	return retval;
 }
@@ -144,8 +330,7 @@ int execv_inf(const char *pathname, char *const *argv)
 	int retval = 0;
 
 	if ((retval = execv(pathname, argv)) == -1)
-		fprintf(stderr, "%s: can't execute '%s': %s\n", 
-				prog_name_inf, pathname, strerror(errno));
+		error_inf("can't execute '%s': %s", pathname, strerror(errno));
 
 	return retval;
 }
@@ -153,11 +338,25 @@ int execv_inf(const char *pathname, char *const *argv)
 
 void *realloc_inf(void *ptr, size_t size) 
 {
+	return realloc_site_inf(ptr, size, MEM_SITE_OTHER);
+}
+
+
+void *realloc_site_inf(void *ptr, size_t size, enum mem_site site) 
+{
+	const size_t old_size = (memstats_on && ptr) ? malloc_usable_size(ptr) : 0;
 	void *retval;
 
+	STATS_COUNT(STATS_ALLOCS, 1);
+	STATS_COUNT(STATS_ALLOC_BYTES, size);
+
+	if (memstats_on && check_mem_limit(size, old_size))
+		return NULL;
+
 	if (!(retval = realloc(ptr, size)))
-		fprintf(stderr, "%s: can't allocate memory: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't allocate memory: %s", strerror(errno));
+	else if (memstats_on)
+		memstats_alloced(site, size, (long long) malloc_usable_size(retval) - old_size);
 
 	return retval;
 }
@@ -168,8 +367,7 @@ int execvp_inf(const char *file, char *const *argv)
 	int retval = 0;
 
 	if ((retval = execvp(file, argv)) == -1)
-		fprintf(stderr, "%s: can't execute '%s': %s\n", 
-				prog_name_inf, file, strerror(errno));
+		error_inf("can't execute '%s': %s", file, strerror(errno));
 
 	return retval;
 }
@@ -177,11 +375,20 @@ int execvp_inf(const char *file, char *const *argv)
 
 void *reallocarray_inf(void *ptr, size_t nmemb, size_t size) 
 {
+	const size_t old_size = (memstats_on && ptr) ? malloc_usable_size(ptr) : 0;
 	void *retval;
 
+	STATS_COUNT(STATS_ALLOCS, 1);
+	STATS_COUNT(STATS_ALLOC_BYTES, nmemb * size);
+
+	if (memstats_on && check_mem_limit(nmemb * size, old_size))
+		return NULL;
+
 	if (!(retval = reallocarray(ptr, nmemb, size)))
-		fprintf(stderr, "%s: can't allocate memory: %s\n", 
-				prog_name_inf, strerror(errno));
+		error_inf("can't allocate memory: %s", strerror(errno));
+	else if (memstats_on)
+		memstats_alloced(MEM_SITE_OTHER, nmemb * size, 
+						 (long long) malloc_usable_size(retval) - old_size);
 
 	return retval;
 }
@@ -192,20 +399,58 @@ char *getenv_inf(const char *name)
 	char *retval;
 
 	if (!(retval = getenv(name)))
-		fprintf(stderr, "%s: couldn't find '%s' environment variable\n", 
-				prog_name_inf, name);
+		error_inf("couldn't find '%s' environment variable", name);
 
 	return retval;
 }
 
 
-char *ctime_r_inf(const time_t *timep, char *buf) 
+struct tm *localtime_r_inf(const time_t *timep, struct tm *result) 
 {
-	char *retval;
+	struct tm *retval;
+
+	if (!(retval = localtime_r(timep, result)))
+		error_inf("couldn't convert time: %s", strerror(errno));
+
+	return retval;
+}
+
+
+ssize_t writev_inf(int fd, const struct iovec *iov, int iovcnt) 
+{
+	ssize_t retval;
+
+	STATS_COUNT(STATS_WRITES, 1);
+
+	if ((retval = writev(fd, iov, iovcnt)) == -1)
+		error_inf("can't write output: %s", strerror(errno));
+
+	return retval;
+}
+
+
+int epoll_create1_inf(int flags) 
+{
+	int retval;
+
+	if ((retval = epoll_create1(flags)) == -1)
+		error_inf("can't create epoll instance: %s", strerror(errno));
+
+	return retval;
+}
+
+
+
+int posix_spawnp_inf(pid_t *pid, const char *file, 
+					 const posix_spawnattr_t *attrp, char *const *argv) 
+{
+	int retval;
 
-	if (!(retval = ctime_r(timep, buf)))
-		fprintf(stderr, "%s: couldn't convert time: %s\n", 
-				prog_name_inf, strerror(errno));
+	if ((retval = posix_spawnp(pid, file, NULL, attrp, argv, environ))) {
+		errno = retval;
+		error_inf("can't execute '%s': %s", file, strerror(retval));
+		retval = -1;
+	}
 
 	return retval;
 }
@@ -12,6 +12,8 @@
 #include "informative.h"
 #include "input.h"
 
+#define LINE_INIT_SIZE 128
+
 
 /* Static Functions Prototype */
 static bool end_of_input(const int);
@@ -28,41 +30,37 @@ static bool end_of_input(const int c)
 
 
 /*
- * Get a line of input from stream without limiting it's size.
+ * Get a line of input from stream without limiting it's size. The
+ * buffer's size is doubled when it's full, instead of reallocating
+ * it for every char.
  */
 char *get_line(FILE *stream) 
 {
-	char *line_address = NULL;
+	size_t size = LINE_INIT_SIZE;
 	char *line = NULL;
-	unsigned int i;
+	char *new_line;
+	size_t i;
 	int c;
 
-	for (i=0; (c = getc(stream)); i++) {
-		if (end_of_input(c))
-			break;
-		
-		if (!(line = realloc_inf(line, sizeof(char) * (i+1))))
-			goto error;
+	for (i=0; !end_of_input(c = getc(stream)); i++) {
+		if (!line || i+1 == size) {
+			if (line)
+				size *= 2;
 
-		line[i] = c;
-		/* 
-		 * Save the address of line in case realloc_inf() overwrote it 
-		 * with NULL, so cleanup can be done.                                               
-		 */
-		line_address = line;
-	}	
-	if (line) {
-		if (!(line = realloc_inf(line, sizeof(char) * (i+1))))	
-			goto error;
+			if (!(new_line = realloc_site_inf(line, sizeof(char) * size, MEM_SITE_LINE)))
+				goto error;
 
-		line[i] = '\0';	
+			line = new_line;
+		}
+		line[i] = c;
 	}
+	if (line)
+		line[i] = '\0';
 
 	return line;
 
 error:
-	if (line_address)
-		free(line_address);
+	free_inf(line);
 
 	return NULL;
 }
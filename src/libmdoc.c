@@ -0,0 +1,1772 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions of libmdoc,   |
+| the search engine's interface for the programs that   |
+| embed it, the mdoc program included.                  |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "exec.h"
+#include "cache.h"
+#include "informative.h"
+#include "config.h"
+#include "mdoc.h"
+#include "sort.h"
+#include "stats.h"
+#include "trace.h"
+#include "watch.h"
+#include "patterns.h"
+#include "dupes.h"
+#include "libmdoc.h"
+
+/* The initial sizes of an index's buffers, doubled when they're full */
+#define INDEX_DOCS_INIT 1024
+#define INDEX_PATHS_INIT (64 * 1024)
+
+
+struct mdoc_ctx {
+	struct users_configs *configs;
+	/* If not NULL, the directory the queries are cached in */
+	char *cache_dir;
+};
+
+/* Never changed by a search, which copies what it needs */
+struct mdoc_query {
+	char *str;
+	unsigned int flags;
+	unsigned int limit;
+	struct sort_spec sort;
+	struct query_filter filter;
+};
+
+/* The found documents, in the order they're listed in */
+struct mdoc_results {
+	struct doc_list *list;
+	unsigned int num;
+	/*
+	 * If the documents were found in an index or a cache, the array of
+	 * their nodes, which point to shared paths instead of owning their own.
+	 */
+	struct doc_list *nodes;
+	unsigned int nodes_num;
+	/* The buffer of the nodes' paths, if they're the results' own */
+	char *paths;
+};
+
+/* A document of an index, it's path is kept in the index's paths */
+struct index_doc {
+	size_t path;
+	/* The offset of the name in the path */
+	unsigned int name;
+};
+
+/*
+ * The documents of a scan, kept compact: all the paths in one buffer
+ * and a small entry each, instead of a node and two blocks each.
+ */
+struct mdoc_index {
+	char *paths;
+	size_t paths_len;
+	size_t paths_size;
+	struct index_doc *docs;
+	unsigned int docs_num;
+	unsigned int docs_size;
+};
+
+/* A document is it's doc_list node, so the lists need no copying */
+struct mdoc_doc {
+	struct doc_list node;
+};
+
+/* The user's callback of a streaming search */
+struct search_call {
+	int (*fn)(struct mdoc_doc *, void *);
+	void *arg;
+	bool failed;
+};
+
+/* The user's callback of a watch, passed only the new documents */
+struct watch_call {
+	struct doc_watch *watch;
+	struct search_call call;
+};
+
+/* The queries of a batch, searched for at once */
+struct batch_call {
+	const struct mdoc_query *const *queries;
+	unsigned int queries_num;
+	struct pattern_set *patterns;
+	/* match_patterns()'s buffers, a slot per query */
+	unsigned int *ids;
+	bool *matched;
+	/* Either the number of documents of each query, or the documents themselves */
+	unsigned int *nums;
+	struct mdoc_index *indexes;
+};
+
+/* The sets of the documents with the same content */
+struct mdoc_dupes {
+	/* The first document of each set, the rest are linked after it */
+	struct doc_list **sets;
+	unsigned int sets_num;
+};
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static void start_call(void);
+static enum mdoc_status get_call_status(bool);
+static char *get_config_path(const char *);
+static char *get_cache_dir(const char *);
+static void init_search(struct search_ctx *, const struct mdoc_query *);
+static bool query_streams(const struct mdoc_query *);
+static bool query_cached(const struct mdoc_ctx *, const struct mdoc_query *);
+static int call_doc_fn(struct doc_list *, void *);
+static int discard_doc(struct doc_list *, void *);
+static int call_new_doc_fn(struct doc_list *, void *);
+static struct doc_list *search_docs(const struct mdoc_ctx *, struct search_ctx *);
+static struct doc_list *rearrange_doc_list(struct doc_list *, const struct mdoc_query *);
+static int stamp_dir(const struct search_ctx *, const char *, int, int);
+static int find_cached_docs(const struct mdoc_ctx *, const struct mdoc_query *,
+							struct query_cache *);
+static enum mdoc_status search_cached(const struct mdoc_ctx *, const struct mdoc_query *,
+									  int (*)(struct mdoc_doc *, void *), void *);
+static enum mdoc_status search_results_cached(const struct mdoc_ctx *,
+											  const struct mdoc_query *,
+											  struct mdoc_results **);
+static void set_doc_node(struct doc_list *, const char *);
+static int grow_index(struct mdoc_index *, size_t);
+static int add_index_doc(struct mdoc_doc *, void *);
+static void shrink_index(struct mdoc_index *);
+static bool index_doc_matches(const struct mdoc_index *, unsigned int, const struct search_plan *,
+							  const struct mdoc_query *);
+static void set_index_node(const struct mdoc_index *, unsigned int, struct doc_list *);
+static int save_node(struct doc_list **, unsigned int *, unsigned int *, const char *);
+static struct doc_list *link_nodes(struct doc_list *, unsigned int);
+static struct doc_list *cut_doc_list(struct doc_list *, unsigned int);
+static int arrange_nodes(struct mdoc_results *, const struct mdoc_query *);
+static int take_index_results(struct mdoc_index *, const struct mdoc_query *,
+							  struct mdoc_results **);
+static int add_batch_doc(struct doc_list *, void *);
+static bool batch_queries_match(const struct mdoc_query *const *, unsigned int);
+static enum mdoc_status search_batch(const struct mdoc_ctx *, struct batch_call *);
+static int open_dupes_hashes(const struct mdoc_ctx *, struct hash_cache *);
+
+
+
+/*
+ * Reset the errors of the calling thread, at the start of every
+ * function that can fail.
+ */
+static void start_call(void)
+{
+	prev_error = 0;
+	clear_error_inf();
+}
+
+
+/*
+ * Return the status of the call by the last error it kept, or
+ * MDOC_ERR_CALLBACK if none was kept and a callback failed.
+ */
+static enum mdoc_status get_call_status(bool callback_failed)
+{
+	if (*get_last_error_inf())
+		return (get_last_errno_inf() == ENOMEM) ?
+			MDOC_ERR_NOMEM : MDOC_ERR_SYSTEM;
+
+	return callback_failed ?
+		MDOC_ERR_CALLBACK : MDOC_ERR_SYSTEM;
+}
+
+
+/*
+ * Return a copy of path, or $HOME/.config/mdoc if it's NULL.
+ */
+static char *get_config_path(const char *path)
+{
+	const char config[] = ".config/mdoc";
+	char *config_path = NULL;
+	char *home;
+	size_t len;
+
+	if (path) {
+		len = strlen(path) + 1;
+		if ((config_path = malloc_inf(sizeof(char) * len)))
+			memcpy(config_path, path, len);
+
+	} else if ((home = getenv_inf("HOME"))) {
+		len = strlen(config) + strlen(home) + 2;
+
+		if ((config_path = malloc_inf(sizeof(char) * len)))
+			snprintf(config_path, len, "%s/%s", home, config);
+	}
+
+	return config_path;
+}
+
+
+/*
+ * Read the configurations from the file at config_path, or from the
+ * default one if it's NULL, into a new context.
+ */
+enum mdoc_status mdoc_ctx_new(struct mdoc_ctx **ctx, const char *config_path)
+{
+	const uint64_t trace_begin = TRACE_BEGIN();
+	enum mdoc_status status = MDOC_OK;
+	char *path;
+
+	start_call();
+	stats_enter(STATS_CONFIG);
+
+	if (!(*ctx = calloc_inf(1, sizeof(struct mdoc_ctx)))) {
+		status = MDOC_ERR_NOMEM;
+	} else if (!(path = get_config_path(config_path))) {
+		status = get_call_status(0);
+	} else {
+		if (!((*ctx)->configs = read_configs(path)))
+			status = (get_last_errno_inf() == ENOMEM) ?
+				MDOC_ERR_NOMEM : MDOC_ERR_CONFIG;
+		free_inf(path);
+	}
+
+	if (status && *ctx) {
+		free_inf(*ctx);
+		*ctx = NULL;
+	}
+	stats_leave();
+	TRACE_END("config", NULL, trace_begin);
+
+	return status;
+}
+
+
+void mdoc_ctx_free(struct mdoc_ctx *ctx)
+{
+	if (ctx) {
+		free_users_configs(ctx->configs);
+		free_inf(ctx->cache_dir);
+		free_inf(ctx);
+	}
+}
+
+
+/*
+ * Return a copy of dir, or if it's NULL the default cache directory:
+ * $XDG_CACHE_HOME/mdoc, else $HOME/.cache/mdoc.
+ */
+static char *get_cache_dir(const char *dir)
+{
+	const char *base;
+	const char *sub;
+	char *cache_dir;
+	size_t len;
+
+	if (dir) {
+		base = dir;
+		sub = "";
+	} else if ((base = getenv("XDG_CACHE_HOME")) && *base == '/') {
+		sub = "/mdoc";
+	} else if ((base = getenv_inf("HOME"))) {
+		sub = "/.cache/mdoc";
+	} else {
+		return NULL;
+	}
+	len = strlen(base) + strlen(sub) + 1;
+
+	if ((cache_dir = malloc_inf(sizeof(char) * len)))
+		snprintf(cache_dir, len, "%s%s", base, sub);
+
+	return cache_dir;
+}
+
+
+/*
+ * Cache the found documents of every query in the directory dir, or
+ * in the default one if it's NULL, see the --cache option. A cached
+ * query is answered with a stat() of each directory it searched, as
+ * long as none of them has changed since.
+ */
+enum mdoc_status mdoc_ctx_set_cache(struct mdoc_ctx *ctx, const char *dir)
+{
+	char *cache_dir;
+
+	start_call();
+
+	if (!(cache_dir = get_cache_dir(dir)))
+		return get_call_status(0);
+
+	free_inf(ctx->cache_dir);
+	ctx->cache_dir = cache_dir;
+
+	return MDOC_OK;
+}
+
+
+/*
+ * Ask the user for the configurations on the terminal and write
+ * them to config_path, or to the default file if it's NULL.
+ */
+enum mdoc_status mdoc_config_generate(const char *config_path)
+{
+	enum mdoc_status status = MDOC_OK;
+	char *path;
+
+	start_call();
+
+	if (!(path = get_config_path(config_path)))
+		return get_call_status(0);
+
+	if (generate_config(path))
+		status = *get_last_error_inf() ?
+			get_call_status(0) : MDOC_ERR_INVALID;
+	free_inf(path);
+
+	return status;
+}
+
+
+/*
+ * Make a query for the documents with str in their names, or for all
+ * of them if it's NULL, by the or'ed mdoc_query_flags.
+ */
+enum mdoc_status mdoc_query_new(struct mdoc_query **query, const char *str,
+								unsigned int flags)
+{
+	size_t len;
+
+	start_call();
+
+	if (!(*query = calloc_inf(1, sizeof(struct mdoc_query))))
+		return MDOC_ERR_NOMEM;
+
+	if (str) {
+		len = strlen(str) + 1;
+		if (!((*query)->str = malloc_inf(sizeof(char) * len))) {
+			free_inf(*query);
+			*query = NULL;
+			return MDOC_ERR_NOMEM;
+		}
+		memcpy((*query)->str, str, len);
+	}
+	(*query)->flags = flags;
+	(*query)->sort.natural = flags & MDOC_QUERY_NATURAL;
+
+	/* Just like ls -v, sort the names naturally */
+	if ((*query)->sort.natural)
+		parse_sort_spec(&(*query)->sort, "name");
+
+	return MDOC_OK;
+}
+
+
+/*
+ * Sort the documents by keys, e.g. "-size,name", see the --sort
+ * option. The query is left as it was if they're invalid.
+ */
+enum mdoc_status mdoc_query_set_sort(struct mdoc_query *query, const char *keys)
+{
+	struct sort_spec sort = {.keys_num = 0, .natural = query->sort.natural};
+
+	if (parse_sort_spec(&sort, keys))
+		return MDOC_ERR_INVALID;
+
+	query->sort = sort;
+
+	return MDOC_OK;
+}
+
+
+/*
+ * Keep only the first limit found documents, or the top limit ones if
+ * they're sorted. 0 for no limit.
+ */
+void mdoc_query_set_limit(struct mdoc_query *query, unsigned int limit)
+{
+	query->limit = limit;
+}
+
+
+/*
+ * Keep only the documents that pass the filter by arg, e.g. "pdf,djvu"
+ * for MDOC_FILTER_EXT or "5M" for MDOC_FILTER_LARGER, see the --ext,
+ * --larger, --smaller, --newer, --older and --perm options. The query
+ * is left as it was if arg is invalid.
+ */
+enum mdoc_status mdoc_query_set_filter(struct mdoc_query *query, enum mdoc_filter filter,
+									   const char *arg)
+{
+	struct query_filter *query_filter = &query->filter;
+	int retval = -1;
+
+	start_call();
+
+	switch (filter) {
+	case MDOC_FILTER_EXT:
+		if ((retval = set_filter_exts(query_filter, arg)) == -1)
+			return get_call_status(0);
+		break;
+	case MDOC_FILTER_LARGER:
+		if (!(retval = parse_filter_size(arg, &query_filter->larger)))
+			query_filter->flags |= FILTER_LARGER;
+		break;
+	case MDOC_FILTER_SMALLER:
+		if (!(retval = parse_filter_size(arg, &query_filter->smaller)))
+			query_filter->flags |= FILTER_SMALLER;
+		break;
+	case MDOC_FILTER_NEWER:
+		if (!(retval = parse_filter_age(arg, &query_filter->newer)))
+			query_filter->flags |= FILTER_NEWER;
+		break;
+	case MDOC_FILTER_OLDER:
+		if (!(retval = parse_filter_age(arg, &query_filter->older)))
+			query_filter->flags |= FILTER_OLDER;
+		break;
+	case MDOC_FILTER_PERM:
+		if (!(retval = parse_filter_perm(arg, &query_filter->perm)))
+			query_filter->flags |= FILTER_PERM;
+		break;
+	}
+
+	return retval ?
+		MDOC_ERR_INVALID : MDOC_OK;
+}
+
+
+void mdoc_query_free(struct mdoc_query *query)
+{
+	if (query) {
+		free_inf(query->str);
+		free_query_filter(&query->filter);
+		free_inf(query);
+	}
+}
+
+
+/*
+ * Every search has it's own search_ctx, so a query can be
+ * searched by several threads at once.
+ */
+static void init_search(struct search_ctx *search, const struct mdoc_query *query)
+{
+	memset(search, 0, sizeof(struct search_ctx));
+
+	search->str = query->str;
+	search->ignore_case = query->flags & MDOC_QUERY_IGNORE_CASE;
+	search->recursive = !(query->flags & MDOC_QUERY_NO_RECURSE);
+	search->limit = query->limit;
+	search->sort = &query->sort;
+	plan_search(&search->plan, &query->filter);
+}
+
+
+/*
+ * Return 1 if the documents are passed on as soon as they're found,
+ * the sorted or reversed documents have to be kept until the end.
+ */
+static bool query_streams(const struct mdoc_query *query)
+{
+	return !query->sort.keys_num && !(query->flags & MDOC_QUERY_REVERSE);
+}
+
+
+/*
+ * Return 1 if the query is answered from the context's cache. The
+ * cache is valid only while the searched directories are unchanged, so
+ * the filters of the documents' metadata, which changes without them,
+ * are always searched for.
+ */
+static bool query_cached(const struct mdoc_ctx *ctx, const struct mdoc_query *query)
+{
+	return ctx->cache_dir && !filter_needs_stat(&query->filter);
+}
+
+
+static int call_doc_fn(struct doc_list *doc, void *arg)
+{
+	struct search_call *call = arg;
+
+	if (call->fn((struct mdoc_doc *) doc, call->arg)) {
+		call->failed = 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int discard_doc(struct doc_list *doc, void *arg)
+{
+	(void) doc;
+	(void) arg;
+
+	return 0;
+}
+
+
+/*
+ * Pass the document to the watch's callback unless it was already
+ * passed, or NULL before the watch waits.
+ */
+static int call_new_doc_fn(struct doc_list *doc, void *arg)
+{
+	struct watch_call *watch_call = arg;
+	int new_doc;
+
+	if (doc && (new_doc = watch_new_doc(watch_call->watch, doc->path)) <= 0)
+		return new_doc;
+
+	return call_doc_fn(doc, &watch_call->call);
+}
+
+
+static struct doc_list *search_docs(const struct mdoc_ctx *ctx,
+									struct search_ctx *search)
+{
+	return search_for_doc_multi_dir(ctx->configs->roots,
+									ctx->configs->roots_num, search);
+}
+
+
+/*
+ * Return the list sorted and reversed by the query, or NULL on
+ * failure in which case the list is left as it was.
+ */
+static struct doc_list *rearrange_doc_list(struct doc_list *list,
+										   const struct mdoc_query *query)
+{
+	struct doc_list *rearranged = list;
+
+	stats_enter(STATS_SORT);
+
+	if (query->sort.keys_num)
+		rearranged = sort_doc_list(rearranged, &query->sort);
+	if (rearranged && (query->flags & MDOC_QUERY_REVERSE))
+		rearranged = reverse_doc_list(rearranged);
+
+	stats_leave();
+
+	return rearranged;
+}
+
+
+static int stamp_dir(const struct search_ctx *search, const char *path, int fd, int depth)
+{
+	(void) depth;
+
+	return add_dir_stamp(search->dir_arg, path, fd);
+}
+
+
+/*
+ * Get the query's documents from it's cache if it's still valid, else
+ * search for all of them, whatever the query's limit, and cache them.
+ * The cache is freed by the caller on success.
+ */
+static int find_cached_docs(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+							struct query_cache *cache)
+{
+	const struct users_configs *configs = ctx->configs;
+	struct dir_stamps stamps;
+	struct search_ctx search;
+	struct doc_list *list;
+	int found;
+
+	init_search(&search, query);
+
+	if (open_query_cache(cache, ctx->cache_dir, configs->roots, configs->roots_num,
+						 &search))
+		return -1;
+
+	stats_enter(STATS_SCAN);
+	found = load_query_cache(cache);
+	stats_leave();
+
+	if (found == -1)
+		goto err_free_cache;
+	if (found == 0)
+		return 0;
+
+	init_dir_stamps(&stamps);
+	search.limit = 0;
+	search.dir_fn = stamp_dir;
+	search.dir_arg = &stamps;
+
+	list = search_docs(ctx, &search);
+
+	if (!prev_error && !fill_query_cache(cache, list) && !stamps.racy)
+		save_query_cache(cache, &stamps);
+
+	if (list)
+		free_doc_list(list);
+	free_dir_stamps(&stamps);
+
+	if (!prev_error)
+		return 0;
+
+err_free_cache:
+	free_query_cache(cache);
+	prev_error = 1;
+
+	return -1;
+}
+
+
+/*
+ * Pass the query's cached documents to fn with arg, just like a
+ * streaming search would.
+ */
+static enum mdoc_status search_cached(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+									  int (*fn)(struct mdoc_doc *, void *), void *arg)
+{
+	enum mdoc_status status = MDOC_OK;
+	struct query_cache cache;
+	struct doc_list node;
+	const char *path;
+	size_t i;
+
+	if (find_cached_docs(ctx, query, &cache))
+		return get_call_status(0);
+
+	for (i=0, path=cache.paths; i<cache.docs_num && (!query->limit || i < query->limit);
+		 i++, path+=strlen(path) + 1) {
+		set_doc_node(&node, path);
+
+		if (fn((struct mdoc_doc *) &node, arg))
+			status = get_call_status(1);
+		free_inf(node.stbuf);
+
+		if (status)
+			break;
+	}
+	free_query_cache(&cache);
+
+	return status;
+}
+
+
+/*
+ * Keep the query's cached documents just like mdoc_search_results(),
+ * the results take the cache's paths.
+ */
+static enum mdoc_status search_results_cached(const struct mdoc_ctx *ctx,
+											  const struct mdoc_query *query,
+											  struct mdoc_results **results)
+{
+	const bool sorted = query->sort.keys_num;
+	unsigned int nodes_size = 0;
+	struct query_cache cache;
+	const char *path;
+	size_t i;
+
+	if (!(*results = calloc_inf(1, sizeof(struct mdoc_results))))
+		return MDOC_ERR_NOMEM;
+
+	if (find_cached_docs(ctx, query, &cache)) {
+		free_inf(*results);
+		*results = NULL;
+		return get_call_status(0);
+	}
+	(*results)->paths = cache.buf;
+	cache.buf = NULL;
+
+	for (i=0, path=cache.paths; i<cache.docs_num; i++, path+=strlen(path) + 1) {
+		if (!sorted && query->limit && (*results)->nodes_num == query->limit)
+			break;
+
+		if (save_node(&(*results)->nodes, &(*results)->nodes_num, &nodes_size, path)) {
+			free_query_cache(&cache);
+			goto err_out;
+		}
+	}
+	free_query_cache(&cache);
+
+	if (arrange_nodes(*results, query))
+		goto err_out;
+
+	return MDOC_OK;
+
+err_out:
+	mdoc_results_free(*results);
+	*results = NULL;
+
+	return get_call_status(0);
+}
+
+
+/*
+ * Pass every found document to fn with arg, in the order they're listed
+ * in. Unless they're sorted or reversed, they're passed as soon as
+ * they're found and freed right after, so the memory doesn't grow with
+ * their number. The search stops if fn returns non-zero.
+ */
+enum mdoc_status mdoc_search(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+							 int (*fn)(struct mdoc_doc *, void *), void *arg)
+{
+	struct search_call call = {.fn = fn, .arg = arg, .failed = 0};
+	struct mdoc_results *results;
+	struct search_ctx search;
+	struct mdoc_doc *doc;
+	enum mdoc_status status;
+
+	start_call();
+
+	if (query_cached(ctx, query) && query_streams(query))
+		return search_cached(ctx, query, fn, arg);
+
+	if (query_streams(query)) {
+		init_search(&search, query);
+		search.stream = call_doc_fn;
+		search.stream_arg = &call;
+
+		search_docs(ctx, &search);
+
+		return prev_error ?
+			get_call_status(call.failed) : MDOC_OK;
+	}
+
+	if ((status = mdoc_search_results(ctx, query, &results)))
+		return status;
+
+	for (doc=mdoc_results_first(results); doc; doc=mdoc_doc_next(doc))
+		if (fn(doc, arg)) {
+			status = get_call_status(1);
+			break;
+		}
+	mdoc_results_free(results);
+
+	return status;
+}
+
+
+/*
+ * Count the found documents without keeping any of them, the query's
+ * limit is ignored.
+ */
+enum mdoc_status mdoc_count(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+							unsigned int *num)
+{
+	struct query_cache cache;
+	struct search_ctx search;
+
+	start_call();
+
+	if (query_cached(ctx, query)) {
+		if (find_cached_docs(ctx, query, &cache))
+			return get_call_status(0);
+
+		*num = cache.docs_num;
+		free_query_cache(&cache);
+
+		return MDOC_OK;
+	}
+
+	init_search(&search, query);
+	search.limit = 0;
+	search.stream = discard_doc;
+
+	search_docs(ctx, &search);
+	*num = search.found;
+
+	return prev_error ?
+		get_call_status(0) : MDOC_OK;
+}
+
+
+/*
+ * Search for the documents and keep them all, sorted and reversed
+ * by the query. No documents found isn't a failure.
+ */
+enum mdoc_status mdoc_search_results(const struct mdoc_ctx *ctx,
+									 const struct mdoc_query *query,
+									 struct mdoc_results **results)
+{
+	struct search_ctx search;
+	struct doc_list *rearranged;
+	struct doc_list *list;
+
+	start_call();
+
+	if (query_cached(ctx, query))
+		return search_results_cached(ctx, query, results);
+
+	if (!(*results = malloc_inf(sizeof(struct mdoc_results))))
+		return MDOC_ERR_NOMEM;
+
+	init_search(&search, query);
+	list = search_docs(ctx, &search);
+
+	if (list && !(rearranged = rearrange_doc_list(list, query))) {
+		free_doc_list(list);
+		prev_error = 1;
+	} else if (list) {
+		list = rearranged;
+	}
+
+	if (prev_error) {
+		free_inf(*results);
+		*results = NULL;
+		return get_call_status(0);
+	}
+	(*results)->list = list;
+	(*results)->num = count_doc_list_nodes(list);
+	(*results)->nodes = NULL;
+	(*results)->paths = NULL;
+
+	return MDOC_OK;
+}
+
+
+struct mdoc_doc *mdoc_results_first(const struct mdoc_results *results)
+{
+	return (struct mdoc_doc *) results->list;
+}
+
+
+unsigned int mdoc_results_num(const struct mdoc_results *results)
+{
+	return results->num;
+}
+
+
+void mdoc_results_free(struct mdoc_results *results)
+{
+	unsigned int i;
+
+	if (!results)
+		return;
+
+	if (results->nodes) {
+		/* Only the metadata is the nodes' own */
+		for (i=0; i<results->nodes_num; i++)
+			free_inf(results->nodes[i].stbuf);
+		free_inf(results->nodes);
+	} else if (results->list) {
+		free_doc_list(results->list);
+	}
+	free_inf(results->paths);
+	free_inf(results);
+}
+
+
+/*
+ * Open the documents with their viewers and pass each one to opened with
+ * arg once it's viewer was executed. With batch every viewer is executed
+ * once with as many documents as the arguments limit allows.
+ */
+enum mdoc_status mdoc_open_results(const struct mdoc_ctx *ctx,
+								   const struct mdoc_results *results,
+								   enum mdoc_launch launch, bool batch,
+								   int (*opened)(struct mdoc_doc *, void *),
+								   void *arg)
+{
+	const struct users_configs *configs = ctx->configs;
+	struct search_call call = {.fn = opened, .arg = arg, .failed = 0};
+	struct launcher *launcher = NULL;
+	const struct doc_list *ptr;
+	int retval = 0;
+
+	start_call();
+
+	if (launch != MDOC_LAUNCH_WAIT &&
+		!(launcher = alloc_launcher(launch == MDOC_LAUNCH_DETACH)))
+		return get_call_status(0);
+
+	stats_enter(STATS_EXEC);
+
+	if (batch)
+		retval = open_doc_list_batched(configs, results->list, launcher,
+									   call_doc_fn, &call);
+
+	for (ptr=results->list; !batch && ptr; ptr=ptr->next)
+		if ((retval = open_doc_path(configs, ptr->path, launcher)) ||
+			(retval = call_doc_fn((struct doc_list *) ptr, &call)))
+			break;
+
+	/* The started viewers are waited for even after a failure */
+	if (launcher) {
+		if (wait_launched(launcher))
+			retval = -1;
+		free_launcher(launcher);
+	}
+	stats_leave();
+
+	return retval ?
+		get_call_status(call.failed) : MDOC_OK;
+}
+
+
+/*
+ * Reap the viewers of MDOC_LAUNCH_DETACH that exited since, which are
+ * otherwise only reaped by the next mdoc_open_results(). A program that
+ * keeps running, e.g. between it's commands, calls it when it's idle.
+ */
+void mdoc_reap_detached(void)
+{
+	reap_detached();
+}
+
+
+/*
+ * Pass the found documents to fn with arg just like mdoc_search(), then
+ * watch their directories and pass every new document as soon as it
+ * appears, once. fn is also passed NULL before the watch waits for new
+ * documents, e.g. to flush what it got. The query's limit is ignored.
+ * It returns only when fn returns non-zero or the watch fails.
+ */
+enum mdoc_status mdoc_watch(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+							int (*fn)(struct mdoc_doc *, void *), void *arg)
+{
+	struct watch_call watch_call = {.call = {.fn = fn, .arg = arg, .failed = 0}};
+	struct search_ctx search;
+	struct doc_list *rearranged;
+	struct doc_list *list;
+	struct doc_list *ptr;
+
+	start_call();
+
+	if (!(watch_call.watch = alloc_doc_watch()))
+		return get_call_status(0);
+
+	/* Every searched directory is watched before it's read */
+	init_search(&search, query);
+	search.limit = 0;
+	search.dir_fn = watch_dir;
+	search.dir_arg = watch_call.watch;
+	search.stream = call_new_doc_fn;
+	search.stream_arg = &watch_call;
+
+	if (query_streams(query)) {
+		search_docs(ctx, &search);
+	} else {
+		search.stream = NULL;
+		list = search_docs(ctx, &search);
+		search.stream = call_new_doc_fn;
+
+		if (list && !(rearranged = rearrange_doc_list(list, query))) {
+			prev_error = 1;
+		} else if (list) {
+			list = rearranged;
+
+			for (ptr=list; ptr && !prev_error; ptr=ptr->next)
+				if (call_new_doc_fn(ptr, &watch_call))
+					prev_error = 1;
+		}
+		if (list)
+			free_doc_list(list);
+	}
+
+	if (!prev_error && run_doc_watch(watch_call.watch, &search))
+		prev_error = 1;
+
+	free_doc_watch(watch_call.watch);
+
+	return get_call_status(watch_call.call.failed);
+}
+
+
+static int grow_index(struct mdoc_index *index, size_t path_len)
+{
+	struct index_doc *docs;
+	size_t size;
+	char *paths;
+
+	if (index->docs_num == index->docs_size) {
+		size = index->docs_size ? 2 * index->docs_size : INDEX_DOCS_INIT;
+		if (!(docs = reallocarray_inf(index->docs, size, sizeof(struct index_doc))))
+			return -1;
+
+		index->docs = docs;
+		index->docs_size = size;
+	}
+
+	if (index->paths_size - index->paths_len < path_len + 1) {
+		for (size=index->paths_size ? index->paths_size : INDEX_PATHS_INIT;
+			 size - index->paths_len < path_len + 1; size*=2)
+			;
+		if (!(paths = realloc_site_inf(index->paths, size, MEM_SITE_PATH)))
+			return -1;
+
+		index->paths = paths;
+		index->paths_size = size;
+	}
+
+	return 0;
+}
+
+
+static int add_index_doc(struct mdoc_doc *doc, void *arg)
+{
+	struct mdoc_index *index = arg;
+	const size_t len = strlen(doc->node.path);
+	struct index_doc *entry;
+
+	if (grow_index(index, len))
+		return -1;
+
+	entry = &index->docs[index->docs_num++];
+	/* The name is the path's last component, but it's not kept inside it */
+	entry->path = index->paths_len;
+	entry->name = len - strlen(doc->node.name);
+
+	memcpy(&index->paths[index->paths_len], doc->node.path, len + 1);
+	index->paths_len += len + 1;
+
+	return 0;
+}
+
+
+/*
+ * Give the unused room of the grown buffers back, the index is 
+ * kept as long as it's used.
+ */
+static void shrink_index(struct mdoc_index *index)
+{
+	struct index_doc *docs;
+	char *paths;
+
+	if (index->docs_num && 
+		(docs = reallocarray_inf(index->docs, index->docs_num, sizeof(struct index_doc)))) {
+		index->docs = docs;
+		index->docs_size = index->docs_num;
+	}
+
+	if (index->paths_len && 
+		(paths = realloc_site_inf(index->paths, index->paths_len, MEM_SITE_PATH))) {
+		index->paths = paths;
+		index->paths_size = index->paths_len;
+	}
+}
+
+
+/*
+ * Search for every document once and keep them in an index, so the
+ * queries are answered without scanning again, see mdoc_index_search().
+ * Of the flags only MDOC_QUERY_NO_RECURSE applies to the scan.
+ */
+enum mdoc_status mdoc_index_new(struct mdoc_index **index, const struct mdoc_ctx *ctx,
+								unsigned int flags)
+{
+	struct mdoc_query all = {
+		.str = NULL,
+		.flags = flags & MDOC_QUERY_NO_RECURSE,
+		.limit = 0,
+		.sort = {.keys_num = 0, .natural = 0}
+	};
+	enum mdoc_status status;
+
+	start_call();
+
+	if (!(*index = calloc_inf(1, sizeof(struct mdoc_index))))
+		return MDOC_ERR_NOMEM;
+
+	if ((status = mdoc_search(ctx, &all, add_index_doc, *index))) {
+		mdoc_index_free(*index);
+		*index = NULL;
+		return (status == MDOC_ERR_CALLBACK) ? 
+			MDOC_ERR_NOMEM : status;
+	}
+	shrink_index(*index);
+
+	return MDOC_OK;
+}
+
+
+unsigned int mdoc_index_num(const struct mdoc_index *index)
+{
+	return index->docs_num;
+}
+
+
+void mdoc_index_free(struct mdoc_index *index)
+{
+	if (index) {
+		free_inf(index->paths);
+		free_inf(index->docs);
+		free_inf(index);
+	}
+}
+
+
+/*
+ * Return 1 if the index's i'th document passes the plan and has the
+ * query's string in it's name, checked just like a search does. It's
+ * stat'ed only if the plan needs it's metadata, and a document that's
+ * gone since the index was made doesn't match.
+ */
+static bool index_doc_matches(const struct mdoc_index *index, unsigned int i,
+							  const struct search_plan *plan, const struct mdoc_query *query)
+{
+	const char *path = &index->paths[index->docs[i].path];
+	struct stat stbuf;
+
+	if (!plan_matches_ext(plan, path + index->docs[i].name) ||
+		!check_str_occurrence(path + index->docs[i].name, query->str,
+							  query->flags & MDOC_QUERY_IGNORE_CASE))
+		return 0;
+
+	if (!plan->preds_num)
+		return 1;
+
+	STATS_COUNT(STATS_STATS, 1);
+
+	return !stat(path, &stbuf) && plan_matches_stat(plan, &stbuf);
+}
+
+
+static void set_index_node(const struct mdoc_index *index, unsigned int i,
+						   struct doc_list *node)
+{
+	node->path = &index->paths[index->docs[i].path];
+	node->name = node->path + index->docs[i].name;
+	node->stbuf = NULL;
+	node->next = NULL;
+}
+
+
+/*
+ * Set the node of the document at path, which isn't the node's own.
+ * The document's name is the path's last component.
+ */
+static void set_doc_node(struct doc_list *node, const char *path)
+{
+	node->path = (char *) path;
+	node->name = strrchr(path, '/') + 1;
+	node->stbuf = NULL;
+	node->next = NULL;
+}
+
+
+/*
+ * Append a node of the document at path to nodes, growing it when
+ * it's full.
+ */
+static int save_node(struct doc_list **nodes, unsigned int *nodes_num, 
+					 unsigned int *nodes_size, const char *path)
+{
+	struct doc_list *new_nodes;
+	unsigned int size;
+
+	if (*nodes_num == *nodes_size) {
+		size = *nodes_size ? 2 * *nodes_size : INDEX_DOCS_INIT;
+		if (!(new_nodes = reallocarray_inf(*nodes, size, sizeof(struct doc_list))))
+			return -1;
+
+		*nodes = new_nodes;
+		*nodes_size = size;
+	}
+	set_doc_node(&(*nodes)[(*nodes_num)++], path);
+
+	return 0;
+}
+
+
+/*
+ * Link the nodes in the array's order, once it won't move anymore.
+ */
+static struct doc_list *link_nodes(struct doc_list *nodes, unsigned int nodes_num)
+{
+	unsigned int i;
+
+	for (i=1; i<nodes_num; i++)
+		nodes[i-1].next = &nodes[i];
+
+	return nodes_num ? 
+		nodes : NULL;
+}
+
+
+/*
+ * Keep only the first limit nodes of the list, the rest are left
+ * to their owner.
+ */
+static struct doc_list *cut_doc_list(struct doc_list *list, unsigned int limit)
+{
+	struct doc_list *ptr = list;
+	unsigned int i;
+
+	for (i=1; ptr && i<limit; i++)
+		ptr = ptr->next;
+
+	if (ptr)
+		ptr->next = NULL;
+
+	return list;
+}
+
+
+/*
+ * Link the results' nodes, then sort, limit and reverse them by the
+ * query. The unsorted nodes were already limited while they were saved.
+ */
+static int arrange_nodes(struct mdoc_results *results, const struct mdoc_query *query)
+{
+	struct doc_list *list = link_nodes(results->nodes, results->nodes_num);
+
+	if (list && query->sort.keys_num) {
+		stats_enter(STATS_SORT);
+		list = sort_doc_list(list, &query->sort);
+		stats_leave();
+
+		if (!list)
+			return -1;
+		if (query->limit)
+			list = cut_doc_list(list, query->limit);
+	}
+	if (list && (query->flags & MDOC_QUERY_REVERSE))
+		list = reverse_doc_list(list);
+
+	results->list = list;
+	results->num = count_doc_list_nodes(list);
+
+	return 0;
+}
+
+
+/*
+ * Keep the index's documents the query matches, sorted, limited and 
+ * reversed by it, just like mdoc_search_results() would, but without
+ * scanning. The results must be freed before the index.
+ */
+enum mdoc_status mdoc_index_search_results(const struct mdoc_index *index,
+										   const struct mdoc_query *query,
+										   struct mdoc_results **results)
+{
+	const bool sorted = query->sort.keys_num;
+	unsigned int nodes_size = 0;
+	struct search_plan plan;
+	unsigned int i;
+
+	start_call();
+
+	plan_search(&plan, &query->filter);
+
+	if (!(*results = calloc_inf(1, sizeof(struct mdoc_results))))
+		return MDOC_ERR_NOMEM;
+
+	for (i=0; i<index->docs_num; i++) {
+		if (!sorted && query->limit && (*results)->nodes_num == query->limit)
+			break;
+
+		if (index_doc_matches(index, i, &plan, query) &&
+			save_node(&(*results)->nodes, &(*results)->nodes_num, &nodes_size,
+					  &index->paths[index->docs[i].path]))
+			goto err_out;
+	}
+
+	if (arrange_nodes(*results, query))
+		goto err_out;
+
+	return MDOC_OK;
+
+err_out:
+	mdoc_results_free(*results);
+	*results = NULL;
+
+	return get_call_status(0);
+}
+
+
+/*
+ * Pass the index's documents the query matches to fn with arg, just
+ * like mdoc_search() would. The unsorted ones are passed without being
+ * kept at all.
+ */
+enum mdoc_status mdoc_index_search(const struct mdoc_index *index,
+								   const struct mdoc_query *query,
+								   int (*fn)(struct mdoc_doc *, void *), void *arg)
+{
+	struct mdoc_results *results;
+	struct mdoc_doc *doc;
+	enum mdoc_status status;
+	struct search_plan plan;
+	struct doc_list node;
+	unsigned int found = 0;
+	unsigned int i;
+
+	start_call();
+
+	if (!query_streams(query)) {
+		if ((status = mdoc_index_search_results(index, query, &results)))
+			return status;
+
+		for (doc=mdoc_results_first(results); doc; doc=mdoc_doc_next(doc))
+			if (fn(doc, arg)) {
+				status = get_call_status(1);
+				break;
+			}
+		mdoc_results_free(results);
+
+		return status;
+	}
+
+	plan_search(&plan, &query->filter);
+
+	for (i=0; i<index->docs_num && (!query->limit || found < query->limit); i++) {
+		if (!index_doc_matches(index, i, &plan, query))
+			continue;
+
+		set_index_node(index, i, &node);
+		found++;
+
+		status = fn((struct mdoc_doc *) &node, arg) ? 
+			get_call_status(1) : MDOC_OK;
+		free_inf(node.stbuf);
+
+		if (status)
+			return status;
+	}
+
+	return MDOC_OK;
+}
+
+
+/*
+ * Count the index's documents the query matches, it's limit is ignored.
+ */
+enum mdoc_status mdoc_index_count(const struct mdoc_index *index,
+								  const struct mdoc_query *query, unsigned int *num)
+{
+	struct search_plan plan;
+	unsigned int i;
+
+	*num = 0;
+	plan_search(&plan, &query->filter);
+
+	for (i=0; i<index->docs_num; i++)
+		if (index_doc_matches(index, i, &plan, query))
+			(*num)++;
+
+	return MDOC_OK;
+}
+
+
+/*
+ * Move the index's documents to new results, sorted, limited and
+ * reversed by the query, the index is left empty.
+ */
+static int take_index_results(struct mdoc_index *index, const struct mdoc_query *query,
+							  struct mdoc_results **results)
+{
+	unsigned int i;
+
+	if (!(*results = calloc_inf(1, sizeof(struct mdoc_results))))
+		return -1;
+
+	if (index->docs_num &&
+		!((*results)->nodes = reallocarray_inf(NULL, index->docs_num, sizeof(struct doc_list))))
+		goto err_out;
+
+	for (i=0; i<index->docs_num; i++)
+		set_index_node(index, i, &(*results)->nodes[i]);
+	(*results)->nodes_num = index->docs_num;
+
+	(*results)->paths = index->paths;
+	index->paths = NULL;
+
+	if (arrange_nodes(*results, query))
+		goto err_out;
+
+	return 0;
+
+err_out:
+	mdoc_results_free(*results);
+	*results = NULL;
+
+	return -1;
+}
+
+
+/*
+ * Count or keep the found document for every query of the batch whose
+ * string is in it's name. The unsorted queries keep only their first
+ * limit documents.
+ */
+static int add_batch_doc(struct doc_list *doc, void *arg)
+{
+	struct batch_call *call = arg;
+	const struct mdoc_query *query;
+	struct mdoc_index *index;
+	unsigned int num;
+	unsigned int i;
+
+	num = match_patterns(call->patterns, doc->name, call->ids, call->matched);
+
+	for (i=0; i<num; i++) {
+		if (call->nums) {
+			call->nums[call->ids[i]]++;
+			continue;
+		}
+		query = call->queries[call->ids[i]];
+		index = &call->indexes[call->ids[i]];
+
+		if (!query->sort.keys_num && query->limit && index->docs_num == query->limit)
+			continue;
+
+		if (add_index_doc((struct mdoc_doc *) doc, index))
+			return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the queries have the same MDOC_QUERY_IGNORE_CASE and
+ * NO_RECURSE flags and the same filters, so a single search finds the
+ * documents of all of them, otherwise 0.
+ */
+static bool batch_queries_match(const struct mdoc_query *const *queries, unsigned int num)
+{
+	const unsigned int search_flags = MDOC_QUERY_IGNORE_CASE | MDOC_QUERY_NO_RECURSE;
+	unsigned int i;
+
+	for (i=1; i<num; i++)
+		if ((queries[i]->flags & search_flags) != (queries[0]->flags & search_flags) ||
+			!query_filters_equal(&queries[i]->filter, &queries[0]->filter))
+			return 0;
+
+	return 1;
+}
+
+
+/*
+ * Search for the documents of all the batch's queries at once, with a
+ * single matcher of their strings, and pass each to add_batch_doc(). The
+ * queries must match, see batch_queries_match().
+ */
+static enum mdoc_status search_batch(const struct mdoc_ctx *ctx, struct batch_call *call)
+{
+	const struct mdoc_query *const *queries = call->queries;
+	struct search_ctx search;
+	const char **strs;
+	unsigned int i;
+
+	if (!(strs = reallocarray_inf(NULL, call->queries_num, sizeof(char *))))
+		return MDOC_ERR_NOMEM;
+
+	/* A query for every document matches just like an empty string */
+	for (i=0; i<call->queries_num; i++)
+		strs[i] = queries[i]->str ? queries[i]->str : "";
+
+	call->patterns = build_pattern_set(strs, call->queries_num,
+									   queries[0]->flags & MDOC_QUERY_IGNORE_CASE);
+	call->ids = reallocarray_inf(NULL, call->queries_num, sizeof(unsigned int));
+	call->matched = calloc_inf(call->queries_num, sizeof(bool));
+
+	if (call->patterns && call->ids && call->matched) {
+		init_search(&search, queries[0]);
+		search.str = NULL;
+		search.patterns = call->patterns;
+		search.limit = 0;
+		search.stream = add_batch_doc;
+		search.stream_arg = call;
+
+		search_docs(ctx, &search);
+	} else {
+		prev_error = 1;
+	}
+	free_pattern_set(call->patterns);
+	free_inf(call->ids);
+	free_inf(call->matched);
+	free_inf(strs);
+
+	return prev_error ?
+		get_call_status(0) : MDOC_OK;
+}
+
+
+/*
+ * Count the documents of each of the num queries into nums, just like
+ * mdoc_count() would, with a single search for all of them. The queries
+ * must have the same MDOC_QUERY_IGNORE_CASE and NO_RECURSE flags and the
+ * same filters.
+ */
+enum mdoc_status mdoc_count_batch(const struct mdoc_ctx *ctx,
+								  const struct mdoc_query *const *queries,
+								  unsigned int num, unsigned int *nums)
+{
+	struct batch_call call = {.queries = queries, .queries_num = num, .nums = nums};
+	enum mdoc_status status;
+	unsigned int i;
+
+	start_call();
+
+	if (!batch_queries_match(queries, num))
+		return MDOC_ERR_INVALID;
+
+	if (!num)
+		return MDOC_OK;
+
+	/*
+	 * The queries' filters are the same, so either all of them are answered
+	 * from the cache without reading the directories, or none is
+	 */
+	if (query_cached(ctx, queries[0])) {
+		for (i=0; i<num; i++)
+			if ((status = mdoc_count(ctx, queries[i], &nums[i])))
+				return status;
+		return MDOC_OK;
+	}
+
+	memset(nums, 0, num * sizeof(unsigned int));
+
+	return search_batch(ctx, &call);
+}
+
+
+/*
+ * Keep the documents of each of the num queries in results, just like
+ * mdoc_search_results() would, with a single search for all of them.
+ * The queries must have the same MDOC_QUERY_IGNORE_CASE and NO_RECURSE
+ * flags and the same filters. Each of the results is freed on it's own.
+ */
+enum mdoc_status mdoc_search_results_batch(const struct mdoc_ctx *ctx,
+										   const struct mdoc_query *const *queries,
+										   unsigned int num, struct mdoc_results **results)
+{
+	struct batch_call call = {.queries = queries, .queries_num = num};
+	enum mdoc_status status = MDOC_OK;
+	unsigned int i;
+
+	start_call();
+
+	if (!batch_queries_match(queries, num))
+		return MDOC_ERR_INVALID;
+
+	memset(results, 0, num * sizeof(struct mdoc_results *));
+
+	/* Either all of the queries are cached or none is, like in mdoc_count_batch() */
+	if (num && query_cached(ctx, queries[0])) {
+		for (i=0; i<num && !status; i++)
+			status = mdoc_search_results(ctx, queries[i], &results[i]);
+	} else if (num) {
+		if (!(call.indexes = calloc_inf(num, sizeof(struct mdoc_index))))
+			return MDOC_ERR_NOMEM;
+
+		status = search_batch(ctx, &call);
+
+		for (i=0; i<num && !status; i++)
+			if (take_index_results(&call.indexes[i], queries[i], &results[i]))
+				status = get_call_status(0);
+
+		for (i=0; i<num; i++) {
+			free_inf(call.indexes[i].paths);
+			free_inf(call.indexes[i].docs);
+		}
+		free_inf(call.indexes);
+	}
+
+	if (status)
+		for (i=0; i<num; i++) {
+			mdoc_results_free(results[i]);
+			results[i] = NULL;
+		}
+
+	return status;
+}
+
+
+/*
+ * Open the cache of the documents' hashes in the cache directory of the
+ * context, or else the default one. Without either the hashes are only
+ * kept in memory.
+ */
+static int open_dupes_hashes(const struct mdoc_ctx *ctx, struct hash_cache *cache)
+{
+	char *dir = ctx->cache_dir;
+	int retval;
+
+	if (!dir && !(dir = get_cache_dir(NULL))) {
+		if (get_last_errno_inf() == ENOMEM)
+			return -1;
+		clear_error_inf();
+	}
+	retval = open_hash_cache(cache, dir);
+
+	if (dir != ctx->cache_dir)
+		free_inf(dir);
+
+	return retval;
+}
+
+
+/*
+ * Find the sets of the found documents with the same content, see the
+ * --dupes option. The documents of each set and the sets by their first
+ * documents are in the order the query lists them in, and the query's
+ * limit is of the sets. The computed hashes are cached by the files'
+ * inodes, sizes and mtimes, so they're only computed again for the
+ * changed files. The paths of the same file, e.g. it's hard links and
+ * the symbolic links to it, are a single document. No sets found isn't
+ * a failure.
+ */
+enum mdoc_status mdoc_find_dupes(const struct mdoc_ctx *ctx, const struct mdoc_query *query,
+								 struct mdoc_dupes **dupes)
+{
+	struct search_ctx search;
+	struct hash_cache cache;
+	struct doc_list *rearranged;
+	struct doc_list *list;
+	unsigned int i;
+	int retval;
+
+	start_call();
+
+	if (!(*dupes = calloc_inf(1, sizeof(struct mdoc_dupes))))
+		return MDOC_ERR_NOMEM;
+
+	init_search(&search, query);
+	/* All the documents are compared, the limit is of the sets */
+	search.limit = 0;
+	list = search_docs(ctx, &search);
+
+	if (list && !(rearranged = rearrange_doc_list(list, query))) {
+		free_doc_list(list);
+		prev_error = 1;
+	} else if (list) {
+		list = rearranged;
+	}
+
+	if (prev_error || open_dupes_hashes(ctx, &cache)) {
+		free_doc_list(list);
+		goto err_free_dupes;
+	}
+
+	stats_enter(STATS_HASH);
+	retval = find_dup_sets(list, &cache, &(*dupes)->sets, &(*dupes)->sets_num);
+	stats_leave();
+
+	if (retval) {
+		free_doc_list(list);
+	} else {
+		/* The cache is only an optimization, so it's failures are silent */
+		if (cache.changed)
+			save_hash_cache(&cache);
+
+		for (i=query->limit; query->limit && i<(*dupes)->sets_num; i++)
+			free_doc_list((*dupes)->sets[i]);
+		if (query->limit && (*dupes)->sets_num > query->limit)
+			(*dupes)->sets_num = query->limit;
+	}
+	free_hash_cache(&cache);
+
+	if (!retval)
+		return MDOC_OK;
+
+err_free_dupes:
+	free_inf(*dupes);
+	*dupes = NULL;
+
+	return get_call_status(0);
+}
+
+
+unsigned int mdoc_dupes_num(const struct mdoc_dupes *dupes)
+{
+	return dupes->sets_num;
+}
+
+
+/*
+ * Return the first document of the i'th set, the rest of it's
+ * documents follow by mdoc_doc_next().
+ */
+struct mdoc_doc *mdoc_dupes_set(const struct mdoc_dupes *dupes, unsigned int i)
+{
+	return (struct mdoc_doc *) dupes->sets[i];
+}
+
+
+void mdoc_dupes_free(struct mdoc_dupes *dupes)
+{
+	unsigned int i;
+
+	if (!dupes)
+		return;
+
+	for (i=0; i<dupes->sets_num; i++)
+		free_doc_list(dupes->sets[i]);
+	free_inf(dupes->sets);
+	free_inf(dupes);
+}
+
+
+const char *mdoc_doc_path(const struct mdoc_doc *doc)
+{
+	return doc->node.path;
+}
+
+
+const char *mdoc_doc_name(const struct mdoc_doc *doc)
+{
+	return doc->node.name;
+}
+
+
+/*
+ * Return the document's metadata, fetched on the first call, or
+ * NULL on failure.
+ */
+const struct stat *mdoc_doc_stat(struct mdoc_doc *doc)
+{
+	return get_doc_stat(&doc->node);
+}
+
+
+/*
+ * Return the next document of the results, or NULL. The streamed
+ * documents have no next one.
+ */
+struct mdoc_doc *mdoc_doc_next(const struct mdoc_doc *doc)
+{
+	return (struct mdoc_doc *) doc->node.next;
+}
+
+
+const char *mdoc_strerror(enum mdoc_status status)
+{
+	switch (status) {
+	case MDOC_OK:
+		return "Success";
+	case MDOC_ERR_NOMEM:
+		return "Out of memory";
+	case MDOC_ERR_CONFIG:
+		return "Invalid configurations";
+	case MDOC_ERR_SYSTEM:
+		return "System error";
+	case MDOC_ERR_INVALID:
+		return "Invalid argument";
+	case MDOC_ERR_CALLBACK:
+		return "Stopped by the callback";
+	}
+
+	return "Unknown error";
+}
+
+
+/*
+ * Return the message of the calling thread's last error, or "" if
+ * it's last call succeeded.
+ */
+const char *mdoc_last_error(void)
+{
+	return get_last_error_inf();
+}
+
+
+/*
+ * Set the handler every error's message is passed to as soon as it
+ * occurs, from the thread it occurred in, e.g. to print it.
+ */
+void mdoc_set_error_handler(void (*handler)(const char *, void *), void *arg)
+{
+	set_error_handler_inf(handler, arg);
+}
@@ -11,12 +11,24 @@
 */
 
 #include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include "strman.h"
+#include <getopt.h>
+#include "libmdoc.h"
 #include "informative.h"
-#include "mdoc.h"
+#include "output.h"
+#include "print.h"
+#include "fields.h"
+#include "timefmt.h"
+#include "stats.h"
+#include "trace.h"
+#include "memstats.h"
+#include "input.h"
+#include "repl.h"
 
 
 enum EXIT_CODES { 
@@ -25,261 +37,557 @@ enum EXIT_CODES {
     SUCCES = 0
 };
 
-char *prog_name_inf;
+/* The long options values, starting after the short options ones */
+enum LONG_OPTS {
+    SORT_OPT = 256,
+    LIMIT_OPT,
+    JSON_OPT,
+    FIELDS_OPT,
+    ISO_OPT,
+    CONCURRENT_OPT,
+    DETACH_OPT,
+    BATCH_OPT,
+    STATS_OPT,
+    TRACE_OPT,
+    MEM_LIMIT_OPT,
+    INTERACTIVE_OPT,
+    CACHE_OPT,
+    WATCH_OPT,
+    PATTERNS_OPT,
+    DUPES_OPT,
+    /* The filters, in the order of their mdoc_filter */
+    EXT_OPT,
+    LARGER_OPT,
+    SMALLER_OPT,
+    NEWER_OPT,
+    OLDER_OPT,
+    PERM_OPT
+};
+
+/* The filters' options names, by their mdoc_filter */
+static const char *const filters_opts[MDOC_FILTERS_NUM] = {
+    [MDOC_FILTER_EXT] = "ext",
+    [MDOC_FILTER_LARGER] = "larger",
+    [MDOC_FILTER_SMALLER] = "smaller",
+    [MDOC_FILTER_NEWER] = "newer",
+    [MDOC_FILTER_OLDER] = "older",
+    [MDOC_FILTER_PERM] = "perm"
+};
+
+/* The --cache option */
+struct cache_opt {
+    bool on;
+    /* NULL for the default directory */
+    const char *dir;
+};
 
+/* The patterns of the arguments and of the --patterns file */
+struct pattern_args {
+    const char **strs;
+    unsigned int num;
+    unsigned int size;
+    /* The first args_num are the arguments, the rest are the file's lines */
+    unsigned int args_num;
+};
 
 /* Static Functions Prototype */
-static char *get_config_path();
+static void print_error(const char *, void *);
 static int missing_arg_err(const int);
 static int invalid_arg_err(const int);
+static int missing_long_arg_err(const char *);
+static int invalid_long_arg_err(const char *);
+static int invalid_long_opt_arg_err(const char *, const char *);
+static int conflicting_opts_err(const char *, const char *);
+static int parse_limit(const char *, unsigned int *);
+static int parse_mem_size(const char *, size_t *);
 static int generate_opt();
-static struct users_configs *get_configs();
-static int count_opt(const char *, bool, bool, bool);
-static void opts_cleanup(struct users_configs *, struct doc_list *);
+static int new_ctx(struct mdoc_ctx **, const struct cache_opt *);
+static int count_opt(const struct mdoc_query *, const struct cache_opt *, bool, 
+                     const struct record_spec *);
+static int print_streamed_doc(struct mdoc_doc *, void *);
+static int print_docs(const struct mdoc_query *, const struct cache_opt *, 
+                      struct doc_printer *);
+static int print_watched_doc(struct mdoc_doc *, void *);
+static int watch_docs(const struct mdoc_query *, struct doc_printer *);
+static int add_pattern_arg(struct pattern_args *, const char *);
+static int read_patterns_file(struct pattern_args *, const char *);
+static void free_pattern_args(struct pattern_args *);
+static struct mdoc_query **new_batch_queries(const struct pattern_args *, unsigned int,
+                                             const char *, unsigned int, const char *const *);
+static void free_batch_queries(struct mdoc_query **, unsigned int);
+static int count_batch(struct mdoc_query *const *, const struct pattern_args *,
+                       const struct cache_opt *, const struct doc_printer *);
+static int print_batch(struct mdoc_query *const *, const struct pattern_args *,
+                       const struct cache_opt *, struct doc_printer *);
+static int print_dupes(const struct mdoc_query *, const struct cache_opt *,
+                       struct doc_printer *);
 static void big_docs_num_error();
-static struct doc_list *rearrange_if_needed(struct doc_list *, bool, bool); 
-static int list_opt(const char *, bool, bool, bool, bool, bool);
-static int open_opt(const char *, bool, bool, bool, bool, bool, bool);
-static int open_doc_list(const struct users_configs *, const struct doc_list *, bool);
-static int details_opt(const char *, bool, bool, bool, bool, bool);
-static char *get_opt_arg(const char *);
-static void display_docs_names(const struct doc_list *, bool);
-static int print_docs_details(const struct doc_list *, bool);
-static void separate_if_needed(const struct doc_list *);
+static int open_opt(const struct mdoc_query *, const struct cache_opt *, bool, bool, 
+                    enum mdoc_launch, bool);
+static char *get_opt_arg(int, char **);
 
 
 
-static char *get_config_path() 
+/*
+ * The library only keeps the errors, so print them as they occur.
+ */
+static void print_error(const char *msg, void *arg) 
 {
-    const char config[] = ".config/mdoc";
-    char *config_path = NULL;
-    char *home; 
-    size_t len;
-
-    if ((home = getenv_inf("HOME"))) {
-        len = strlen(config) + strlen(home) + 2;
-        
-        if ((config_path = malloc_inf(sizeof(char) * len)))
-            snprintf(config_path, len, "%s/%s", home, config);
-    }
+    (void) arg;
 
-    return config_path;
+    fprintf(stderr, "%s: %s\n", prog_name_inf, msg);
 }
 
 
 static int generate_opt() 
 {
-    char *config_path; 
-    int retval = -1;
-
-    if ((config_path = get_config_path())) {
-        retval = generate_config(config_path);
-        free(config_path);
-    }
-
-    return retval;
+    return mdoc_config_generate(NULL) ?
+        -1 : 0;
 }
 
 
-static struct users_configs *get_configs() 
+/*
+ * Read the configurations into a new context, which caches the queries
+ * with --cache.
+ */
+static int new_ctx(struct mdoc_ctx **ctx, const struct cache_opt *cache)
 {
-    struct users_configs *configs = NULL;
-    char *config_path;
+    if (mdoc_ctx_new(ctx, NULL))
+        return -1;
 
-    if ((config_path = get_config_path())) {
-        configs = read_configs(config_path);
-        free(config_path);
+    if (cache->on && mdoc_ctx_set_cache(*ctx, cache->dir)) {
+        mdoc_ctx_free(*ctx);
+        return -1;
     }
 
-    return configs;
+    return 0;
 }
 
 
-static int count_opt(const char *str, bool ignore, bool rec, bool color) 
+static int count_opt(const struct mdoc_query *query, const struct cache_opt *cache, 
+                     bool color, const struct record_spec *record) 
 {
-    struct users_configs *configs;
-    struct doc_list *list;
+    struct mdoc_ctx *ctx;
+    unsigned int docs_num;
     int retval = -1;
 
-    if ((configs = get_configs())) {
-        list = search_for_doc_multi_dir(configs->docs_dir_path, str, ignore, rec);
-        
-        if (!prev_error) {
-            print_docs_num(count_doc_list_nodes(list), color);
+    if (!new_ctx(&ctx, cache)) {
+        /* Only the number of the documents is needed, so none is kept */
+        if (!mdoc_count(ctx, query, &docs_num)) {
+            stats_enter(STATS_OUTPUT);
+            if (record)
+                print_docs_num_record(docs_num, record, NULL);
+            else
+                print_docs_num(docs_num, color);
+            stats_leave();
             retval = 0;
         }  
-        opts_cleanup(configs, list);
+        mdoc_ctx_free(ctx);
     }
 
     return retval;
 }
 
 
-static void opts_cleanup(struct users_configs *configs, struct doc_list *ptr) 
+static int print_streamed_doc(struct mdoc_doc *doc, void *arg) 
+{
+    int retval;
+
+    stats_enter(STATS_OUTPUT);
+    retval = print_doc(doc, arg);
+    stats_leave();
+
+    return retval;
+}
+
+
+/*
+ * Search for the documents and print them. Under a --mem-limit they're
+ * printed as soon as they're found if they can be, otherwise only once
+ * they were all found, so nothing is printed if the search fails. Fail
+ * if no document was found.
+ */
+static int print_docs(const struct mdoc_query *query, const struct cache_opt *cache, 
+                      struct doc_printer *printer) 
 {
-    if (ptr)
-        free_doc_list(ptr);
+    struct mdoc_results *results;
+    struct mdoc_doc *doc;
+    struct mdoc_ctx *ctx;
+    int retval = -1;
+
+    if (new_ctx(&ctx, cache))
+        return -1;
+
+    if (memstats_get_limit()) {
+        if (!mdoc_search(ctx, query, print_streamed_doc, printer))
+            retval = 0;
+    } else if (!mdoc_search_results(ctx, query, &results)) {
+        retval = 0;
 
-    free_users_configs(configs);
+        stats_enter(STATS_OUTPUT);
+        for (doc=mdoc_results_first(results); doc && !retval; doc=mdoc_doc_next(doc))
+            retval = print_doc(doc, printer);
+        stats_leave();
+
+        mdoc_results_free(results);
+    }
+    mdoc_ctx_free(ctx);
+
+    return printer->printed ? 
+        retval : -1;
 }
 
 
-static struct doc_list *rearrange_if_needed(struct doc_list *list, 
-                                            bool sort, bool reverse) 
+/*
+ * Print the new documents as they're found, and flush them before
+ * the watch waits for more.
+ */
+static int print_watched_doc(struct mdoc_doc *doc, void *arg) 
 {
-    struct doc_list *rearranged = list;
+    int retval;
+
+    if (doc)
+        return print_streamed_doc(doc, arg);
 
-    if (sort)
-        rearranged = sort_docs_names_alpha(rearranged);
-    if (reverse)
-        rearranged = reverse_doc_list(rearranged);
+    stats_enter(STATS_OUTPUT);
+    retval = out_flush();
+    stats_leave();
 
-    return rearranged;
+    return retval;
 }
 
 
-static int list_opt(const char *str, bool ignore, bool rec, 
-                    bool color, bool sort, bool reverse) 
+/*
+ * Print the found documents, then every matching document that's
+ * added afterwards until the watch fails or is interrupted.
+ */
+static int watch_docs(const struct mdoc_query *query, struct doc_printer *printer) 
 {
-    struct users_configs *configs;
-    struct doc_list *list;
+    struct mdoc_ctx *ctx;
     int retval = -1;
-    
-    if ((configs = get_configs())) {
-        if ((list = search_for_doc_multi_dir(configs->docs_dir_path, 
-                                             str, ignore, rec))) {
-                list = rearrange_if_needed(list, sort, reverse);
-                display_docs_names(list, color);
-                retval = 0;
-        }
-        opts_cleanup(configs, list);
+
+    if (!mdoc_ctx_new(&ctx, NULL)) {
+        if (!mdoc_watch(ctx, query, print_watched_doc, printer))
+            retval = 0;
+        mdoc_ctx_free(ctx);
     }
 
     return retval;
 }
 
 
-static void display_docs_names(const struct doc_list *ptr, bool color)
+static int add_pattern_arg(struct pattern_args *patterns, const char *str)
 {
-    for(; ptr; ptr=ptr->next)
-        display_doc_name(ptr->name, color);
+    const char **strs;
+    unsigned int size;
+
+    if (patterns->num == patterns->size) {
+        size = patterns->size ? 2 * patterns->size : 16;
+        if (!(strs = reallocarray_inf(patterns->strs, size, sizeof(char *))))
+            return -1;
+
+        patterns->strs = strs;
+        patterns->size = size;
+    }
+    patterns->strs[patterns->num++] = str;
+
+    return 0;
 }
 
 
-static int open_doc_list(const struct users_configs *configs, 
-                         const struct doc_list *ptr, bool color) 
+/*
+ * Add every line of the file at path, or of stdin if it's "-", as a
+ * pattern. The empty lines are skipped.
+ */
+static int read_patterns_file(struct pattern_args *patterns, const char *path)
 {
-	int retval;
+    const bool from_stdin = strcmp(path, "-") == 0;
+    int retval = 0;
+    char *line;
+    FILE *fp;
+
+    if (!(fp = from_stdin ? stdin : fopen_inf(path, "r")))
+        return -1;
+
+    for (;;) {
+        clear_error_inf();
+
+        if (!(line = get_line(fp))) {
+            /* Out of memory, or just an empty line */
+            if (*get_last_error_inf())
+                retval = -1;
+            if (retval || feof(fp) || ferror(fp))
+                break;
+            continue;
+        }
 
-	for (; ptr; ptr=ptr->next) {
-		if ((retval = open_doc_path(configs, ptr->path)))
+        if (add_pattern_arg(patterns, line)) {
+            free_inf(line);
+            retval = -1;
             break;
-        
-		print_opening_doc(ptr->name, color);
-	}
-	
-	return retval;
+        }
+    }
+
+    if (!retval && ferror(fp)) {
+        fprintf(stderr, "%s: can't read the patterns file '%s'\n", prog_name_inf, path);
+        retval = -1;
+    }
+
+    if (!from_stdin)
+        fclose_inf(fp);
+
+    return retval;
 }
 
 
-static int open_opt(const char *str, bool ignore, bool rec, bool color, 
-                    bool sort, bool reverse, bool numerous) 
+static void free_pattern_args(struct pattern_args *patterns)
 {
-    struct users_configs *configs;
-    struct doc_list *list;
-    int retval = -1;
-    
-    if ((configs = get_configs())) {
-        if ((list = search_for_doc_multi_dir(configs->docs_dir_path, 
-                                             str, ignore, rec))) {
-            if (numerous) {
-                list = rearrange_if_needed(list, sort, reverse);
-                retval = open_doc_list(configs, list, color);
-            } else if (count_doc_list_nodes(list) == 1) {
-                retval = open_doc_list(configs, list, color);
-            } else {
-                big_docs_num_error();
-            }
+    unsigned int i;
+
+    for (i=patterns->args_num; i<patterns->num; i++)
+        free_inf((char *) patterns->strs[i]);
+
+    free_inf(patterns->strs);
+}
+
+
+/*
+ * Make a query for each pattern, all with the same flags, sort keys and
+ * filters, which were already checked, and limit.
+ */
+static struct mdoc_query **new_batch_queries(const struct pattern_args *patterns, 
+                                             unsigned int flags, const char *sort_keys, 
+                                             unsigned int limit, const char *const *filters)
+{
+    struct mdoc_query **queries;
+    unsigned int i;
+    unsigned int j;
+
+    if (!(queries = calloc_inf(patterns->num, sizeof(struct mdoc_query *))))
+        return NULL;
+
+    for (i=0; i<patterns->num; i++) {
+        if (mdoc_query_new(&queries[i], patterns->strs[i], flags)) {
+            free_batch_queries(queries, i);
+            return NULL;
         }
-        opts_cleanup(configs, list);
+
+        if (sort_keys)
+            mdoc_query_set_sort(queries[i], sort_keys);
+        mdoc_query_set_limit(queries[i], limit);
+
+        for (j=0; j<MDOC_FILTERS_NUM; j++)
+            if (filters[j] && mdoc_query_set_filter(queries[i], j, filters[j])) {
+                free_batch_queries(queries, i + 1);
+                return NULL;
+            }
     }
 
-    return retval;
+    return queries;
 }
 
 
-static void big_docs_num_error() {
-    fprintf(stderr, "%s: can't open file: Several files were found\n", prog_name_inf);
-    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+static void free_batch_queries(struct mdoc_query **queries, unsigned int num)
+{
+    unsigned int i;
+
+    for (i=0; queries && i<num; i++)
+        mdoc_query_free(queries[i]);
+
+    free_inf(queries);
 }
 
 
-static int details_opt(const char *str, bool ignore, bool rec, 
-                       bool color, bool sort, bool reverse) 
+/*
+ * Count the documents of every pattern with a single search, then
+ * print each pattern followed by it's number.
+ */
+static int count_batch(struct mdoc_query *const *queries, const struct pattern_args *patterns,
+                       const struct cache_opt *cache, const struct doc_printer *printer) 
 {
-    struct users_configs *configs;
-    struct doc_list *list;
+    struct record_group group = {.name = "pattern", .str = NULL, .num = 0};
+    struct mdoc_ctx *ctx;
+    unsigned int *nums;
     int retval = -1;
-
-    if ((configs = get_configs())) {
-        if ((list = search_for_doc_multi_dir(configs->docs_dir_path, 
-                                             str, ignore, rec))) {
-            list = rearrange_if_needed(list, sort, reverse);
-            retval = print_docs_details(list, color);
+    unsigned int i;
+
+    if (!(nums = calloc_inf(patterns->num, sizeof(unsigned int))))
+        return -1;
+
+    if (!new_ctx(&ctx, cache)) {
+        if (!mdoc_count_batch(ctx, (const struct mdoc_query *const *) queries, 
+                              patterns->num, nums)) {
+            stats_enter(STATS_OUTPUT);
+            for (i=0; i<patterns->num; i++)
+                if (printer->record) {
+                    group.str = patterns->strs[i];
+                    print_docs_num_record(nums[i], printer->record, &group);
+                } else {
+                    print_pattern(patterns->strs[i], printer->color);
+                    print_docs_num(nums[i], printer->color);
+                }
+            stats_leave();
+            retval = 0;
         }
-        opts_cleanup(configs, list);
+        mdoc_ctx_free(ctx);
     }
-    
+    free_inf(nums);
+
     return retval;
 }
 
 
-static int print_docs_details(const struct doc_list *ptr, bool color)
+/*
+ * Search for the documents of every pattern with a single search, then
+ * print each pattern's documents after it, or with it in their records.
+ * Fail if no document was found for any of them.
+ */
+static int print_batch(struct mdoc_query *const *queries, const struct pattern_args *patterns,
+                       const struct cache_opt *cache, struct doc_printer *printer) 
 {
-	int retval;
+    struct record_group group = {.name = "pattern", .str = NULL, .num = 0};
+    struct mdoc_results **results;
+    struct mdoc_doc *doc;
+    struct mdoc_ctx *ctx;
+    bool printed = 0;
+    int retval = -1;
+    unsigned int i;
 
-	for (;ptr; ptr=ptr->next) {
-		if ((retval = print_doc_details(ptr, color)))
-			break;
+    if (!(results = calloc_inf(patterns->num, sizeof(struct mdoc_results *))))
+        return -1;
 
-        separate_if_needed(ptr->next);
+    if (new_ctx(&ctx, cache)) {
+        free_inf(results);
+        return -1;
     }
 
-	return retval;
+    if (!mdoc_search_results_batch(ctx, (const struct mdoc_query *const *) queries, 
+                                   patterns->num, results)) {
+        retval = 0;
+
+        stats_enter(STATS_OUTPUT);
+        for (i=0; i<patterns->num && !retval; i++) {
+            if (printer->record) {
+                group.str = patterns->strs[i];
+                printer->group = &group;
+            } else {
+                /* The details of the previous pattern end with their own line */
+                if (printer->details && i)
+                    OUT_LITERAL("\n");
+                print_pattern(patterns->strs[i], printer->color);
+            }
+            printer->printed = 0;
+
+            for (doc=mdoc_results_first(results[i]); doc && !retval; doc=mdoc_doc_next(doc))
+                retval = print_doc(doc, printer);
+            printed |= printer->printed;
+
+            mdoc_results_free(results[i]);
+        }
+        stats_leave();
+
+        for (; i<patterns->num; i++)
+            mdoc_results_free(results[i]);
+    }
+    mdoc_ctx_free(ctx);
+    free_inf(results);
+
+    return printed ? 
+        retval : -1;
 }
 
 
 /*
- * Separate the details on each document if needed (if there's 
- * another document after it).
+ * Find the sets of the found documents with the same content and print
+ * each one's documents after it's number, or with the set's number in
+ * their records. Fail if no set was found.
  */
-static void separate_if_needed(const struct doc_list *ptr) 
+static int print_dupes(const struct mdoc_query *query, const struct cache_opt *cache, 
+                       struct doc_printer *printer) 
 {
-    /* const char separator[] = 
-        "-----------------------------"
-        "-----------------------------"
-        "-----------------------------"
-        "-----------------------------"
-        "-----------------------------"
-        "--\n"; 
-    */
-    
-    /* For now the separator will be a new line */
-    const char separator[] = "\n";
+    struct record_group group = {.name = "set", .str = NULL, .num = 0};
+    struct mdoc_dupes *dupes;
+    struct mdoc_doc *doc;
+    struct mdoc_ctx *ctx;
+    int retval = -1;
+    unsigned int num;
+    unsigned int i;
 
-    if (ptr)
-        printf("%s", separator);
+    if (new_ctx(&ctx, cache))
+        return -1;
+
+    if (!mdoc_find_dupes(ctx, query, &dupes)) {
+        retval = 0;
+
+        stats_enter(STATS_OUTPUT);
+        for (i=0; i<mdoc_dupes_num(dupes) && !retval; i++) {
+            if (printer->record) {
+                group.num = i + 1;
+                printer->group = &group;
+            } else {
+                /* The details of the previous set end with their own line */
+                if (printer->details && i)
+                    OUT_LITERAL("\n");
+                for (doc=mdoc_dupes_set(dupes, i), num=0; doc; doc=mdoc_doc_next(doc))
+                    num++;
+                print_dupes_set(num, printer->color);
+            }
+            printer->printed = 0;
+
+            for (doc=mdoc_dupes_set(dupes, i); doc && !retval; doc=mdoc_doc_next(doc))
+                retval = print_doc(doc, printer);
+        }
+        stats_leave();
+
+        if (!mdoc_dupes_num(dupes))
+            retval = -1;
+        mdoc_dupes_free(dupes);
+    }
+    mdoc_ctx_free(ctx);
+
+    return retval;
 }
 
 
-static char *get_opt_arg(const char *last_argv) 
+static int open_opt(const struct mdoc_query *query, const struct cache_opt *cache, 
+                    bool color, bool numerous, enum mdoc_launch launch, bool batch) 
 {
-    char *optarg = NULL;
+    struct mdoc_results *results;
+    struct mdoc_ctx *ctx;
+    int retval = -1;
     
-    if (*last_argv != '-')
-        optarg = (char *) last_argv;
+    if (!new_ctx(&ctx, cache)) {
+        if (!mdoc_search_results(ctx, query, &results)) {
+            if (!mdoc_results_num(results))
+                retval = -1;
+            else if (!numerous && mdoc_results_num(results) != 1)
+                big_docs_num_error();
+            else if (!mdoc_open_results(ctx, results, launch, numerous && batch,
+                                        print_opened_doc, &color))
+                retval = 0;
 
-    return optarg;
+            mdoc_results_free(results);
+        }
+        mdoc_ctx_free(ctx);
+    }
+
+    return retval;
+}
+
+
+static void big_docs_num_error() {
+    fprintf(stderr, "%s: can't open file: Several files were found\n", prog_name_inf);
+    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+}
+
+
+/*
+ * Return the first non-option argument, getopt_long() moves 
+ * them all after the options.
+ */
+static char *get_opt_arg(int argc, char **argv) 
+{
+    return (optind < argc) ? argv[optind] : NULL;
 }
 
 
@@ -301,40 +609,192 @@ static int invalid_arg_err(const int opt)
 }
 
 
+static int missing_long_arg_err(const char *opt) 
+{
+    fprintf(stderr, "%s: missing argument for the '%s' option\n", prog_name_inf, opt);
+    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+
+    return CLI_ERROR;
+}
+
+
+static int invalid_long_arg_err(const char *opt) 
+{
+    fprintf(stderr, "%s: invalid option '%s'\n", prog_name_inf, opt);
+    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+
+    return CLI_ERROR;
+}
+
+
+static int invalid_long_opt_arg_err(const char *opt, const char *arg) 
+{
+    fprintf(stderr, "%s: invalid argument '%s' for the '--%s' option\n", prog_name_inf, arg, opt);
+    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+
+    return CLI_ERROR;
+}
+
+
+static int conflicting_opts_err(const char *opt, const char *other) 
+{
+    fprintf(stderr, "%s: the '%s' option can't be used with '%s'\n", prog_name_inf, opt, other);
+    fprintf(stderr, "Try '%s -h' for more information.\n", prog_name_inf);
+
+    return CLI_ERROR;
+}
+
+
+/*
+ * Parse the --limit argument, which must be a positive number.
+ */
+static int parse_limit(const char *arg, unsigned int *limit) 
+{
+    unsigned long val;
+    char *end;
+
+    if (*arg < '0' || *arg > '9')
+        return -1;
+
+    errno = 0;
+    val = strtoul(arg, &end, 10);
+
+    if (errno || *end != '\0' || !val || val > UINT_MAX)
+        return -1;
+
+    *limit = val;
+
+    return 0;
+}
+
+
+/*
+ * Parse the --mem-limit argument, a positive number of bytes with 
+ * an optional K, M or G suffix for KiB, MiB or GiB.
+ */
+static int parse_mem_size(const char *arg, size_t *size) 
+{
+    unsigned long long val;
+    unsigned int shift;
+    char *end;
+
+    if (*arg < '0' || *arg > '9')
+        return -1;
+
+    errno = 0;
+    val = strtoull(arg, &end, 10);
+
+    switch (*end) {
+    case 'K':
+        shift = 10;
+        end++;
+        break;
+    case 'M':
+        shift = 20;
+        end++;
+        break;
+    case 'G':
+        shift = 30;
+        end++;
+        break;
+    default:
+        shift = 0;
+    }
+
+    if (errno || *end != '\0' || !val || val > (SIZE_MAX >> shift))
+        return -1;
+
+    *size = val << shift;
+
+    return 0;
+}
+
+
 int main(int argc, char **argv) 
 {
-    const char valid_opt[] = ":hgsraincldoRC";
-    /* 
-     * I initialized the options argument pointers
-     * to NULL to get rid of the annoying unaccurate 
-     * -Wmaybe-uninitialized warning when compiling
-     * with GCC.
-     */
-    char *details_arg = NULL;
-    char *count_arg = NULL; 
-    char *open_arg = NULL;
-    char *list_arg = NULL; 
-    bool recursive = 1;
+    const char valid_opt[] = ":hgsrvaincldoRC0";
+    const struct option long_opts[] = {
+        {"sort", required_argument, NULL, SORT_OPT},
+        {"limit", required_argument, NULL, LIMIT_OPT},
+        {"json", no_argument, NULL, JSON_OPT},
+        {"fields", required_argument, NULL, FIELDS_OPT},
+        {"iso", no_argument, NULL, ISO_OPT},
+        {"concurrent", no_argument, NULL, CONCURRENT_OPT},
+        {"detach", no_argument, NULL, DETACH_OPT},
+        {"batch", no_argument, NULL, BATCH_OPT},
+        {"stats", no_argument, NULL, STATS_OPT},
+        {"trace", required_argument, NULL, TRACE_OPT},
+        {"mem-limit", required_argument, NULL, MEM_LIMIT_OPT},
+        {"interactive", no_argument, NULL, INTERACTIVE_OPT},
+        {"cache", optional_argument, NULL, CACHE_OPT},
+        {"watch", no_argument, NULL, WATCH_OPT},
+        {"patterns", required_argument, NULL, PATTERNS_OPT},
+        {"dupes", no_argument, NULL, DUPES_OPT},
+        {"ext", required_argument, NULL, EXT_OPT},
+        {"larger", required_argument, NULL, LARGER_OPT},
+        {"smaller", required_argument, NULL, SMALLER_OPT},
+        {"newer", required_argument, NULL, NEWER_OPT},
+        {"older", required_argument, NULL, OLDER_OPT},
+        {"perm", required_argument, NULL, PERM_OPT},
+        {NULL, 0, NULL, 0}
+    };
+    struct record_spec record = {
+        .fields_num = 0, 
+        .json = 0, 
+        .terminator = '\n'
+    };
+    struct doc_printer printer = {
+        .color = 1,
+        .details = 0,
+        .record = NULL,
+        .printed = 0,
+        .group = NULL
+    };
+    struct cache_opt cache = {.on = 0, .dir = NULL};
+    struct pattern_args patterns = {.strs = NULL, .num = 0, .size = 0, .args_num = 0};
+    /* The file of --patterns, if any */
+    const char *patterns_file = NULL;
+    /* The filters' arguments by their mdoc_filter, NULL if unset */
+    const char *filters[MDOC_FILTERS_NUM] = {NULL};
+    enum mdoc_status status;
+    unsigned int i;
+    /* If not NULL, a query for each of the patterns, searched for at once */
+    struct mdoc_query **queries = NULL;
+    struct mdoc_query *query = NULL;
+    /* The mdoc_query_flags */
+    unsigned int query_flags = 0;
+    /* The --sort keys, or "name" for -s */
+    const char *sort_keys = NULL;
+    unsigned int limit = 0;
+    /* If the documents are printed as machine readable records */
+    bool records = 0;
+    int retval = SUCCES;
+    const char *arg;
     bool generate = 0;
+    bool interactive = 0;
+    bool watch = 0;
+    bool dupes = 0;
     bool numerous = 0;
-    bool reverse = 0;
     bool details = 0;
-    bool ignore = 0;
+    bool iso = 0;
+    enum mdoc_launch launch = MDOC_LAUNCH_WAIT;
+    bool batch = 0;
     bool color = 1;
+    size_t mem_limit;
     bool count = 0;
     bool help = 0;
     bool list = 0;
     bool open = 0;
-    bool sort = 0;
     bool all = 0;
     int opt;
 
     prog_name_inf = argv[0];
+    mdoc_set_error_handler(print_error, NULL);
   
     if (argc == 1)
         display_help(prog_name_inf);
 
-    while ((opt = getopt(argc, argv, valid_opt)) != EOF) 
+    while ((opt = getopt_long(argc, argv, valid_opt, long_opts, NULL)) != EOF) 
         switch (opt) {
         case 'h':
             help = 1;
@@ -343,89 +803,267 @@ int main(int argc, char **argv)
             generate = 1;
             break;
         case 's':
-            sort = 1;
+            /* Just like --sort=name, unless other keys were given */
+            if (!sort_keys)
+                sort_keys = "name";
+            break;
+        case SORT_OPT:
+            sort_keys = optarg;
+            break;
+        case LIMIT_OPT:
+            if (parse_limit(optarg, &limit))
+                return invalid_long_opt_arg_err("limit", optarg);
             break;
         case 'r':
-            reverse = 1;
+            query_flags |= MDOC_QUERY_REVERSE;
+            break;
+        case 'v':
+            query_flags |= MDOC_QUERY_NATURAL;
             break;
         case 'a':
             all = 1;
             break;
         case 'i':
-            ignore = 1;
+            query_flags |= MDOC_QUERY_IGNORE_CASE;
             break;
         case 'n':
             numerous = 1;
             break;
         case 'c':
             count = 1;
-            count_arg = get_opt_arg(argv[argc-1]);
             break;
         case 'l':
             list = 1;
-            list_arg = get_opt_arg(argv[argc-1]);
             break;
         case 'd':
             details = 1;
-            details_arg = get_opt_arg(argv[argc-1]);
             break;
         case 'o':
             open = 1;
-            open_arg = get_opt_arg(argv[argc-1]);
             break;
         case 'R':
-            recursive = 0;
+            query_flags |= MDOC_QUERY_NO_RECURSE;
             break;
         case 'C':
             color = 0;
             break;
+        case '0':
+            records = 1;
+            record.terminator = '\0';
+            break;
+        case JSON_OPT:
+            records = 1;
+            record.json = 1;
+            break;
+        case FIELDS_OPT:
+            records = 1;
+            if (parse_fields_spec(&record, optarg))
+                return invalid_long_opt_arg_err("fields", optarg);
+            break;
+        case ISO_OPT:
+            iso = 1;
+            break;
+        case CONCURRENT_OPT:
+            if (launch != MDOC_LAUNCH_DETACH)
+                launch = MDOC_LAUNCH_CONCURRENT;
+            break;
+        case DETACH_OPT:
+            launch = MDOC_LAUNCH_DETACH;
+            break;
+        case BATCH_OPT:
+            batch = 1;
+            break;
+        case STATS_OPT:
+            stats_enable();
+            memstats_enable();
+            break;
+        case TRACE_OPT:
+            if (!trace_on && trace_start(optarg))
+                return PROG_ERROR;
+            break;
+        case MEM_LIMIT_OPT:
+            if (parse_mem_size(optarg, &mem_limit))
+                return invalid_long_opt_arg_err("mem-limit", optarg);
+            memstats_set_limit(mem_limit);
+            break;
+        case INTERACTIVE_OPT:
+            interactive = 1;
+            break;
+        case CACHE_OPT:
+            if (optarg && !*optarg)
+                return invalid_long_opt_arg_err("cache", optarg);
+            cache.on = 1;
+            cache.dir = optarg;
+            break;
+        case WATCH_OPT:
+            watch = 1;
+            break;
+        case PATTERNS_OPT:
+            patterns_file = optarg;
+            break;
+        case DUPES_OPT:
+            dupes = 1;
+            break;
+        case EXT_OPT:
+        case LARGER_OPT:
+        case SMALLER_OPT:
+        case NEWER_OPT:
+        case OLDER_OPT:
+        case PERM_OPT:
+            filters[opt - EXT_OPT] = optarg;
+            break;
+        case ':':
+            if (optopt >= SORT_OPT)
+                return missing_long_arg_err(argv[optind-1]);
+            return missing_arg_err(optopt);
         default:
+            if (!optopt)
+                return invalid_long_arg_err(argv[optind-1]);
             return invalid_arg_err(optopt);
         }
 
+    /* The sets are only printed by -l and -d, and not as they grow */
+    if (dupes && (count || open || watch || interactive))
+        return conflicting_opts_err("--dupes", count ? "-c" : open ? "-o" : 
+                                               watch ? "--watch" : "--interactive");
+
+    /* The patterns are the arguments, then the --patterns file's lines */
+    for (; (arg = get_opt_arg(argc, argv)); optind++)
+        if (add_pattern_arg(&patterns, arg)) {
+            free_pattern_args(&patterns);
+            return PROG_ERROR;
+        }
+    patterns.args_num = patterns.num;
+
+    if (patterns_file && read_patterns_file(&patterns, patterns_file)) {
+        free_pattern_args(&patterns);
+        return PROG_ERROR;
+    }
+    arg = patterns.num ? patterns.strs[0] : NULL;
+
+    /* The query is made after the options, once the memory is accounted */
+    if (mdoc_query_new(&query, all ? NULL : arg, query_flags)) {
+        free_pattern_args(&patterns);
+        return PROG_ERROR;
+    }
+
+    if (sort_keys && mdoc_query_set_sort(query, sort_keys)) {
+        mdoc_query_free(query);
+        free_pattern_args(&patterns);
+        return invalid_long_opt_arg_err("sort", sort_keys);
+    }
+    mdoc_query_set_limit(query, limit);
+
+    for (i=0; i<MDOC_FILTERS_NUM; i++)
+        if (filters[i] && (status = mdoc_query_set_filter(query, i, filters[i]))) {
+            mdoc_query_free(query);
+            free_pattern_args(&patterns);
+            return (status == MDOC_ERR_INVALID) ? 
+                invalid_long_opt_arg_err(filters_opts[i], filters[i]) : PROG_ERROR;
+        }
+
+    /* Several patterns are searched for at once by -c, -l and -d, the rest take the first */
+    if (!all && patterns.num > 1 && (count || list || details) && !dupes &&
+        !(queries = new_batch_queries(&patterns, query_flags, sort_keys, limit, 
+                                      filters))) {
+        mdoc_query_free(query);
+        free_pattern_args(&patterns);
+        return PROG_ERROR;
+    }
+
+    /* 
+     * The records of -l have only the paths by default, -d has them all.
+     * The interactive mode's commands choose on their own.
+     */
+    if (records && !record.fields_num && !interactive)
+        parse_fields_spec(&record, details ? "path,name,mtime,mode,size" : "path");
+
+    printer.color = color;
+    printer.record = records ? &record : NULL;
+
     if (help) {
         display_help(prog_name_inf);
     
     } else if (generate) {
         if (generate_opt())
-            return PROG_ERROR;
+            retval = PROG_ERROR;
     
+    } else if (interactive) {
+        struct repl_opts repl_opts = {
+            .query_flags = query_flags,
+            .sort_keys = sort_keys,
+            .limit = limit,
+            .filters = filters,
+            .numerous = numerous,
+            .launch = launch,
+            .batch = batch,
+            .cache = cache.on,
+            .cache_dir = cache.dir
+        };
+
+        init_time_cache(&printer.cache, iso);
+
+        if (run_repl(&repl_opts, &printer))
+            retval = PROG_ERROR;
+
     } else if (count) {
-        if (all) 
-            count_arg = NULL;
-        else if (!count_arg)
-            return missing_arg_err('c');
-        
-        if (count_opt(count_arg, ignore, recursive, color))
-            return PROG_ERROR;
+        /* Every document is counted, whatever the --limit */
+        if (!all && !arg)
+            retval = missing_arg_err('c');
+        else if (queries ? count_batch(queries, &patterns, &cache, &printer) :
+                           count_opt(query, &cache, color, printer.record))
+            retval = PROG_ERROR;
     
     } else if (list) {
-        if (all)
-            list_arg = NULL;
-        else if (!list_arg)
-            return missing_arg_err('l');
-        
-        if (list_opt(list_arg, ignore, recursive, color, sort, reverse))
-            return PROG_ERROR;
+        if (!all && !arg)
+            retval = missing_arg_err('l');
+        else if (watch ? watch_docs(query, &printer) : 
+                 dupes ? print_dupes(query, &cache, &printer) : 
+                 queries ? print_batch(queries, &patterns, &cache, &printer) : 
+                 print_docs(query, &cache, &printer))
+            retval = PROG_ERROR;
     
     } else if (details) {
-        if (all)
-            details_arg = NULL;
-        else if (!details_arg)
-            return missing_arg_err('d');
-
-        if (details_opt(details_arg, ignore, recursive, color, sort, reverse))
-            return PROG_ERROR;
+        printer.details = 1;
+        init_time_cache(&printer.cache, iso);
+
+        if (!all && !arg)
+            retval = missing_arg_err('d');
+        else if (watch ? watch_docs(query, &printer) : 
+                 dupes ? print_dupes(query, &cache, &printer) : 
+                 queries ? print_batch(queries, &patterns, &cache, &printer) : 
+                 print_docs(query, &cache, &printer))
+            retval = PROG_ERROR;
     
     } else if (open) {
-        if (all)
-            open_arg = NULL;
-        else if (!open_arg)
-            return missing_arg_err('o');
-
-        if (open_opt(open_arg, ignore, recursive, color, sort, reverse, numerous))
-            return PROG_ERROR;
+        /* A single document is opened only if it's the only one found */
+        if (!numerous)
+            mdoc_query_set_limit(query, 0);
+
+        if (!all && !arg)
+            retval = missing_arg_err('o');
+        else if (open_opt(query, &cache, color, numerous, launch, batch))
+            retval = PROG_ERROR;
     }
+    if (queries)
+        free_batch_queries(queries, patterns.num);
+    mdoc_query_free(query);
+    free_pattern_args(&patterns);
+
+    /* Nothing else is done after a syntax error */
+    if (retval == CLI_ERROR)
+        return retval;
+
+    /* Write whatever was buffered, even after an error */
+    stats_enter(STATS_OUTPUT);
+    if (out_flush())
+        retval = PROG_ERROR;
+    stats_leave();
 
-    return SUCCES;
+    stats_print();
+
+    if (trace_finish())
+        retval = PROG_ERROR;
+
+    return retval;
 }
@@ -11,97 +11,90 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include "exec.h"
 #include "input.h"
 #include "strman.h"
+#include "patterns.h"
 #include "informative.h"
 #include "mdoc.h"
+#include "sort.h"
+#include "stats.h"
+#include "trace.h"
+#include "viewers.h"
 
-#define ANSI_COLOR_RED    "\x1b[31m"
-#define ANSI_COLOR_BLUE   "\x1b[34m"
-#define ANSI_COLOR_GREEN  "\x1b[32m"
-#define ANSI_COLOR_RESET  "\x1b[0m"
+/* Room left in the arguments limit for whatever isn't counted, like xargs */
+#define ARGS_HEADROOM 2048
+/* If the arguments limit is unknown */
+#define ARGS_DEFAULT_MAX (128 * 1024)
+
+
+/* The environment the viewers get, counted in their arguments limit */
+extern char **environ;
 
 
 /* To indicate if an previous error occoured in a functions
    that could overwrite errno with 0 (success) before returning */
-bool prev_error = 0;
+_Thread_local bool prev_error = 0;
 
-/* 
- * A struct for printing the properiet size format 
- * and unit name for the document size.
- */
-struct meas_unit {
-	float size_format;
-	const char *unit_name;
+
+/* The paths of a directory's sub directories, searched after it */
+struct sub_dirs {
+	char **paths;
+	size_t len;
+	size_t size;
 };
 
 
 /*--------------------------------*/
 /*   Static Functions Prototype   */
 /*--------------------------------*/
-static char *get_entry_path(const char *, const char *);
 static struct doc_list *get_last_node(const struct doc_list *);
-static char *prep_open_doc_argv(char **, const char *, const char *, const char *);
 static void adjust_doc_list_members(struct doc_list *, const char *, const char *, const struct stat *); 
-static void display_doc_name_colorful(const char *);
 static bool dot_entry(const char *); 
-static bool check_str_occurrence(const char *, const char *, bool);
-static void display_doc_name_no_color(const char *);
-static unsigned int get_argc_val(const char *);
 static void free_and_null(void **);
-static struct doc_list *get_doc_list_alpha(struct doc_list **, const unsigned int);
 static void *alloc_doc_list();
-static int open_doc(char *const *);
-static unsigned int prep_add_args(char **, char *, unsigned int);
-static struct doc_list *search_for_doc(const char *, const char *, bool, bool);
-static struct doc_list *search_for_doc_retval(struct doc_list *, struct doc_list *,  struct doc_list *);
-static void print_docs_num_color(const unsigned int, const char *);
-static void print_docs_num_no_color(const unsigned int, const char *);
-static void print_opening_doc_color(const char *);
-static void print_opening_doc_no_color(const char *);
-static struct doc_list *search_for_doc_multi_dir_split(char *, const char *, bool, bool);
-static void print_doc_size(off_t, bool);
-static struct meas_unit get_proper_size_format(off_t);
-static float bytes_to_gb(off_t); 
-static float bytes_to_mb(off_t);
-static float bytes_to_kb(off_t);
-static struct meas_unit ret_proper_size_format(float, const char *); 
-static void print_doc_size_color(const struct meas_unit);
-static void print_doc_size_no_color(const struct meas_unit);
-static void print_doc_path(const char *, bool);
-static void print_doc_path_no_color(const char *);
-static void print_doc_path_color(const char *);
-static void print_last_mod_time(const char *, bool);
-static void print_last_mod_time_color(const char *); 
-static void print_last_mod_time_no_color(const char *);
-static void print_doc_modes(const mode_t, bool);
-static void print_doc_modes_color(const mode_t); 
-static void print_doc_modes_no_color(const mode_t); 
-static int search_for_doc_rec(const char *, const char*, bool, bool, struct doc_list **, struct doc_list **);
+static int open_doc(char *const *, struct launcher *);
+static struct doc_list *search_for_doc(const char *, int, struct search_ctx *);
+static bool can_descend(const struct search_ctx *, int);
+static bool has_root_ext(const struct docs_root *, const char *);
+static bool doc_name_matches(const struct search_ctx *, const char *);
+static int doc_stat_matches(const struct search_ctx *, const char *, struct stat **);
+static bool skip_entry(const struct search_ctx *, const struct dirent *, bool);
+static int save_sub_dir(struct sub_dirs *, char *);
+static void free_sub_dirs(struct sub_dirs *);
+static const struct viewer *get_doc_viewer(const struct users_configs *, const char *);
+static size_t get_args_budget(void);
+static unsigned int fill_batch(char **, size_t, const struct doc_list **,
+							   const struct viewer **, unsigned int, unsigned int,
+							   const struct doc_list **);
+static int alloc_batch_arrays(const struct users_configs *, const struct doc_list *,
+							  unsigned int, const struct doc_list ***,
+							  const struct viewer ***);
+static struct doc_list *search_for_doc_roots(const struct docs_root *, unsigned int,
+											 struct search_ctx *);
+static int search_for_doc_rec(const char *, int, struct search_ctx *, struct doc_list **, struct doc_list **);
 static struct doc_list *free_doc_list_node(struct doc_list *);
 static struct doc_list *save_doc(const char *, const char *, const struct stat *);
+static char *copy_doc_name(const char *);
+static int stream_found_doc(struct search_ctx *, char *, const char *, struct stat *);
 static int save_doc_to_proper_var(const char *, const char *, const struct stat *,  struct doc_list **, struct doc_list **);
-static void print_doc_name(const char *, bool);
-static void print_doc_name_color(const char *);
-static void print_doc_name_no_color(const char *);
-static char *get_last_mod_time(const time_t);
+static int save_found_doc(struct search_ctx *, char *, const char *, struct stat *, struct doc_list **, struct doc_list **);
+static bool search_limit_reached(const struct search_ctx *);
+static struct doc_list *search_for_top_docs(const struct docs_root *, unsigned int,
+											struct search_ctx *);
 static void *alloc_stat_struct();
 static struct stat *get_stat_dynamic(const char *);
-static void save_doc_list_nodes(const struct doc_list *, struct doc_list **);
-static void sort_doc_list(struct doc_list **, struct doc_list **, const unsigned int);
-static unsigned int get_smallest_doc_name_i(struct doc_list **, const unsigned int);
-static char *get_add_args_cp(const char *);
-static bool alpha_cmp_no_dynamic(const char *, const char *); 
-static char *get_dirs_path_cp(const char *);
 static void catch_readdir_inf_err();
+static int get_entry_type(const struct dirent *, const char *, struct stat **, mode_t *);
 
 
 
 static void *alloc_doc_list() 
 {
-	return malloc_inf(sizeof(struct doc_list));
+	return malloc_site_inf(sizeof(struct doc_list), MEM_SITE_NODE);
 }
 
 
@@ -122,21 +115,21 @@ static struct doc_list *free_doc_list_node(struct doc_list *ptr)
 {
 	struct doc_list *next = ptr->next;
 
-	free(ptr->path);
-	free(ptr->name);
-	free(ptr->stbuf);
-	free(ptr);
+	free_inf(ptr->path);
+	free_inf(ptr->name);
+	free_inf(ptr->stbuf);
+	free_inf(ptr);
 
 	return next;
 }
 
 
-static char *get_entry_path(const char *dir_path, const char *entry_name) 
+char *get_entry_path(const char *dir_path, const char *entry_name) 
 {
     const size_t path_len = strlen(dir_path) + strlen(entry_name) + 2;
     char *entry_path;
 
-    if ((entry_path = malloc_inf(sizeof(char) * path_len)))
+    if ((entry_path = malloc_site_inf(sizeof(char) * path_len, MEM_SITE_PATH)))
         snprintf(entry_path, path_len, "%s/%s", dir_path, entry_name);
 
     return entry_path;
@@ -165,27 +158,127 @@ static bool dot_entry(const char *entry_name)
 }
 
 
-static struct doc_list *search_for_doc(const char *dir_path, const char *str, 
-                                       bool ignore_case, bool recursive) 
+/*
+ * Return 1 if the sub directories of a directory in the given
+ * depth of the root are searched, otherwise 0.
+ */
+static bool can_descend(const struct search_ctx *ctx, int depth)
+{
+	return ctx->recursive && (ctx->root->max_depth == ROOT_DEPTH_UNLIMITED ||
+							  depth < ctx->root->max_depth);
+}
+
+
+/*
+ * Return 1 if the root has no extensions list or the
+ * name has one of it's extensions, otherwise 0.
+ */
+static bool has_root_ext(const struct docs_root *root, const char *name)
+{
+	const char *dot;
+	unsigned int i;
+
+	if (!root->exts)
+		return 1;
+
+	if (!(dot = strrchr(name, '.')) || dot == name)
+		return 0;
+
+	for (i=0; i<root->exts_num; i++)
+		if (strcasecmp(dot + 1, root->exts[i]) == 0)
+			return 1;
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the document passes the checks of it's name, the
+ * extensions before the name itself, otherwise 0.
+ */
+static bool doc_name_matches(const struct search_ctx *ctx, const char *name)
+{
+	if (!has_root_ext(ctx->root, name) || !plan_matches_ext(&ctx->plan, name))
+		return 0;
+
+	return ctx->patterns ?
+		match_any_pattern(ctx->patterns, name) :
+		check_str_occurrence(name, ctx->str, ctx->ignore_case);
+}
+
+
+/*
+ * Return 1 if the document at path passes the plan's predicates of the
+ * metadata, 0 if it doesn't and -1 on failure. The document is stat'ed
+ * only if the plan has any, and it's metadata is saved in *stbuf so it
+ * won't be fetched again later.
+ */
+static int doc_stat_matches(const struct search_ctx *ctx, const char *path,
+							struct stat **stbuf)
+{
+	if (!ctx->plan.preds_num)
+		return 1;
+
+	if (!*stbuf && !(*stbuf = get_stat_dynamic(path)))
+		return -1;
+
+	return plan_matches_stat(&ctx->plan, *stbuf);
+}
+
+
+/*
+ * Return 1 if the entry is skipped by the root's policies or can't be
+ * a found document nor a searched directory by it's name and type alone,
+ * so it's path isn't built and it's never stat'ed. Otherwise 0.
+ */
+static bool skip_entry(const struct search_ctx *ctx, const struct dirent *entry,
+					   bool descend)
+{
+	if (ctx->root->skip_hidden && entry->d_name[0] == '.')
+		return 1;
+
+	switch (entry->d_type) {
+	case DT_DIR:
+		return !descend;
+	case DT_REG:
+		return !doc_name_matches(ctx, entry->d_name);
+	case DT_UNKNOWN:
+	case DT_LNK:
+		/* It might be a directory, which is known only after stat() */
+		return !descend && !doc_name_matches(ctx, entry->d_name);
+	default:
+		return 1;
+	}
+}
+
+
+/*
+ * Search the directory in the given depth of ctx->root, the
+ * root itself being in the depth of 0.
+ */
+static struct doc_list *search_for_doc(const char *dir_path, int depth, 
+									   struct search_ctx *ctx) 
 {
-	struct doc_list *doc_list_rec_begin = NULL;
-	struct doc_list *current_node_rec = NULL;
+	const bool descend = can_descend(ctx, depth);
+	const uint64_t trace_begin = TRACE_BEGIN();
+	struct sub_dirs sub_dirs = {.paths = NULL, .len = 0, .size = 0};
 	struct doc_list *doc_list_begin = NULL; 
 	struct doc_list *current_node = NULL;
 	struct dirent *entry;
 	struct stat *stbuf;
 	char *new_path;
+	mode_t type;
+	int matches;
+	size_t i;
 	DIR *dp;
 
 	if ((dp = opendir_inf(dir_path))) {
-		/* 
-		 * To distinguish end of stream 
-		 * from an error in readdir_inf()
-		 */
-		errno = 0;
+		/* Before it's read, so the changes while it's read aren't missed */
+		if (ctx->dir_fn && ctx->dir_fn(ctx, dir_path, dirfd(dp), depth))
+			goto err_free_docs_lists;
 
-		while ((entry = readdir_inf(dp))) {
-			if (dot_entry(entry->d_name)) 
+		while (!search_limit_reached(ctx) && (entry = readdir_inf(dp))) {
+			if (dot_entry(entry->d_name) || skip_entry(ctx, entry, descend)) 
 				continue;
 			
 			if (!(new_path = get_entry_path(dir_path, entry->d_name)))
@@ -196,27 +289,46 @@ static struct doc_list *search_for_doc(const char *dir_path, const char *str,
 				 */
 				goto err_free_docs_lists;
 			
-			if (!(stbuf = get_stat_dynamic(new_path)))
+			if (get_entry_type(entry, new_path, &stbuf, &type))
 				/* 
-				 * Failed to allocate stbuf, so free the not passed to a node
-				 * new_path then continue to the rest of the errors labels.
+				 * Failed to get the entry's type, so free the not passed to a
+				 * node new_path then continue to the rest of the errors labels.
 				 */
 				goto err_free_new_path;
 
-			if (S_ISDIR(stbuf->st_mode)) {
-				if (recursive)
-					if (search_for_doc_rec(new_path, str, ignore_case, recursive, 
-										   &doc_list_rec_begin, &current_node_rec))
+			if (S_ISDIR(type)) {
+				/* The file system is known only after stat() */
+				if (descend && ctx->root->one_file_system && !stbuf &&
+					!(stbuf = get_stat_dynamic(new_path)))
+					goto err_free_new_path;
+
+				if (descend && (!ctx->root->one_file_system || 
+								stbuf->st_dev == ctx->root_dev)) {
+					if (save_sub_dir(&sub_dirs, new_path))
 						/*
 						 * Both stbuf and new_path are allocated and not passed to
 						 * a doc_list node. So jump to the first label on the errors
 						 * cleanup and start freeing all the allocated variables.
 						 */
 						goto err_free_stbuf;
-			} else if (S_ISREG(stbuf->st_mode)) {
-				if (check_str_occurrence(entry->d_name, str, ignore_case)) {
-					if (save_doc_to_proper_var(new_path, entry->d_name, stbuf, 
-											   &doc_list_begin, &current_node))
+
+					free_inf(stbuf);
+					continue;
+				}
+			} else if (S_ISREG(type)) {
+				/*
+				 * The cheapest checks first, the metadata is fetched last. The
+				 * name was checked by skip_entry(), unless the entry's type was
+				 * only known after stat() and it might have been a directory.
+				 */
+				if ((entry->d_type == DT_REG || !descend ||
+					 doc_name_matches(ctx, entry->d_name)) &&
+					(matches = doc_stat_matches(ctx, new_path, &stbuf))) {
+					if (matches == -1)
+						goto err_free_new_path;
+
+					if (save_found_doc(ctx, new_path, entry->d_name, stbuf, 
+									   &doc_list_begin, &current_node))
 						/*
 						 * Both stbuf and new_path are allocated and not passed to
 						 * a doc_list node. So jump to the first label on the errors
@@ -227,20 +339,25 @@ static struct doc_list *search_for_doc(const char *dir_path, const char *str,
 					continue;
 				} 
 			} 
-			free(new_path);
-			free(stbuf);
+			free_inf(new_path);
+			free_inf(stbuf);
 		}
-		catch_readdir_inf_err();
+		/* Otherwise the last readdir_inf() returned the end of the stream or an error */
+		if (!search_limit_reached(ctx))
+			catch_readdir_inf_err();
 
 		if (closedir_inf(dp) || prev_error) {
 			dp = NULL;
 			/* 
 			 * The not passed (to a doc_list node) new_path and stbuf would
 			 * be already freed at the end of the loop. Only structs of 
-			 * doc_list may be allocated, so free them.
+			 * doc_list and the sub directories may be allocated, so free them.
 			 */
 			goto err_free_docs_lists;
 		}
+		dp = NULL;
+		/* The sub directories are traced on their own */
+		TRACE_END("scan", dir_path, trace_begin);
 	} else {
 		/* 
 		 * No variables were allocated, just mark
@@ -249,17 +366,29 @@ static struct doc_list *search_for_doc(const char *dir_path, const char *str,
 		goto err_out;	
 	}
 
-	return search_for_doc_retval(current_node, doc_list_begin, doc_list_rec_begin);
+	/*
+	 * The sub directories are searched after the directory is closed, so
+	 * the open directories won't pile up and the documents are found in 
+	 * the same order they're listed in: the directory's own documents 
+	 * first, then the sub directories' ones.
+	 */
+	for (i=0; i<sub_dirs.len && !search_limit_reached(ctx); i++)
+		if (search_for_doc_rec(sub_dirs.paths[i], depth + 1, ctx, 
+							   &doc_list_begin, &current_node))
+			goto err_free_docs_lists;
+
+	free_sub_dirs(&sub_dirs);
+
+	return doc_list_begin;
 
 err_free_stbuf:
-	free(stbuf);
+	free_inf(stbuf);
 err_free_new_path:
-	free(new_path);
+	free_inf(new_path);
 err_free_docs_lists:
+	free_sub_dirs(&sub_dirs);
 	if (doc_list_begin)
 		free_doc_list(doc_list_begin);
-	if (doc_list_rec_begin)
-		free_doc_list(doc_list_rec_begin);
 err_out:	
 	if (dp)
 		closedir_inf(dp);
@@ -270,6 +399,80 @@ err_out:
 }
 
 
+/*
+ * Save the path of a sub directory to be searched after it's parent.
+ * On success sub_dirs takes the ownership of path.
+ */
+static int save_sub_dir(struct sub_dirs *sub_dirs, char *path)
+{
+	char **paths;
+	size_t size;
+
+	if (sub_dirs->len == sub_dirs->size) {
+		size = sub_dirs->size ? sub_dirs->size * 2 : 8;
+
+		if (!(paths = reallocarray_inf(sub_dirs->paths, size, sizeof(char *))))
+			return -1;
+
+		sub_dirs->paths = paths;
+		sub_dirs->size = size;
+	}
+	sub_dirs->paths[sub_dirs->len++] = path;
+
+	return 0;
+}
+
+
+static void free_sub_dirs(struct sub_dirs *sub_dirs)
+{
+	size_t i;
+
+	for (i=0; i<sub_dirs->len; i++)
+		free_inf(sub_dirs->paths[i]);
+
+	free_inf(sub_dirs->paths);
+}
+
+
+/*
+ * Get the file type of the entry without calling stat() when readdir() 
+ * already knows it. Otherwise the entry is stat'ed and the metadata is 
+ * saved in *stbuf so it won't be fetched again later, else *stbuf is 
+ * set to NULL and the metadata is fetched lazily by get_doc_stat().
+ */
+static int get_entry_type(const struct dirent *entry, const char *path,
+						  struct stat **stbuf, mode_t *type)
+{
+	*stbuf = NULL;
+
+	/* Symbolic links are followed just like stat() does */
+	if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+		*type = DTTOIF(entry->d_type);
+		return 0;
+	}
+
+	if (!(*stbuf = get_stat_dynamic(path)))
+		return -1;
+
+	*type = (*stbuf)->st_mode & S_IFMT;
+
+	return 0;
+}
+
+
+/*
+ * Return the document's metadata, fetching it on the first use since
+ * the search stats only the entries it has to. Return NULL on failure.
+ */
+const struct stat *get_doc_stat(struct doc_list *doc)
+{
+	if (!doc->stbuf)
+		doc->stbuf = get_stat_dynamic(doc->path);
+
+	return doc->stbuf;
+}
+
+
 static struct stat *get_stat_dynamic(const char *path)
 {
 	struct stat *stbuf;
@@ -284,7 +487,7 @@ static struct stat *get_stat_dynamic(const char *path)
 
 static void *alloc_stat_struct()
 {
-	return malloc_inf(sizeof(struct stat));
+	return malloc_site_inf(sizeof(struct stat), MEM_SITE_STAT);
 }
 
 
@@ -309,6 +512,79 @@ static int save_doc_to_proper_var(const char *doc_path, const char *doc_name,
 }
 
 
+/*
+ * Pass the found document to ctx->stream, then free it's path and 
+ * metadata. On failure they're left to the caller's cleanup, just
+ * like save_found_doc() does, except the metadata fetched by the
+ * stream itself.
+ */
+static int stream_found_doc(struct search_ctx *ctx, char *doc_path, 
+							const char *doc_name, struct stat *stbuf)
+{
+	struct doc_list node;
+
+	adjust_doc_list_members(&node, doc_path, doc_name, stbuf);
+
+	if (ctx->stream(&node, ctx->stream_arg)) {
+		if (node.stbuf != stbuf)
+			free_inf(node.stbuf);
+		return -1;
+	}
+	free_inf(node.path);
+	free_inf(node.stbuf);
+
+	return 0;
+}
+
+
+/*
+ * Save the found document either to the search's stream, to the
+ * search's top documents, or to the list of it's directory.
+ */
+static int save_found_doc(struct search_ctx *ctx, 
+						  char *doc_path, const char *doc_name,
+						  struct stat *stbuf,
+						  struct doc_list **doc_list_begin, 
+						  struct doc_list **current_node)
+{
+	struct doc_list *node;
+
+	ctx->found++;
+	STATS_COUNT(STATS_MATCHES, 1);
+
+	if (ctx->stream)
+		return stream_found_doc(ctx, doc_path, doc_name, stbuf);
+
+	if (!ctx->top)
+		return save_doc_to_proper_var(doc_path, doc_name, stbuf, 
+									  doc_list_begin, current_node);
+
+	if (!(node = save_doc(doc_path, doc_name, stbuf)))
+		return -1;
+
+	if (add_top_doc(ctx->top, node)) {
+		/* Leave doc_path and stbuf to the caller's cleanup, except the metadata fetched for the key */
+		node->path = NULL;
+		if (node->stbuf == stbuf)
+			node->stbuf = NULL;
+		free_doc_list(node);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the search was limited to the first found 
+ * documents and they were all found, otherwise 0.
+ */
+static bool search_limit_reached(const struct search_ctx *ctx)
+{
+	return ctx->limit && !ctx->top && ctx->found >= ctx->limit;
+}
+
+
 static void adjust_doc_list_members(struct doc_list *current_node, 
                                     const char *doc_path, 
 									const char *doc_name, 
@@ -329,7 +605,7 @@ static struct doc_list *save_doc(const char *doc_path,
 	char *doc_name_cp;
 
 	if ((node = alloc_doc_list())) {
-		if((doc_name_cp = strcpy_dynamic(doc_name)))
+		if((doc_name_cp = copy_doc_name(doc_name)))
 			adjust_doc_list_members(node, doc_path, doc_name_cp, stbuf);
 		else
 			free_and_null((void **) &node);
@@ -339,9 +615,21 @@ static struct doc_list *save_doc(const char *doc_path,
 }
 
 
-static bool check_str_occurrence(const char *name, 
-								 const char *str, 
-								 bool ignore) 
+static char *copy_doc_name(const char *doc_name)
+{
+	const size_t len = strlen(doc_name) + 1;
+	char *doc_name_cp;
+
+	if ((doc_name_cp = malloc_site_inf(sizeof(char) * len, MEM_SITE_NAME)))
+		memcpy(doc_name_cp, doc_name, len);
+
+	return doc_name_cp;
+}
+
+
+bool check_str_occurrence(const char *name, 
+						  const char *str, 
+						  bool ignore) 
 {
 	/* If str is NULL, save every 
 	   file name to the linked list */
@@ -356,46 +644,6 @@ static bool check_str_occurrence(const char *name,
 }
 
 
-static struct doc_list *search_for_doc_retval(struct doc_list *current_node, 
-                                              struct doc_list *doc_list_begin,
-                                              struct doc_list *doc_list_rec_begin) 
-{
-	if (doc_list_begin) {
-		if (doc_list_rec_begin)
-			current_node->next = doc_list_rec_begin;
-		return doc_list_begin;
-	} else if (doc_list_rec_begin) {
-		return doc_list_rec_begin;
-	} else {
-		return NULL;
-	}
-}
-
-
-void display_doc_name(const char *name, bool color_status) 
-{
-		if (color_status)
-			display_doc_name_colorful(name);
-		else
-			display_doc_name_no_color(name);
-
-}
-
-
-static void display_doc_name_colorful(const char *name) 
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "+" ANSI_COLOR_BLUE "]" 
-		   ANSI_COLOR_RED " %s" ANSI_COLOR_RESET "\n", 
-		   name);
-}
-
-
-static void display_doc_name_no_color(const char *name) 
-{
-	printf("[+] %s\n", name);
-}
-
-
 unsigned int count_doc_list_nodes(const struct doc_list *ptr) 
 {
 	unsigned int i;
@@ -409,265 +657,216 @@ unsigned int count_doc_list_nodes(const struct doc_list *ptr)
 
 static void free_and_null(void **ptr) 
 {
-	free(*ptr);
+	free_inf(*ptr);
 	*ptr = NULL;
 }
 
 
 /*
- * The funtion will return the address of the dynamic copy of add_args
- * (if there was any) so open_founded_doc_path() could free it after 
- * finishing from the argv.
+ * Execute the viewer and wait for it to exit, or just start it if
+ * a launcher is passed.
  */
-static char *prep_open_doc_argv(char **argv, const char *pdf_viewer, 
-                                const char *add_args, const char *doc_path) 
-{
-	char *add_args_cp = NULL;
-	unsigned int i = 0;
-
-	argv[i++] = (char *) pdf_viewer;
-
-	if (add_args)
-		if ((add_args_cp = get_add_args_cp(add_args)))
-			i = prep_add_args(argv, add_args_cp, i);
-
-	argv[i++] = (char *) doc_path;
-	argv[i] = NULL;
-
-	return add_args_cp;
-}
-
-
-static char *get_add_args_cp(const char *add_args)
+static int open_doc(char *const *argv, struct launcher *launcher) 
 {
-	char *add_args_cp;
+	if (launcher)
+		return launch_process(launcher, argv[0], argv);
 
-	if (!(add_args_cp = strcpy_dynamic(add_args)))
-		/* To distinguish between an error and empty add_args */
-		prev_error = 1;
-
-	return add_args_cp;
+	return execvp_process(argv[0], argv);
 }
 
 
 /*
- * Prepare the additional arguments in the argv and return the index
- * of the next i.
+ * Return the viewer of the document's extension, or the default one.
  */
-static unsigned int prep_add_args(char **argv, char *add_args, unsigned int i) 
+static const struct viewer *get_doc_viewer(const struct users_configs *configs,
+										   const char *doc_path)
 {
-	unsigned int ret;
+	const struct viewer *viewer;
 
-	for (; (ret = space_to_null(add_args)); add_args+=ret)
-		/* In case someone wrote more than one space;
-		   which will lead to a segmentation fault */
-		if (*add_args != '\0')
-			argv[i++] = add_args;
+	if ((viewer = find_viewer(configs->viewers, doc_path)))
+		return viewer;
 
-	return i;
+	return &configs->viewer;
 }
 
 
-static int open_doc(char *const *argv) 
+/*
+ * Open the document with a copy of it's viewer's argv that was built 
+ * when the configurations were read, which is shared by the threads.
+ */
+int open_doc_path(const struct users_configs *configs, const char *doc_path,
+				  struct launcher *launcher) 
 {
-	return execvp_process(argv[0], argv);
-}
-
+	const struct viewer *viewer = get_doc_viewer(configs, doc_path);
+	char **argv;
+	int retval;
 
-int open_doc_path(const struct users_configs *configs, const char *doc_path) 
-{
-    const unsigned int argc = get_argc_val(configs->add_args);
-    char *argv[argc+1];
-	char *add_args_cp;
-	int retval = -1;
+	/* The viewer's own arguments, the document and the NULL */
+	if (!(argv = malloc_inf(sizeof(char *) * (viewer->argc + 2))))
+		return -1;
 
-	add_args_cp = prep_open_doc_argv(argv, configs->pdf_viewer, 
-									 configs->add_args, doc_path);
-	if (!prev_error) {
-		retval = open_doc(argv);
+	memcpy(argv, viewer->argv, sizeof(char *) * viewer->argc);
+	argv[viewer->argc] = (char *) doc_path;
+	argv[viewer->argc + 1] = NULL;
 
-		if (add_args_cp)
-			free(add_args_cp);
-	}
+	retval = open_doc(argv, launcher);
+	free_inf(argv);
 
-    return retval;
+	return retval;
 }
 
 
-static unsigned int get_argc_val(const char *add_args) 
+/*
+ * Return how many bytes of arguments a viewer can get, after the
+ * environment which shares the same limit.
+ */
+static size_t get_args_budget(void)
 {
-	/* The 2 stands for doc_path and pdf_viewer */
-	unsigned int val = 2;
+	long arg_max = sysconf(_SC_ARG_MAX);
+	size_t env_size = 0;
+	char **env;
 
-	if (add_args)
-		val += count_words(add_args);
+	if (arg_max <= 0)
+		arg_max = ARGS_DEFAULT_MAX;
 
-	return val;
-}
+	for (env=environ; *env; env++)
+		env_size += strlen(*env) + 1 + sizeof(char *);
 
+	if ((size_t) arg_max <= env_size + ARGS_HEADROOM)
+		return 0;
 
-void print_opening_doc(const char *doc_name, bool color) 
-{
-	if (color)
-		print_opening_doc_color(doc_name);
-	else 
-		print_opening_doc_no_color(doc_name);
+	return arg_max - env_size - ARGS_HEADROOM;
 }
 
 
 /*
- * The main reason I chose to follow this method (using another functions)
- * for printing colored outputs is to decrease the confusion that
- * may occur while seeing a printf() call with lots of macros.
+ * Fill argv after the viewer's own arguments with the paths of the
+ * documents from start on that have the same viewer, as many as fit
+ * in the budget and at least one. The taken documents are removed from
+ * docs and saved in batch. Return the number of documents in the batch.
  */
-static void print_opening_doc_color(const char *doc_name)
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "OPENING" ANSI_COLOR_BLUE "]" 
-           ANSI_COLOR_RED " %s\n" ANSI_COLOR_RESET, 
-           doc_name);
-}
-
-
-static void print_opening_doc_no_color(const char *doc_name)
-{
-	printf("[OPENING] %s\n", doc_name);
-}
-
-
-void print_docs_num(const unsigned int docs_num, bool color) 
-{
-	const char *file = (docs_num == 1) ? 
-        "File" : "Files";
+static unsigned int fill_batch(char **argv, size_t budget,
+							   const struct doc_list **docs,
+							   const struct viewer **viewers,
+							   unsigned int start, unsigned int docs_num,
+							   const struct doc_list **batch)
+{
+	const struct viewer *const viewer = viewers[start];
+	unsigned int argc = viewer->argc;
+	unsigned int batch_num = 0;
+	unsigned int i;
+	size_t size;
 
-	if (color)
-		print_docs_num_color(docs_num, file);
-	else
-		print_docs_num_no_color(docs_num, file);
-}
+	for (i=0; i<viewer->argc; i++) {
+		size = strlen(argv[i]) + 1 + sizeof(char *);
+		budget = (size < budget) ? budget - size : 0;
+	}
 
+	for (i=start; i<docs_num; i++) {
+		if (!docs[i] || viewers[i] != viewer)
+			continue;
 
-static void print_docs_num_color(const unsigned int num, 
-		                         const char *file_word)
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "COUNTED" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " %d %s\n" ANSI_COLOR_RESET,
-		   num, file_word);
-}
+		size = strlen(docs[i]->path) + 1 + sizeof(char *);
+		if (size > budget && batch_num)
+			break;
+		budget = (size < budget) ? budget - size : 0;
 
+		argv[argc++] = docs[i]->path;
+		batch[batch_num++] = docs[i];
+		docs[i] = NULL;
+	}
+	argv[argc] = NULL;
 
-static void print_docs_num_no_color(const unsigned int num, 
-		                            const char *file_word) 
-{
-	printf("[COUNTED] %d %s\n", num, file_word);
+	return batch_num;
 }
 
 
 /*
- * Return a pointer to a rearranged ptr
+ * Save the documents and their viewers in arrays, so they can be
+ * grouped without looking up the viewers again.
  */
-struct doc_list *sort_docs_names_alpha(const struct doc_list *ptr) 
+static int alloc_batch_arrays(const struct users_configs *configs,
+							  const struct doc_list *list, unsigned int docs_num,
+							  const struct doc_list ***docs,
+							  const struct viewer ***viewers)
 {
-	const unsigned int nodes_num = count_doc_list_nodes(ptr);
-	struct doc_list *unsorted_array[nodes_num];
-	struct doc_list *sorted_array[nodes_num];
-
-	save_doc_list_nodes(ptr, unsorted_array);
-	sort_doc_list(unsorted_array, sorted_array, nodes_num);
-
-	return get_doc_list_alpha(sorted_array, nodes_num);
-}
+	unsigned int i;
 
+	*viewers = NULL;
 
-static void sort_doc_list(struct doc_list **unsorted_array, 
-						  struct doc_list **sorted_array, 
-						  const unsigned int nodes_num)
-{
-	unsigned int i, ret;
+	if (!(*docs = malloc_inf(sizeof(struct doc_list *) * docs_num)))
+		return -1;
 
-	for (i=0; i<nodes_num; i++) {
-		ret = get_smallest_doc_name_i(unsorted_array, nodes_num);
-		sorted_array[i] = unsorted_array[ret];
-		unsorted_array[ret] = NULL;
+	if (!(*viewers = malloc_inf(sizeof(struct viewer *) * docs_num))) {
+		free_inf(*docs);
+		return -1;
 	}
-}
-
-
-static unsigned int get_smallest_doc_name_i(struct doc_list **array, 
-											const unsigned int nodes_num)
-{
-	/* 
-     * I initialized smallest_i to zero get rid of the 
-	 * unaccurate -Wmaybe-uninitialized warning when 
-	 * compiling with GCC.
-     */
-	unsigned int smallest_i = 0;
-	char *smallest = NULL;
-	char *current;
-	unsigned int i;
-	
-	for (i=0; i<nodes_num; i++) {
-		if (!array[i])
-			continue;
-
-		if (smallest) {
-			current = array[i]->name;
-			/* If current word needs to come before smallest word */
-			if(alpha_cmp_no_dynamic(smallest, current)) {
-				smallest = current;
-				smallest_i = i;
-			}
-		} else {
-			smallest = array[i]->name;
-			smallest_i = i;
-		}
+	for (i=0; list; list=list->next, i++) {
+		(*docs)[i] = list;
+		(*viewers)[i] = get_doc_viewer(configs, list->path);
 	}
 
-	return smallest_i;
+	return 0;
 }
 
 
 /*
- * Make a copy of assumed_smaller and word_to_check, convert it to lower 
- * case and call the original alpha_cmp(). I'm using this method instead 
- * of calling small_let_copy() which creates a dynamically allocated small 
- * letter copy of the string so the function sort_docs_names_alpha() will
- * be failure free.
+ * Open the documents grouped by their viewers, so every viewer is
+ * executed once with as many documents as the arguments limit allows,
+ * in the order of their first documents. Every document of a batch is
+ * passed to opened with arg once it's viewer was executed.
  */
-static bool alpha_cmp_no_dynamic(const char *assumed_smaller, 
-								 const char *word_to_check) 
-{
-	const size_t assumed_smaller_len = strlen(assumed_smaller) + 1;
-	const size_t word_to_check_len = strlen(word_to_check) + 1;
-	char assumed_smaller_cp[assumed_smaller_len];
-	char word_to_check_cp[word_to_check_len];
+int open_doc_list_batched(const struct users_configs *configs,
+						  const struct doc_list *list,
+						  struct launcher *launcher,
+						  int (*opened)(struct doc_list *, void *), void *arg)
+{
+	const unsigned int docs_num = count_doc_list_nodes(list);
+	const size_t budget = get_args_budget();
+	const struct doc_list **batch = NULL;
+	const struct doc_list **docs;
+	const struct viewer **viewers;
+	unsigned int batch_num;
+	unsigned int i, j;
+	char **argv = NULL;
+	int retval = -1;
 
-	memcpy(assumed_smaller_cp, assumed_smaller, assumed_smaller_len);
-	memcpy(word_to_check_cp, word_to_check, word_to_check_len);
-	
-	convert_to_lower(assumed_smaller_cp);
-	convert_to_lower(word_to_check_cp);
+	if (alloc_batch_arrays(configs, list, docs_num, &docs, &viewers))
+		return -1;
 
-	return alpha_cmp(assumed_smaller_cp, word_to_check_cp);
-}
+	if (!(batch = malloc_inf(sizeof(struct doc_list *) * docs_num)))
+		goto cleanup;
+
+	for (i=0; i<docs_num; i++) {
+		if (!docs[i])
+			continue;
 
+		/* The viewer's own arguments, the documents and the NULL */
+		if (!(argv = malloc_inf(sizeof(char *) * 
+								(viewers[i]->argc + docs_num + 1))))
+			goto cleanup;
 
-static struct doc_list *get_doc_list_alpha(struct doc_list **sorted_array, 
-										   const unsigned int nodes_num) 
-{
-	struct doc_list *sorted = NULL;
-	struct doc_list *current_node;
-	unsigned int i;
+		memcpy(argv, viewers[i]->argv, sizeof(char *) * viewers[i]->argc);
+		batch_num = fill_batch(argv, budget, docs, viewers, i, docs_num, batch);
 
-	for (i=0; i<nodes_num; i++) {
-		if (!sorted)
-			current_node = sorted = sorted_array[i];
-		else
-			current_node = current_node->next = sorted_array[i];
-		/* In case this node is the last one */
-		current_node->next = NULL;
+		if (open_doc(argv, launcher))
+			goto cleanup;
+
+		for (j=0; j<batch_num; j++)
+			if (opened((struct doc_list *) batch[j], arg))
+				goto cleanup;
+
+		free_and_null((void **) &argv);
 	}
+	retval = 0;
+
+cleanup:
+	free_inf(argv);
+	free_inf(batch);
+	free_inf(docs);
+	free_inf(viewers);
 
-	return sorted;
+	return retval;
 }
 
 
@@ -676,86 +875,98 @@ static struct doc_list *get_doc_list_alpha(struct doc_list **sorted_array,
  */
 struct doc_list *reverse_doc_list(const struct doc_list *ptr) 
 {
-	const unsigned int nodes_num = count_doc_list_nodes(ptr);
-	struct doc_list *nodes_array[nodes_num];
 	struct doc_list *reversed = NULL;
 	struct doc_list *current_node;
-	long int i;
+	struct doc_list *next;
 
-	save_doc_list_nodes(ptr, nodes_array);
-	
-	for (i=nodes_num-1; i>-1; i--) {
-		if (!reversed)
-			current_node = reversed = nodes_array[i];
-		else 
-			current_node = current_node->next = nodes_array[i];
-		/* In case this node is the last one */
-		current_node->next = NULL;
+	for (current_node=(void *) ptr; current_node; current_node=next) {
+		next = current_node->next;
+		current_node->next = reversed;
+		reversed = current_node;
 	}
 
 	return reversed;
 }
 
 
-static void save_doc_list_nodes(const struct doc_list *ptr, 
-								struct doc_list **nodes_array)
+struct doc_list *search_for_doc_multi_dir(const struct docs_root *roots, 
+										  unsigned int roots_num,
+										  struct search_ctx *ctx) 
 {
-	unsigned int i;
+	struct doc_list *list;
 
-	for (i=0; ptr; ptr=ptr->next)
-		nodes_array[i++] = (void *) ptr;
-}
+	ctx->found = 0;
+	ctx->top = NULL;
 
+	stats_enter(STATS_SCAN);
 
-struct doc_list *search_for_doc_multi_dir(const char *dirs_path, const char *str, 
-                                          bool ignore_case, bool rec) 
-{
-	struct doc_list *list = NULL;
-	char *dirs_path_cp; 
+	if (ctx->limit && ctx->sort && ctx->sort->keys_num && !ctx->stream)
+		list = search_for_top_docs(roots, roots_num, ctx);
+	else
+		list = search_for_doc_roots(roots, roots_num, ctx);
 
-	if ((dirs_path_cp = get_dirs_path_cp(dirs_path))) {
-		list = search_for_doc_multi_dir_split(dirs_path_cp, str, ignore_case, rec);	
-		free(dirs_path_cp);
-	}
+	stats_leave();
 
 	return list;
 }
 
 
-static char *get_dirs_path_cp(const char *dirs_path)
+/*
+ * Keep only the top ctx->limit documents by ctx->sort in a bounded 
+ * heap while searching, instead of saving every found document.
+ */
+static struct doc_list *search_for_top_docs(const struct docs_root *roots, 
+											unsigned int roots_num,
+											struct search_ctx *ctx)
 {
-	char *dirs_path_cp;
+	struct doc_list *list = NULL;
 
-	if (!(dirs_path_cp = strcpy_dynamic(dirs_path)))
-		/* 
-		 * To make sure that count_opt() in main.c 
-		 * knows that an error occured 
-		 */
+	if ((ctx->top = alloc_top_docs(ctx->sort, ctx->limit))) {
+		search_for_doc_roots(roots, roots_num, ctx);
+
+		if (!prev_error)
+			list = get_top_docs_list(ctx->top);
+
+		free_top_docs(ctx->top);
+		ctx->top = NULL;
+	} else {
 		prev_error = 1;
+	}
 
-	return dirs_path_cp;
+	return list;
 }
 
 
 /* 
- * Split dirs_path into one dir path at a time by converting
- * each space with a null byte, then check for documents with 
- * the sequence str in them one path at a time.
+ * Check for documents with the sequence str in them 
+ * one root at a time, each by it's own policies.
  */
-static struct doc_list *search_for_doc_multi_dir_split(char *dirs_path, 
-													   const char *str,
-													   bool ignore_case, 
-													   bool rec)
+static struct doc_list *search_for_doc_roots(const struct docs_root *roots, 
+											 unsigned int roots_num,
+											 struct search_ctx *ctx)
 {
 	struct doc_list *doc_list_begin = NULL;
 	struct doc_list *current_node;
-	unsigned int ret;
+	struct stat stbuf;
+	unsigned int i;
+
+	for (i=0; i<roots_num && !search_limit_reached(ctx); i++) {
+		ctx->root = &roots[i];
 
-	for (; (ret = space_to_null(dirs_path)); dirs_path+=ret)
-		if (*dirs_path != '\0') 
-			if (search_for_doc_rec(dirs_path, str, ignore_case, rec, 
-			 					   &doc_list_begin, &current_node))
+		/* None of it's documents can be found, so it's not even opened */
+		if (plan_rules_out_root(&ctx->plan, &roots[i]))
+			continue;
+
+		if (roots[i].one_file_system) {
+			if (stat_inf(roots[i].path, &stbuf)) {
+				prev_error = 1;
 				goto err_out;
+			}
+			ctx->root_dev = stbuf.st_dev;
+		}
+		if (search_for_doc_rec(roots[i].path, 0, ctx, &doc_list_begin, &current_node))
+			goto err_out;
+	}
 
 	return doc_list_begin;
 
@@ -767,243 +978,70 @@ err_out:
 }
 
 
-static struct meas_unit get_proper_size_format(off_t bytes) 
-{
-	const off_t gb = 1000000000;
-	const off_t mb = 1000000;
-	const off_t kb = 1000;
-
-	if (bytes >= gb) 
-		return ret_proper_size_format(bytes_to_gb(bytes), "GB");
-
-	else if (bytes >= mb)
-		return ret_proper_size_format(bytes_to_mb(bytes), "MB");
-
-	else if (bytes >= kb)
-		return ret_proper_size_format(bytes_to_kb(bytes), "KB");
-
-	else 
-		return ret_proper_size_format(bytes, "B");
-}
-
-
-static struct meas_unit ret_proper_size_format(float size_format, 
-	                                           const char *unit_name) 
-{
-	struct meas_unit retval;
-
-	retval.size_format = size_format;
-	retval.unit_name = unit_name;
-
-	return retval; 
-}
-
-
-static float bytes_to_gb(off_t bytes) 
-{
-	return (float) bytes / 1000000000.0; 
-}
-
-
-static float bytes_to_mb(off_t bytes) 
-{
-	return (float) bytes / 1000000.0;
-}
-
-
-static float bytes_to_kb(off_t bytes) 
-{ 
-	return (float) bytes / 1000.0;
-}
-
-
-static void print_doc_size(off_t bytes, bool color)  
-{
-	const struct meas_unit format = get_proper_size_format(bytes);
-
-	if (color)
-		print_doc_size_color(format);
-	else
-		print_doc_size_no_color(format);
-}
-
-
-/* REMINDER:
- *
- * The main reason I chose to follow this method (using another functions)
- * for printing colored outputs is because to decrease the confusion that
- * may occur while seeing a printf() call with lots of macros.
+/*
+ * Search the entry name of the directory at dir_path, which is in the
+ * given depth of ctx->root, just like it was read from it: a document is
+ * passed to ctx->stream, which must be set, and a directory is searched
+ * with it's sub directories. An entry that's already gone is skipped.
  */
-static void print_doc_size_color(const struct meas_unit format) 
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "SIZE" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " %0.1f %s\n" ANSI_COLOR_RESET, 
-		   format.size_format, format.unit_name);
-}
-
-
-static void print_doc_size_no_color(const struct meas_unit format) 
-{
-	printf("[SIZE] %0.1f %s\n", format.size_format, format.unit_name);	
-} 
-
-
-static void print_doc_path(const char *doc_path, bool color)
+int search_dir_entry(struct search_ctx *ctx, const char *dir_path, 
+					 const char *name, int depth)
 {
-	if (color)
-		print_doc_path_color(doc_path);	
-	else
-		print_doc_path_no_color(doc_path);
-}
-
-
-static void print_doc_path_color(const char *doc_path)
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "PATH" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " %s\n" ANSI_COLOR_RESET, doc_path);
-}
-
-
-static void print_doc_path_no_color(const char *doc_path)
-{
-	printf("[PATH] %s\n", doc_path);
-}
-
-
-int print_doc_details(const struct doc_list *list, bool color) 
-{
-	char *time_buf;
-
-	if(!(time_buf = get_last_mod_time(list->stbuf->st_mtime)))
-		return -1;
-
-	print_doc_path(list->path, color);
-	print_doc_name(list->name, color);
-	print_last_mod_time(time_buf, color);
-	print_doc_modes(list->stbuf->st_mode, color);
-	print_doc_size(list->stbuf->st_size, color);
-	free(time_buf);
-
-	return 0;
-}
-
-
-static void print_last_mod_time(const char *buffer, bool color) 
-{
-	if (color)
-		print_last_mod_time_color(buffer);
-	else 
-		print_last_mod_time_no_color(buffer);
-}
-
-
-static char *get_last_mod_time(const time_t timep)
-{
-	/*
-	 * According to the Linux Man pages (man ctime(3), line 82) when using
-	 * using the function ctime_r(), the char buffer must have room for
-	 * at least 26 bytes. I decided I'll give it room for 35 bytes.
-	 */
-	const unsigned int size = 35;
-	char *buffer;
-
-	if ((buffer = malloc_inf(sizeof(char) * size)))
-		if (!ctime_r_inf(&timep, buffer))
-			free_and_null((void **) &buffer);
-
-	return buffer;
-}
-
-
-static void print_last_mod_time_color(const char *buffer) 
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "TIME" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " %s" ANSI_COLOR_RESET, 
-		   buffer);	
-}
-
-
-static void print_last_mod_time_no_color(const char *buffer) 
-{
-	printf("[TIME] %s", buffer);	
-}
-
-
-static void print_doc_modes(const mode_t mode, bool color) 
-{
-	if (color)
-		print_doc_modes_color(mode);
-	else
-		print_doc_modes_no_color(mode);
-}
-
-
-static void print_doc_name(const char *name, bool color)
-{
-	if (color)
-		print_doc_name_color(name);
-	else
-		print_doc_name_no_color(name);
-}
+	struct doc_list *doc_list_begin = NULL;
+	struct doc_list *current_node = NULL;
+	struct stat stbuf;
+	char *path;
+	int retval = 0;
 
+	if (dot_entry(name) || (ctx->root->skip_hidden && name[0] == '.'))
+		return 0;
 
-static void print_doc_name_color(const char *name)
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "NAME" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " %s\n" ANSI_COLOR_RESET, 
-		   name);	
-}
+	if (!(path = get_entry_path(dir_path, name)))
+		goto err_out;
 
+	STATS_COUNT(STATS_STATS, 1);
 
-static void print_doc_name_no_color(const char *name)
-{
-	printf("[NAME] %s\n", name);	
-}
+	if (stat(path, &stbuf)) {
+		free_inf(path);
+		return 0;
+	}
 
+	if (S_ISDIR(stbuf.st_mode)) {
+		if (can_descend(ctx, depth) && 
+			(!ctx->root->one_file_system || stbuf.st_dev == ctx->root_dev))
+			retval = search_for_doc_rec(path, depth + 1, ctx, 
+										&doc_list_begin, &current_node);
+		free_inf(path);
+	} else if (S_ISREG(stbuf.st_mode) && doc_name_matches(ctx, name) &&
+			   plan_matches_stat(&ctx->plan, &stbuf)) {
+		/* The stream takes the path unless it fails */
+		if (save_found_doc(ctx, path, name, NULL, &doc_list_begin, &current_node)) {
+			free_inf(path);
+			goto err_out;
+		}
+	} else {
+		free_inf(path);
+	}
 
-static void print_doc_modes_color(const mode_t mode) 
-{
-	printf(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "MODE" ANSI_COLOR_BLUE "]"
-		   ANSI_COLOR_RED " -%c%c%c%c%c%c%c%c%c\n" ANSI_COLOR_RESET, 
-		   ((mode & S_IRUSR) ? 'r' : '-'), 
-		   ((mode & S_IWUSR) ? 'w' : '-'),
-		   ((mode & S_IXUSR) ? 'x' : '-'),
-		   ((mode & S_IRGRP) ? 'r' : '-'),
-		   ((mode & S_IWGRP) ? 'w' : '-'),
-		   ((mode & S_IXGRP) ? 'x' : '-'), 
-		   ((mode & S_IROTH) ? 'r' : '-'), 
-		   ((mode & S_IWOTH) ? 'w' : '-'), 
-		   ((mode & S_IXOTH) ? 'x' : '-')
-		  );
-}
+	return retval;
 
+err_out:
+	prev_error = 1;
 
-static void print_doc_modes_no_color(const mode_t mode) 
-{
-	printf("[MODE] -%c%c%c%c%c%c%c%c%c\n", 
-		   ((mode & S_IRUSR) ? 'r' : '-'), 
-		   ((mode & S_IWUSR) ? 'w' : '-'),
-		   ((mode & S_IXUSR) ? 'x' : '-'),
-		   ((mode & S_IRGRP) ? 'r' : '-'),
-		   ((mode & S_IWGRP) ? 'w' : '-'),
-		   ((mode & S_IXGRP) ? 'x' : '-'), 
-		   ((mode & S_IROTH) ? 'r' : '-'), 
-		   ((mode & S_IWOTH) ? 'w' : '-'), 
-		   ((mode & S_IXOTH) ? 'x' : '-')
-		  );
+	return -1;
 }
 
 
-static int search_for_doc_rec(const char *dir_path, const char *str,
-							  bool ignore, bool rec,
+static int search_for_doc_rec(const char *dir_path, int depth, 
+							  struct search_ctx *ctx,
 							  struct doc_list **beginning,
 							  struct doc_list **current_node)
 {
 	if (!(*beginning)) {
-		if ((*beginning = search_for_doc(dir_path, str, ignore, rec)))
+		if ((*beginning = search_for_doc(dir_path, depth, ctx)))
 			*current_node = get_last_node(*beginning);
 	} else {
-		if (((*current_node)->next = search_for_doc(dir_path, str, ignore, rec)))
+		if (((*current_node)->next = search_for_doc(dir_path, depth, ctx)))
 			*current_node = get_last_node(*current_node);
 	}
 
@@ -1016,69 +1054,4 @@ static void catch_readdir_inf_err()
 {
 	if (errno)
 		prev_error = 1;
-}
-
-
-void display_help(const char *name) 
-{
-	printf("Usage: %s [OPTIONS]... ARGUMENT\n", name);
-	printf(
-	       "A command-line tool for managing your documents and easing your life.\n"
-	       
-		   "\n"
-		   
-		   "Available options:\n"
-	       " -h \t Display this help message\n"
-	       " -g \t Generate new configurations file\n"
-	       " -s \t Sort the founded documents alphabetically\n"
-	       " -r \t Reverse the order of the founded documents\n"
-	       " -a \t Include all documents\n"
-	       " -i \t Ignore case distinctions while searching for the documents\n"
-	       " -n \t Allow numerous documents opening (execution)\n"
-	       " -c \t Count the existing documents with the passed string sequence in their names\n"
-	       " -l \t List the existing documents with the passed string sequence in their names\n"
-	       " -d \t Display details on the documents with the passed string sequence in their names\n"
-		   " -o \t Open the founded document with the passed string sequence in it's name\n"
-	       " -R \t Disable recursive searching for the documents\n"
-	       " -C \t Disable colorful output\n"
-           
-		   "\n\n"
-	       
-		   "NOTES:\n"
-		   "  1. It's good to note that the program has multiple directories support when\n"
-           "     searching for a document. So when generating the configurations you can pass\n"
-		   "     more than one directory absolute path which the program will search for\n"
-		   "     documents in it at a run time. Please separate the paths with a space.\n"
-		   "     Example: /path/to/dir1 /path/to/dir2 /path/to/dir3...\n"
-
-           "\n"
-
-	       "  2. When generating the configurations, if it's desired to pass additional\n"
-		   "     arguments for the documents execution command, please separate them with\n"
-		   "     a space. Example: --arg1 --arg2 --arg3...\n"
-		   
-		   "\n"
-
-		   "  3. By default when using the -o option you can't open more than a document\n"
-		   "     in a run, but you can use the -n option with it to give the program the\n"
-		   "     approval to open more than one document in a run.\n"
-		   
-		   "\n"
-		   
-		   "  4. You can use the -a optoin with the -c, -l, -d and -o options instead\n"
-	       "     of passing an actual argument.\n" 
-
-		   "\n"
-
-		   "  5. The [TIME] section in the -d option stands for the last modification\n"
-		   "     time, or if the document haven't been modified once, it'll stand for\n"
-		   "     the creation time of the document.\n"
-
-		   "\n\n"
-
-		   "EXIT CODES:\n"
-		   " 0   Success\n"
-		   " 1   Error in the command line syntax\n"
-		   " 2   General error in the program\n"
-		  );
-}
+}
\ No newline at end of file
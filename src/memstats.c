@@ -0,0 +1,148 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for account-  |
+| ing the memory allocated by the *_inf() wrappers, for |
+| the --stats and the --mem-limit options.              |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include "informative.h"
+#include "memstats.h"
+
+
+bool memstats_on = 0;
+
+/*
+ * The live bytes are the usable sizes of the blocks, the allocator's
+ * rounding included, so they're what the allocations really hold.
+ * They're shared by all the threads, but only the main one allocates
+ * much, so the atomics are hardly ever contended.
+ */
+static atomic_llong live_bytes;
+static atomic_llong peak_bytes;
+static atomic_ullong sites_counts[MEM_SITES_NUM];
+static atomic_ullong sites_bytes[MEM_SITES_NUM];
+/* 0 for no limit */
+static size_t limit_bytes;
+
+static const char *const sites_names[MEM_SITES_NUM] = {
+	[MEM_SITE_NODE] = "node",
+	[MEM_SITE_PATH] = "path",
+	[MEM_SITE_NAME] = "name",
+	[MEM_SITE_STAT] = "stat",
+	[MEM_SITE_LINE] = "line",
+	[MEM_SITE_KEY] = "sort key",
+	[MEM_SITE_OTHER] = "other"
+};
+
+
+/* Static Functions Prototype */
+static void raise_peak(long long);
+static void print_mem_size(const char *, long long);
+
+
+
+/*
+ * Must be called before anything is allocated, or the blocks
+ * allocated before would be taken off the live bytes when freed.
+ */
+void memstats_enable(void)
+{
+	memstats_on = 1;
+}
+
+
+void memstats_set_limit(size_t limit)
+{
+	limit_bytes = limit;
+	memstats_enable();
+}
+
+
+size_t memstats_get_limit(void)
+{
+	return limit_bytes;
+}
+
+
+/*
+ * Return 1 if allocating size more bytes would exceed the limit,
+ * otherwise 0.
+ */
+bool memstats_exceeds(size_t size)
+{
+	const long long live = atomic_load_explicit(&live_bytes, memory_order_relaxed);
+
+	return limit_bytes && (live < 0 || (size_t) live + size > limit_bytes);
+}
+
+
+static void raise_peak(long long live)
+{
+	long long peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+
+	while (live > peak && !atomic_compare_exchange_weak_explicit(&peak_bytes,
+			&peak, live, memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+
+/*
+ * Count an allocation of size bytes at site, that changed
+ * the live bytes by delta, e.g. a shrinking realloc().
+ */
+void memstats_alloced(enum mem_site site, size_t size, long long delta)
+{
+	atomic_fetch_add_explicit(&sites_counts[site], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sites_bytes[site], size, memory_order_relaxed);
+
+	raise_peak(atomic_fetch_add_explicit(&live_bytes, delta,
+				memory_order_relaxed) + delta);
+}
+
+
+void memstats_freed(size_t size)
+{
+	atomic_fetch_sub_explicit(&live_bytes, size, memory_order_relaxed);
+}
+
+
+static void print_mem_size(const char *name, long long bytes)
+{
+	fprintf(stderr, "  %-19s %.1f KiB\n", name, bytes / 1024.0);
+}
+
+
+/*
+ * Print the allocations by site, the live and peak bytes and the
+ * peak resident set size on stderr, after the --stats counters.
+ */
+void memstats_print(void)
+{
+	struct rusage usage;
+	unsigned int i;
+
+	if (!memstats_on)
+		return;
+
+	fprintf(stderr, "  %-10s %12s %12s\n", "site", "allocations", "bytes");
+
+	for (i=0; i<MEM_SITES_NUM; i++)
+		fprintf(stderr, "  %-10s %12llu %12llu\n", sites_names[i],
+				(unsigned long long) sites_counts[i],
+				(unsigned long long) sites_bytes[i]);
+
+	print_mem_size("live memory", live_bytes);
+	print_mem_size("peak memory", peak_bytes);
+	if (limit_bytes)
+		print_mem_size("memory limit", limit_bytes);
+
+	/* ru_maxrss is in KiB on Linux */
+	if (!getrusage(RUSAGE_SELF, &usage))
+		print_mem_size("peak RSS", usage.ru_maxrss * 1024LL);
+}
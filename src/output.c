@@ -0,0 +1,132 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for writing   |
+| the program's output through a big buffer of it's own |
+| instead of a printf() call for every field.           |
+---------------------------------------------------------
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include "informative.h"
+#include "output.h"
+
+#define OUTPUT_BUF_SIZE (64 * 1024)
+
+
+static char out_buf[OUTPUT_BUF_SIZE];
+static size_t out_len = 0;
+/* To report only the first write error and return it from out_flush() */
+static bool out_error = 0;
+
+
+/* Static Functions Prototype */
+static void write_iov(struct iovec *, int);
+
+
+
+/*
+ * Write all the iov buffers to stdout, dealing with partial writes.
+ */
+static void write_iov(struct iovec *iov, int iovcnt)
+{
+	ssize_t written;
+
+	while (iovcnt && !out_error) {
+		if ((written = writev_inf(STDOUT_FILENO, iov, iovcnt)) == -1) {
+			out_error = 1;
+			break;
+		}
+		for (; iovcnt && (size_t) written >= iov->iov_len; iov++, iovcnt--)
+			written -= iov->iov_len;
+
+		if (iovcnt) {
+			iov->iov_base = (char *) iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+
+void out_write(const char *str, size_t len)
+{
+	struct iovec iov[2];
+
+	if (len <= OUTPUT_BUF_SIZE - out_len) {
+		memcpy(&out_buf[out_len], str, len);
+		out_len += len;
+		return;
+	}
+	/* Write the buffer and str together in one call */
+	iov[0].iov_base = out_buf;
+	iov[0].iov_len = out_len;
+	iov[1].iov_base = (char *) str;
+	iov[1].iov_len = len;
+
+	write_iov(iov, 2);
+	out_len = 0;
+}
+
+
+void out_str(const char *str)
+{
+	out_write(str, strlen(str));
+}
+
+
+void out_char(char c)
+{
+	if (out_len == OUTPUT_BUF_SIZE)
+		out_flush();
+
+	out_buf[out_len++] = c;
+}
+
+
+void out_uint(unsigned long num)
+{
+	char digits[20];
+	unsigned int i = sizeof(digits);
+
+	do {
+		digits[--i] = '0' + num % 10;
+		num /= 10;
+	} while (num);
+
+	out_write(&digits[i], sizeof(digits) - i);
+}
+
+
+void out_int(long num)
+{
+	if (num < 0) {
+		out_char('-');
+		/* Negating in unsigned arithmetic works for LONG_MIN too */
+		out_uint(-(unsigned long) num);
+	} else {
+		out_uint(num);
+	}
+}
+
+
+/*
+ * Write the buffered output. Return -1 if it or any previous
+ * output couldn't be written, otherwise 0.
+ */
+int out_flush(void)
+{
+	struct iovec iov;
+
+	if (out_len) {
+		iov.iov_base = out_buf;
+		iov.iov_len = out_len;
+
+		write_iov(&iov, 1);
+		out_len = 0;
+	}
+
+	return out_error ? -1 : 0;
+}
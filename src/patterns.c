@@ -0,0 +1,303 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions of the multi- |
+| pattern matcher, an Aho-Corasick automaton that finds |
+| every pattern in a name with a single pass over it.   |
+---------------------------------------------------------
+*/
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "informative.h"
+#include "patterns.h"
+
+/* The end of the patterns ending at a state, and of the output links */
+#define NO_PATTERN UINT32_MAX
+#define NO_STATE UINT32_MAX
+
+
+/*
+ * The automaton of the patterns, with a transition for every state and
+ * byte class, so each byte of a name takes a single lookup. The root is
+ * the state 0.
+ */
+struct pattern_set {
+	/*
+	 * Every byte of the patterns has a class of it's own and the rest
+	 * share the class 0, so a state needs only a transition per class.
+	 */
+	unsigned char classes[UCHAR_MAX + 1];
+	unsigned int classes_num;
+	/* classes_num transitions per state */
+	uint32_t *delta;
+	uint32_t states_num;
+	/* The first of the patterns ending at a state, or NO_PATTERN */
+	uint32_t *first_out;
+	/* The nearest state the state's suffixes end at with patterns ending at it */
+	uint32_t *out_link;
+	/* The next of the patterns ending at the same state, by the patterns' indexes */
+	uint32_t *next_out;
+	unsigned int patterns_num;
+};
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static unsigned char fold_byte(unsigned char, bool);
+static void set_byte_classes(struct pattern_set *, const char *const *, unsigned int, bool);
+static int alloc_states(struct pattern_set *, size_t);
+static void add_pattern(struct pattern_set *, const char *, unsigned int);
+static int link_states(struct pattern_set *);
+
+
+
+static unsigned char fold_byte(unsigned char c, bool ignore_case)
+{
+	return ignore_case ?
+		tolower(c) : c;
+}
+
+
+/*
+ * Give every byte of the patterns a class, the same for a capital letter
+ * and it's small one if the case is ignored.
+ */
+static void set_byte_classes(struct pattern_set *set, const char *const *strs,
+							 unsigned int num, bool ignore_case)
+{
+	const unsigned char *ptr;
+	unsigned int c;
+	unsigned int i;
+
+	set->classes_num = 1;
+
+	for (i=0; i<num; i++)
+		for (ptr=(const unsigned char *) strs[i]; *ptr; ptr++)
+			if (!set->classes[fold_byte(*ptr, ignore_case)])
+				set->classes[fold_byte(*ptr, ignore_case)] = set->classes_num++;
+
+	if (ignore_case)
+		for (c=0; c<=UCHAR_MAX; c++)
+			set->classes[c] = set->classes[tolower(c)];
+}
+
+
+static int alloc_states(struct pattern_set *set, size_t states_max)
+{
+	if (!(set->delta = calloc_inf(states_max, set->classes_num * sizeof(uint32_t))) ||
+		!(set->first_out = reallocarray_inf(NULL, states_max, sizeof(uint32_t))) ||
+		!(set->out_link = reallocarray_inf(NULL, states_max, sizeof(uint32_t))) ||
+		!(set->next_out = reallocarray_inf(NULL, set->patterns_num ? set->patterns_num : 1,
+										   sizeof(uint32_t))))
+		return -1;
+
+	/* All ones, just like NO_PATTERN and NO_STATE */
+	memset(set->first_out, 0xff, states_max * sizeof(uint32_t));
+	memset(set->out_link, 0xff, states_max * sizeof(uint32_t));
+
+	return 0;
+}
+
+
+/*
+ * Add the pattern to the trie of the states, whose missing transitions
+ * are still 0 since none goes back to the root yet.
+ */
+static void add_pattern(struct pattern_set *set, const char *str, unsigned int i)
+{
+	const unsigned int classes_num = set->classes_num;
+	const unsigned char *ptr;
+	uint32_t *next;
+	uint32_t state = 0;
+
+	for (ptr=(const unsigned char *) str; *ptr; ptr++) {
+		next = &set->delta[(size_t) state * classes_num + set->classes[*ptr]];
+		if (!*next)
+			*next = set->states_num++;
+		state = *next;
+	}
+	set->next_out[i] = set->first_out[state];
+	set->first_out[state] = i;
+}
+
+
+/*
+ * Turn the trie into the automaton, breadth first so a state's longest
+ * suffix in the trie is done before it: every missing transition is the
+ * suffix's one, and the output link is the suffix or it's output link.
+ */
+static int link_states(struct pattern_set *set)
+{
+	const unsigned int classes_num = set->classes_num;
+	uint32_t *queue;
+	uint32_t *fail;
+	uint32_t *delta;
+	uint32_t state;
+	uint32_t next;
+	size_t head = 0;
+	size_t tail = 0;
+	unsigned int c;
+
+	if (!(queue = reallocarray_inf(NULL, set->states_num, sizeof(uint32_t))))
+		return -1;
+
+	if (!(fail = reallocarray_inf(NULL, set->states_num, sizeof(uint32_t)))) {
+		free_inf(queue);
+		return -1;
+	}
+
+	/* The missing transitions of the root go back to it, they're already 0 */
+	for (c=0; c<classes_num; c++)
+		if ((next = set->delta[c])) {
+			fail[next] = 0;
+			set->out_link[next] = (set->first_out[0] != NO_PATTERN) ? 0 : NO_STATE;
+			queue[tail++] = next;
+		}
+
+	while (head < tail) {
+		state = queue[head++];
+		delta = &set->delta[(size_t) state * classes_num];
+
+		for (c=0; c<classes_num; c++) {
+			if (!(next = delta[c])) {
+				delta[c] = set->delta[(size_t) fail[state] * classes_num + c];
+				continue;
+			}
+			fail[next] = set->delta[(size_t) fail[state] * classes_num + c];
+			set->out_link[next] = (set->first_out[fail[next]] != NO_PATTERN) ?
+				fail[next] : set->out_link[fail[next]];
+			queue[tail++] = next;
+		}
+	}
+	free_inf(queue);
+	free_inf(fail);
+
+	return 0;
+}
+
+
+/*
+ * Build the matcher of the num strs, which must outlive it. If
+ * ignore_case is 1 they match the names whatever their case.
+ */
+struct pattern_set *build_pattern_set(const char *const *strs, unsigned int num,
+									  bool ignore_case)
+{
+	struct pattern_set *set;
+	size_t states_max = 1;
+	uint32_t *delta;
+	unsigned int i;
+
+	for (i=0; i<num; i++)
+		states_max += strlen(strs[i]);
+
+	if (states_max >= NO_STATE) {
+		error_inf("can't match the patterns: Their total length is too big");
+		return NULL;
+	}
+
+	if (!(set = calloc_inf(1, sizeof(struct pattern_set))))
+		return NULL;
+
+	set->patterns_num = num;
+	set->states_num = 1;
+	set_byte_classes(set, strs, num, ignore_case);
+
+	if (alloc_states(set, states_max))
+		goto err_free_set;
+
+	for (i=0; i<num; i++)
+		add_pattern(set, strs[i], i);
+
+	if (link_states(set))
+		goto err_free_set;
+
+	/* The patterns share their prefixes, so there may be less states than their bytes */
+	if ((delta = reallocarray_inf(set->delta, set->states_num,
+								  set->classes_num * sizeof(uint32_t))))
+		set->delta = delta;
+
+	return set;
+
+err_free_set:
+	free_pattern_set(set);
+
+	return NULL;
+}
+
+
+void free_pattern_set(struct pattern_set *set)
+{
+	if (set) {
+		free_inf(set->delta);
+		free_inf(set->first_out);
+		free_inf(set->out_link);
+		free_inf(set->next_out);
+		free_inf(set);
+	}
+}
+
+
+/*
+ * Return 1 if any of the patterns is in the name, otherwise 0.
+ */
+bool match_any_pattern(const struct pattern_set *set, const char *name)
+{
+	const unsigned char *ptr = (const unsigned char *) name;
+	uint32_t state = 0;
+
+	/* An empty pattern is in every name */
+	if (set->first_out[0] != NO_PATTERN)
+		return 1;
+
+	for (; *ptr; ptr++) {
+		state = set->delta[(size_t) state * set->classes_num + set->classes[*ptr]];
+
+		if (set->first_out[state] != NO_PATTERN || set->out_link[state] != NO_STATE)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Save the indexes of the patterns in the name to ids, once each, and
+ * return their number. matched has a flag for each pattern, which must
+ * be 0 and is left so.
+ */
+unsigned int match_patterns(const struct pattern_set *set, const char *name,
+							unsigned int *ids, bool *matched)
+{
+	const unsigned char *ptr = (const unsigned char *) name;
+	unsigned int num = 0;
+	uint32_t state = 0;
+	uint32_t out;
+	uint32_t i;
+
+	for (;;) {
+		/* The patterns ending at the state, then at it's suffixes */
+		for (out=state; out != NO_STATE; out=set->out_link[out])
+			for (i=set->first_out[out]; i != NO_PATTERN; i=set->next_out[i])
+				if (!matched[i]) {
+					matched[i] = 1;
+					ids[num++] = i;
+				}
+
+		if (!*ptr)
+			break;
+
+		state = set->delta[(size_t) state * set->classes_num + set->classes[*ptr++]];
+	}
+
+	for (i=0; i<num; i++)
+		matched[ids[i]] = 0;
+
+	return num;
+}
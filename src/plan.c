@@ -0,0 +1,350 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions of the query  |
+| filters and of the search plan, which checks them the |
+| cheapest first and stats the entries only if needed.  |
+---------------------------------------------------------
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "informative.h"
+#include "config.h"
+#include "plan.h"
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static bool has_filter_ext(const struct query_filter *, const char *);
+static bool check_pred(const struct search_plan *, enum plan_pred, const struct stat *);
+
+
+
+/*
+ * Split the comma separated extensions, e.g. "pdf,djvu", into the
+ * filter, their dots are optional. Return 1 if there's none, -1 on
+ * failure and 0 on success, replacing the filter's extensions.
+ */
+int set_filter_exts(struct query_filter *filter, const char *str)
+{
+	unsigned int exts_num = 1;
+	const char *c;
+	char **exts;
+	char *value;
+	char *buf;
+	char *ext;
+
+	for (c=str; *c; c++)
+		if (*c == ',')
+			exts_num++;
+
+	if (!(buf = malloc_inf(sizeof(char) * (strlen(str) + 1))))
+		return -1;
+	strcpy(buf, str);
+
+	if (!(exts = malloc_inf(sizeof(char *) * exts_num))) {
+		free_inf(buf);
+		return -1;
+	}
+
+	for (exts_num=0, value=buf; (ext = strsep(&value, ",")); )
+		if (*(ext += (*ext == '.')) != '\0')
+			exts[exts_num++] = ext;
+
+	if (!exts_num) {
+		free_inf(exts);
+		free_inf(buf);
+		return 1;
+	}
+	free_query_filter(filter);
+	filter->exts = exts;
+	filter->exts_num = exts_num;
+	filter->exts_buf = buf;
+
+	return 0;
+}
+
+
+/*
+ * Parse a number of bytes with an optional K, M or G suffix for KiB,
+ * MiB or GiB, e.g. "5M".
+ */
+int parse_filter_size(const char *str, uint64_t *size)
+{
+	unsigned long long val;
+	unsigned int shift;
+	char *end;
+
+	if (*str < '0' || *str > '9')
+		return -1;
+
+	errno = 0;
+	val = strtoull(str, &end, 10);
+
+	switch (*end) {
+	case 'K':
+		shift = 10;
+		end++;
+		break;
+	case 'M':
+		shift = 20;
+		end++;
+		break;
+	case 'G':
+		shift = 30;
+		end++;
+		break;
+	default:
+		shift = 0;
+	}
+
+	if (errno || *end != '\0' || val > (UINT64_MAX >> shift))
+		return -1;
+
+	*size = (uint64_t) val << shift;
+
+	return 0;
+}
+
+
+/*
+ * Parse an age in seconds with an optional s, m, h, d or w suffix, the
+ * days being the default, e.g. "30d" or "12h".
+ */
+int parse_filter_age(const char *str, int64_t *age)
+{
+	unsigned long long val;
+	int64_t unit;
+	char *end;
+
+	if (*str < '0' || *str > '9')
+		return -1;
+
+	errno = 0;
+	val = strtoull(str, &end, 10);
+
+	switch (*end) {
+	case 's':
+		unit = 1;
+		break;
+	case 'm':
+		unit = 60;
+		break;
+	case 'h':
+		unit = 60 * 60;
+		break;
+	case '\0':
+	case 'd':
+		unit = 24 * 60 * 60;
+		break;
+	case 'w':
+		unit = 7 * 24 * 60 * 60;
+		break;
+	default:
+		return -1;
+	}
+
+	if (errno || (*end && end[1] != '\0') || val > (unsigned long long) (INT32_MAX / unit))
+		return -1;
+
+	*age = val * unit;
+
+	return 0;
+}
+
+
+/*
+ * Parse the octal permission bits, e.g. "644".
+ */
+int parse_filter_perm(const char *str, mode_t *perm)
+{
+	unsigned long val;
+	char *end;
+
+	if (*str < '0' || *str > '7')
+		return -1;
+
+	errno = 0;
+	val = strtoul(str, &end, 8);
+
+	if (errno || *end != '\0' || val > 07777)
+		return -1;
+
+	*perm = val;
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the filter has a predicate the documents' metadata is
+ * needed for, otherwise 0.
+ */
+bool filter_needs_stat(const struct query_filter *filter)
+{
+	return filter->flags;
+}
+
+
+bool query_filters_equal(const struct query_filter *a, const struct query_filter *b)
+{
+	unsigned int i;
+
+	if (a->flags != b->flags || !a->exts != !b->exts || a->exts_num != b->exts_num ||
+		((a->flags & FILTER_LARGER) && a->larger != b->larger) ||
+		((a->flags & FILTER_SMALLER) && a->smaller != b->smaller) ||
+		((a->flags & FILTER_NEWER) && a->newer != b->newer) ||
+		((a->flags & FILTER_OLDER) && a->older != b->older) ||
+		((a->flags & FILTER_PERM) && a->perm != b->perm))
+		return 0;
+
+	for (i=0; a->exts && i<a->exts_num; i++)
+		if (strcasecmp(a->exts[i], b->exts[i]))
+			return 0;
+
+	return 1;
+}
+
+
+void free_query_filter(struct query_filter *filter)
+{
+	free_inf(filter->exts);
+	free_inf(filter->exts_buf);
+	filter->exts = NULL;
+	filter->exts_buf = NULL;
+	filter->exts_num = 0;
+}
+
+
+/*
+ * Plan the search by the filter, which must outlive the plan. The ages
+ * are relative to now.
+ */
+void plan_search(struct search_plan *plan, const struct query_filter *filter)
+{
+	const time_t now = time(NULL);
+	const struct {
+		unsigned int flag;
+		enum plan_pred pred;
+	} order[] = {
+		/* A bits test, then the compares, all after the same stat() */
+		{FILTER_PERM, PRED_PERM},
+		{FILTER_LARGER, PRED_LARGER},
+		{FILTER_SMALLER, PRED_SMALLER},
+		{FILTER_NEWER, PRED_NEWER},
+		{FILTER_OLDER, PRED_OLDER}
+	};
+	unsigned int i;
+
+	memset(plan, 0, sizeof(struct search_plan));
+	plan->filter = filter;
+
+	for (i=0; i<sizeof(order) / sizeof(order[0]); i++)
+		if (filter->flags & order[i].flag)
+			plan->preds[plan->preds_num++] = order[i].pred;
+
+	plan->newer_than = now - filter->newer;
+	plan->older_than = now - filter->older;
+
+	/* The ranges with no size or mtime in them */
+	if ((filter->flags & FILTER_LARGER) && (filter->flags & FILTER_SMALLER) &&
+		filter->smaller <= filter->larger + 1)
+		plan->empty = 1;
+
+	if ((filter->flags & FILTER_NEWER) && (filter->flags & FILTER_OLDER) &&
+		filter->newer <= filter->older)
+		plan->empty = 1;
+}
+
+
+/*
+ * Return 1 if none of the root's documents can pass the plan, so it's
+ * not searched at all, otherwise 0.
+ */
+bool plan_rules_out_root(const struct search_plan *plan, const struct docs_root *root)
+{
+	unsigned int i;
+
+	if (plan->empty)
+		return 1;
+
+	/* Only the extensions in both lists can be found */
+	for (i=0; root->exts && plan->filter->exts && i<root->exts_num; i++)
+		if (has_filter_ext(plan->filter, root->exts[i]))
+			return 0;
+
+	return root->exts && plan->filter->exts;
+}
+
+
+static bool has_filter_ext(const struct query_filter *filter, const char *ext)
+{
+	unsigned int i;
+
+	for (i=0; i<filter->exts_num; i++)
+		if (strcasecmp(ext, filter->exts[i]) == 0)
+			return 1;
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the plan has no extensions or the name has one of them,
+ * otherwise 0.
+ */
+bool plan_matches_ext(const struct search_plan *plan, const char *name)
+{
+	const char *dot;
+
+	if (!plan->filter->exts)
+		return 1;
+
+	if (!(dot = strrchr(name, '.')) || dot == name)
+		return 0;
+
+	return has_filter_ext(plan->filter, dot + 1);
+}
+
+
+static bool check_pred(const struct search_plan *plan, enum plan_pred pred,
+					   const struct stat *stbuf)
+{
+	const struct query_filter *filter = plan->filter;
+
+	switch (pred) {
+	case PRED_PERM:
+		return (stbuf->st_mode & filter->perm) == filter->perm;
+	case PRED_LARGER:
+		return (uint64_t) stbuf->st_size > filter->larger;
+	case PRED_SMALLER:
+		return (uint64_t) stbuf->st_size < filter->smaller;
+	case PRED_NEWER:
+		return stbuf->st_mtime >= plan->newer_than;
+	case PRED_OLDER:
+		return stbuf->st_mtime < plan->older_than;
+	default:
+		return 1;
+	}
+}
+
+
+/*
+ * Return 1 if the document's metadata passes all the plan's predicates,
+ * otherwise 0.
+ */
+bool plan_matches_stat(const struct search_plan *plan, const struct stat *stbuf)
+{
+	unsigned int i;
+
+	for (i=0; i<plan->preds_num; i++)
+		if (!check_pred(plan, plan->preds[i], stbuf))
+			return 0;
+
+	return 1;
+}
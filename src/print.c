@@ -0,0 +1,712 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for printing  |
+| the documents, their details and the help message in  |
+| the decorated format of the mdoc program.             |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include "libmdoc.h"
+#include "output.h"
+#include "timefmt.h"
+#include "fields.h"
+#include "print.h"
+
+#define ANSI_COLOR_RED    "\x1b[31m"
+#define ANSI_COLOR_BLUE   "\x1b[34m"
+#define ANSI_COLOR_GREEN  "\x1b[32m"
+#define ANSI_COLOR_RESET  "\x1b[0m"
+
+/* The length of the permissions string, e.g. "-rw-r--r--" */
+#define MODES_STR_LEN 10
+
+
+/* 
+ * A struct for printing the properiet size format 
+ * and unit name for the document size.
+ */
+struct meas_unit {
+	float size_format;
+	const char *unit_name;
+};
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static void display_doc_name_colorful(const char *);
+static void display_doc_name_no_color(const char *);
+static void print_docs_num_color(const unsigned int, const char *);
+static void print_docs_num_no_color(const unsigned int, const char *);
+static void print_pattern_color(const char *);
+static void print_pattern_no_color(const char *);
+static void print_dupes_set_color(const unsigned int);
+static void print_dupes_set_no_color(const unsigned int);
+static void print_opening_doc_color(const char *);
+static void print_opening_doc_no_color(const char *);
+static void print_doc_size(off_t, bool);
+static struct meas_unit get_proper_size_format(off_t);
+static float bytes_to_gb(off_t); 
+static float bytes_to_mb(off_t);
+static float bytes_to_kb(off_t);
+static struct meas_unit ret_proper_size_format(float, const char *); 
+static void print_doc_size_color(const struct meas_unit);
+static void print_doc_size_no_color(const struct meas_unit);
+static void print_doc_path(const char *, bool);
+static void print_doc_path_no_color(const char *);
+static void print_doc_path_color(const char *);
+static void print_last_mod_time(const char *, size_t, bool);
+static void print_last_mod_time_color(const char *, size_t); 
+static void print_last_mod_time_no_color(const char *, size_t);
+static void print_doc_modes(const mode_t, bool);
+static void print_doc_modes_color(const mode_t); 
+static void print_doc_modes_no_color(const mode_t); 
+static void get_modes_str(char *, const mode_t);
+static void print_doc_name(const char *, bool);
+static void print_doc_name_color(const char *);
+static void print_doc_name_no_color(const char *);
+
+
+
+void display_doc_name(const char *name, bool color_status) 
+{
+		if (color_status)
+			display_doc_name_colorful(name);
+		else
+			display_doc_name_no_color(name);
+
+}
+
+
+static void display_doc_name_colorful(const char *name) 
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "+" ANSI_COLOR_BLUE "]" 
+				ANSI_COLOR_RED " ");
+	out_str(name);
+	OUT_LITERAL(ANSI_COLOR_RESET "\n");
+}
+
+
+static void display_doc_name_no_color(const char *name) 
+{
+	OUT_LITERAL("[+] ");
+	out_str(name);
+	out_char('\n');
+}
+
+
+void print_opening_doc(const char *doc_name, bool color) 
+{
+	if (color)
+		print_opening_doc_color(doc_name);
+	else 
+		print_opening_doc_no_color(doc_name);
+}
+
+
+/*
+ * The main reason I chose to follow this method (using another functions)
+ * for printing colored outputs is to decrease the confusion that
+ * may occur while seeing an output call with lots of macros.
+ */
+static void print_opening_doc_color(const char *doc_name)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "OPENING" ANSI_COLOR_BLUE "]" 
+				ANSI_COLOR_RED " ");
+	out_str(doc_name);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_opening_doc_no_color(const char *doc_name)
+{
+	OUT_LITERAL("[OPENING] ");
+	out_str(doc_name);
+	out_char('\n');
+}
+
+
+void print_docs_num(const unsigned int docs_num, bool color) 
+{
+	const char *file = (docs_num == 1) ? 
+        "File" : "Files";
+
+	if (color)
+		print_docs_num_color(docs_num, file);
+	else
+		print_docs_num_no_color(docs_num, file);
+}
+
+
+static void print_docs_num_color(const unsigned int num, 
+		                         const char *file_word)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "COUNTED" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_uint(num);
+	out_char(' ');
+	out_str(file_word);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_docs_num_no_color(const unsigned int num, 
+		                            const char *file_word) 
+{
+	OUT_LITERAL("[COUNTED] ");
+	out_uint(num);
+	out_char(' ');
+	out_str(file_word);
+	out_char('\n');
+}
+
+
+/*
+ * Print the batched pattern the documents after it were found by.
+ */
+void print_pattern(const char *pattern, bool color)
+{
+	if (color)
+		print_pattern_color(pattern);
+	else
+		print_pattern_no_color(pattern);
+}
+
+
+static void print_pattern_color(const char *pattern)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "PATTERN" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_str(pattern);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_pattern_no_color(const char *pattern)
+{
+	OUT_LITERAL("[PATTERN] ");
+	out_str(pattern);
+	out_char('\n');
+}
+
+
+/*
+ * Print the number of the documents of a --dupes set, before them.
+ */
+void print_dupes_set(const unsigned int docs_num, bool color)
+{
+	if (color)
+		print_dupes_set_color(docs_num);
+	else
+		print_dupes_set_no_color(docs_num);
+}
+
+
+static void print_dupes_set_color(const unsigned int docs_num)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "DUPLICATES" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_uint(docs_num);
+	OUT_LITERAL(" Files\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_dupes_set_no_color(const unsigned int docs_num)
+{
+	OUT_LITERAL("[DUPLICATES] ");
+	out_uint(docs_num);
+	OUT_LITERAL(" Files\n");
+}
+
+
+static struct meas_unit get_proper_size_format(off_t bytes) 
+{
+	const off_t gb = 1000000000;
+	const off_t mb = 1000000;
+	const off_t kb = 1000;
+
+	if (bytes >= gb) 
+		return ret_proper_size_format(bytes_to_gb(bytes), "GB");
+
+	else if (bytes >= mb)
+		return ret_proper_size_format(bytes_to_mb(bytes), "MB");
+
+	else if (bytes >= kb)
+		return ret_proper_size_format(bytes_to_kb(bytes), "KB");
+
+	else 
+		return ret_proper_size_format(bytes, "B");
+}
+
+
+static struct meas_unit ret_proper_size_format(float size_format, 
+	                                           const char *unit_name) 
+{
+	struct meas_unit retval;
+
+	retval.size_format = size_format;
+	retval.unit_name = unit_name;
+
+	return retval; 
+}
+
+
+static float bytes_to_gb(off_t bytes) 
+{
+	return (float) bytes / 1000000000.0; 
+}
+
+
+static float bytes_to_mb(off_t bytes) 
+{
+	return (float) bytes / 1000000.0;
+}
+
+
+static float bytes_to_kb(off_t bytes) 
+{ 
+	return (float) bytes / 1000.0;
+}
+
+
+static void print_doc_size(off_t bytes, bool color)  
+{
+	const struct meas_unit format = get_proper_size_format(bytes);
+
+	if (color)
+		print_doc_size_color(format);
+	else
+		print_doc_size_no_color(format);
+}
+
+
+/* REMINDER:
+ *
+ * The main reason I chose to follow this method (using another functions)
+ * for printing colored outputs is because to decrease the confusion that
+ * may occur while seeing an output call with lots of macros.
+ */
+static void print_doc_size_color(const struct meas_unit format) 
+{
+	char size_buf[32];
+	
+	snprintf(size_buf, sizeof(size_buf), "%0.1f ", format.size_format);
+	
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "SIZE" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_str(size_buf);
+	out_str(format.unit_name);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_doc_size_no_color(const struct meas_unit format) 
+{
+	char size_buf[32];
+	
+	snprintf(size_buf, sizeof(size_buf), "%0.1f ", format.size_format);
+	
+	OUT_LITERAL("[SIZE] ");
+	out_str(size_buf);
+	out_str(format.unit_name);
+	out_char('\n');
+} 
+
+
+static void print_doc_path(const char *doc_path, bool color)
+{
+	if (color)
+		print_doc_path_color(doc_path);	
+	else
+		print_doc_path_no_color(doc_path);
+}
+
+
+static void print_doc_path_color(const char *doc_path)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "PATH" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_str(doc_path);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_doc_path_no_color(const char *doc_path)
+{
+	OUT_LITERAL("[PATH] ");
+	out_str(doc_path);
+	out_char('\n');
+}
+
+
+/*
+ * The time cache is kept by the caller across the documents, so the
+ * ones modified in the same day share the broken-down time.
+ */
+int print_doc_details(struct mdoc_doc *doc, bool color, 
+					  struct time_cache *cache) 
+{
+	char time_buf[TIME_STR_MAX];
+	const struct stat *stbuf;
+	size_t time_len;
+
+	if (!(stbuf = mdoc_doc_stat(doc)))
+		return -1;
+
+	if (!(time_len = format_time(cache, stbuf->st_mtime, time_buf)))
+		return -1;
+
+	print_doc_path(mdoc_doc_path(doc), color);
+	print_doc_name(mdoc_doc_name(doc), color);
+	print_last_mod_time(time_buf, time_len, color);
+	print_doc_modes(stbuf->st_mode, color);
+	print_doc_size(stbuf->st_size, color);
+
+	return 0;
+}
+
+
+static void print_last_mod_time(const char *buffer, size_t len, bool color) 
+{
+	if (color)
+		print_last_mod_time_color(buffer, len);
+	else 
+		print_last_mod_time_no_color(buffer, len);
+}
+
+
+static void print_last_mod_time_color(const char *buffer, size_t len) 
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "TIME" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_write(buffer, len);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_last_mod_time_no_color(const char *buffer, size_t len) 
+{
+	OUT_LITERAL("[TIME] ");
+	out_write(buffer, len);
+	out_char('\n');
+}
+
+
+static void print_doc_modes(const mode_t mode, bool color) 
+{
+	if (color)
+		print_doc_modes_color(mode);
+	else
+		print_doc_modes_no_color(mode);
+}
+
+
+static void print_doc_name(const char *name, bool color)
+{
+	if (color)
+		print_doc_name_color(name);
+	else
+		print_doc_name_no_color(name);
+}
+
+
+static void print_doc_name_color(const char *name)
+{
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "NAME" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_str(name);
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_doc_name_no_color(const char *name)
+{
+	OUT_LITERAL("[NAME] ");
+	out_str(name);
+	out_char('\n');
+}
+
+
+static void print_doc_modes_color(const mode_t mode) 
+{
+	char modes[MODES_STR_LEN];
+
+	get_modes_str(modes, mode);
+
+	OUT_LITERAL(ANSI_COLOR_BLUE "[" ANSI_COLOR_GREEN "MODE" ANSI_COLOR_BLUE "]"
+				ANSI_COLOR_RED " ");
+	out_write(modes, sizeof(modes));
+	OUT_LITERAL("\n" ANSI_COLOR_RESET);
+}
+
+
+static void print_doc_modes_no_color(const mode_t mode) 
+{
+	char modes[MODES_STR_LEN];
+
+	get_modes_str(modes, mode);
+
+	OUT_LITERAL("[MODE] ");
+	out_write(modes, sizeof(modes));
+	out_char('\n');
+}
+
+
+/*
+ * Fill modes with the permissions string, e.g. "-rw-r--r--".
+ */
+static void get_modes_str(char *modes, const mode_t mode) 
+{
+	/* Indexed by the 3 permission bits of a class */
+	static const char perms[8][3] = {
+		{'-','-','-'}, {'-','-','x'}, {'-','w','-'}, {'-','w','x'},
+		{'r','-','-'}, {'r','-','x'}, {'r','w','-'}, {'r','w','x'}
+	};
+
+	modes[0] = '-';
+	memcpy(&modes[1], perms[(mode >> 6) & 07], 3);
+	memcpy(&modes[4], perms[(mode >> 3) & 07], 3);
+	memcpy(&modes[7], perms[mode & 07], 3);
+}
+
+
+void display_help(const char *name) 
+{
+	printf("Usage: %s [OPTIONS]... ARGUMENT...\n", name);
+	printf(
+	       "A command-line tool for managing your documents and easing your life.\n"
+	       
+		   "\n"
+		   
+		   "Available options:\n"
+	       " -h \t Display this help message\n"
+	       " -g \t Generate new configurations file\n"
+	       " -s \t Sort the founded documents alphabetically\n"
+	       " -r \t Reverse the order of the founded documents\n"
+	       " -v \t Sort the numbers in the names naturally, e.g. doc2 before doc10\n"
+	       " -a \t Include all documents\n"
+	       " -i \t Ignore case distinctions while searching for the documents\n"
+	       " -n \t Allow numerous documents opening (execution)\n"
+	       " -c \t Count the existing documents with the passed string sequence in their names\n"
+	       " -l \t List the existing documents with the passed string sequence in their names\n"
+	       " -d \t Display details on the documents with the passed string sequence in their names\n"
+		   " -o \t Open the founded document with the passed string sequence in it's name\n"
+	       " -R \t Disable recursive searching for the documents\n"
+	       " -C \t Disable colorful output\n"
+	       " -0 \t Print the documents paths (or fields) terminated with a null byte\n"
+	       " --sort=KEYS \t Sort the founded documents by the comma separated KEYS (name,\n"
+	       " \t\t path, size and mtime), a leading '-' reverses a key's order\n"
+	       " --limit=N \t Keep only the first N founded documents with the -l, -d and -o -n options\n"
+	       " --json \t Print the documents as JSON objects, one per line\n"
+	       " --fields=FIELDS Print only the comma separated FIELDS (path, name, size, mtime\n"
+	       " \t\t and mode) of the documents, separated with tabs unless --json is used\n"
+	       " --iso \t Display the [TIME] section of the -d option in ISO 8601 format\n"
+	       " --concurrent \t Start all the viewers of the -o -n options at once, then wait for them\n"
+	       " --detach \t Start the viewers of the -o option detached and exit without waiting\n"
+	       " --batch \t Open the documents of the -o -n options with one viewer execution each\n"
+	       " \t\t viewer, as many as the arguments limit allows\n"
+	       " --stats \t Print the wall and CPU time of every phase of the run and it's counters\n"
+	       " \t\t (directories opened, entries read, stats, allocations...) on stderr\n"
+	       " --trace=FILE \t Write a timeline of the directories scans, the sort and the viewers\n"
+	       " \t\t spawns to FILE in the Chrome Trace Event format, e.g. for Perfetto\n"
+	       " --mem-limit=SIZE Fail instead of allocating more than SIZE bytes (K, M or G\n"
+	       " \t\t suffixes for KiB, MiB or GiB), and print the -l and -d documents as found\n"
+	       " --interactive \t Scan the documents once, then answer the count, list, details and\n"
+	       " \t\t open commands read from stdin without scanning again\n"
+	       " --cache[=DIR] \t Keep the found documents of every query in DIR (default:\n"
+	       " \t\t ~/.cache/mdoc) and reuse them while it's directories are unchanged\n"
+	       " --watch \t Keep running after the -l and -d documents are printed, and print\n"
+	       " \t\t the matching documents added afterwards as soon as they appear\n"
+	       " --patterns=FILE Search for every line of FILE as well, or of stdin if it's -\n"
+	       " --dupes \t Print only the -l and -d documents with the same content as another\n"
+	       " \t\t one, grouped in sets, not with -c, -o, --interactive or --watch\n"
+	       " --ext=EXTS \t Find only the documents with one of the comma separated EXTS, e.g. pdf,djvu\n"
+	       " --larger=SIZE \t Find only the documents larger than SIZE (K, M or G suffixes)\n"
+	       " --smaller=SIZE Find only the documents smaller than SIZE\n"
+	       " --newer=AGE \t Find only the documents modified within AGE (s, m, h, d or w\n"
+	       " \t\t suffixes, days by default), e.g. 30d\n"
+	       " --older=AGE \t Find only the documents modified before AGE\n"
+	       " --perm=MODE \t Find only the documents with all the octal permission bits of MODE\n"
+           
+		   "\n\n"
+	       
+		   "NOTES:\n"
+		   "  1. It's good to note that the program has multiple directories support when\n"
+           "     searching for a document. So when generating the configurations you can pass\n"
+		   "     more than one directory absolute path which the program will search for\n"
+		   "     documents in it at a run time. Please separate the paths with a space.\n"
+		   "     Example: /path/to/dir1 /path/to/dir2 /path/to/dir3...\n"
+
+           "\n"
+
+	       "  2. When generating the configurations, if it's desired to pass additional\n"
+		   "     arguments for the documents execution command, please separate them with\n"
+		   "     a space. Example: --arg1 --arg2 --arg3...\n"
+		   
+		   "\n"
+
+		   "  3. By default when using the -o option you can't open more than a document\n"
+		   "     in a run, but you can use the -n option with it to give the program the\n"
+		   "     approval to open more than one document in a run.\n"
+		   
+		   "\n"
+		   
+		   "  4. You can use the -a optoin with the -c, -l, -d and -o options instead\n"
+	       "     of passing an actual argument.\n" 
+
+		   "\n"
+
+		   "  5. The [TIME] section in the -d option stands for the last modification\n"
+		   "     time, or if the document haven't been modified once, it'll stand for\n"
+		   "     the creation time of the document.\n"
+
+		   "\n"
+
+		   "  6. The -s option is the same as --sort=name. Multiple sort keys are compared\n"
+		   "     in the given order, e.g. --sort=size,-mtime,name sorts the documents by\n"
+		   "     size, the same sized ones from the newest to the oldest and then by name.\n"
+		   "     The -v option sorts the names (and paths) naturally by any of the keys, or\n"
+		   "     by the names if none were given.\n"
+
+		   "\n"
+
+		   "  7. With a sort key, --limit=N keeps the top N documents while searching, e.g.\n"
+		   "     --sort=-size --limit=50 for the 50 largest documents. Without one, the\n"
+		   "     search stops after finding N documents. The -r option reverses the order\n"
+		   "     of the kept documents.\n"
+
+		   "\n"
+
+		   "  8. The -0, --json and --fields options print machine readable records instead\n"
+		   "     of the decorated output: the -l records have the path field by default and\n"
+		   "     the -d ones have all the fields. The mtime field is in seconds since the\n"
+		   "     Epoch and the mode field is the permissions in octal. With -c only the\n"
+		   "     number of documents is printed.\n"
+
+		   "\n"
+
+		   "  9. By default the -o -n options start a viewer only after the previous one\n"
+		   "     exits. With --concurrent or --detach they're started at once, and a viewer\n"
+		   "     that couldn't be executed is still reported as an error.\n"
+
+		   "\n"
+
+		   "  10. The [viewers] section of the configurations file can map extensions to\n"
+		   "      viewers of their own, e.g. \"djvu, ps = zathura --fork\". In the older format\n"
+		   "      of 3 lines, the lines after them are in the form \"EXTS VIEWER [ARGS...]\",\n"
+		   "      e.g. \"djvu,ps zathura --fork\". The other documents are opened with the\n"
+		   "      main viewer. With --batch the documents are grouped by viewer.\n"
+
+		   "\n"
+
+		   "  11. With --mem-limit the unsorted and unreversed documents of the -l and -d\n"
+		   "      options are printed as they're found instead of being kept, so only the\n"
+		   "      search itself takes memory. With --stats the allocations are counted by\n"
+		   "      what they're for, next to the live and peak memory and the peak RSS.\n"
+
+		   "\n"
+
+		   "  12. The --interactive commands are a line each, e.g. \"list report\" or just\n"
+		   "      \"count\" for all the documents, and they're run with the other options,\n"
+		   "      e.g. -i or --sort. \"rescan\" scans the documents again, \"watch SECONDS\"\n"
+		   "      rescans before a command once the last scan is older and \"help\" lists\n"
+		   "      all the commands.\n"
+
+		   "\n"
+
+		   "  13. With --cache a query is answered with a stat() of every directory it\n"
+		   "      searched instead of reading them, as long as none of them has changed\n"
+		   "      since, e.g. by a file added, removed or renamed in it. A query's cache is\n"
+		   "      shared by the -c, -l, -d and -o options, whatever their sort and limit.\n"
+		   "      The directories changed less than a second before a search aren't cached.\n"
+
+		   "\n"
+
+		   "  14. With --watch the searched directories are watched with inotify, the new\n"
+		   "      subdirectories too, and a document is printed once it's created, moved\n"
+		   "      or linked in, and again only if it's removed and comes back. The\n"
+		   "      directories past the inotify watches limit are checked every 2 seconds\n"
+		   "      instead. The --limit and --cache options are ignored.\n"
+
+		   "\n"
+
+		   "  15. The -c, -l and -d options take several arguments, e.g. \"-c report draft\",\n"
+		   "      and --patterns=FILE adds a line each. They're all searched for in a single\n"
+		   "      scan, then each one's documents are printed after a [PATTERN] line, or\n"
+		   "      with a leading pattern field in the records. The other options take only\n"
+		   "      the first one.\n"
+
+		   "\n"
+
+		   "  16. With --dupes the found documents of the same size are compared by a hash\n"
+		   "      of their first and last 4 KiB, and only the ones still alike are hashed\n"
+		   "      whole. Each set is printed after a [DUPLICATES] line, or with a leading\n"
+		   "      set field in the records, and --limit is the number of the sets. The\n"
+		   "      hashes are kept in the --cache directory (default: ~/.cache/mdoc) and\n"
+		   "      only computed again for the files changed since. A file's hashes are\n"
+		   "      dropped once 16 runs that computed new ones didn't find it. The paths of\n"
+		   "      the same file, e.g. it's hard links, are a single document. A set rests\n"
+		   "      on equal 64-bit hashes, the documents aren't compared byte by byte.\n"
+
+		   "\n"
+
+		   "  17. The filters are checked the cheapest first: the entry's type, then the\n"
+		   "      extension and the name, and only the entries that pass them are stat'ed\n"
+		   "      for --larger, --smaller, --newer, --older and --perm. A root none of\n"
+		   "      whose documents can pass them, e.g. by it's extensions key, isn't read at\n"
+		   "      all. The queries with the metadata's filters aren't kept by --cache.\n"
+
+		   "\n\n"
+
+		   "EXIT CODES:\n"
+		   " 0   Success\n"
+		   " 1   Error in the command line syntax\n"
+		   " 2   General error in the program\n"
+		  );
+}
+
+
+/*
+ * Print a found document by the printer, passed as arg, either as a
+ * record, with it's details or just it's name.
+ */
+int print_doc(struct mdoc_doc *doc, void *arg)
+{
+	struct doc_printer *printer = arg;
+	int retval = 0;
+
+	if (printer->record) {
+		retval = print_doc_record(doc, printer->record, printer->group);
+	} else if (printer->details) {
+		/* For now the separator is a new line, before every document but the first */
+		if (printer->printed)
+			OUT_LITERAL("\n");
+		retval = print_doc_details(doc, printer->color, &printer->cache);
+	} else {
+		display_doc_name(mdoc_doc_name(doc), printer->color);
+	}
+	printer->printed = 1;
+
+	return retval;
+}
+
+
+/*
+ * Print the document whose viewer was executed, arg points to the
+ * color status.
+ */
+int print_opened_doc(struct mdoc_doc *doc, void *arg)
+{
+	const bool *color = arg;
+
+	print_opening_doc(mdoc_doc_name(doc), *color);
+	/* Don't keep it waiting for the next viewer to exit */
+	out_flush();
+
+	return 0;
+}
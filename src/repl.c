@@ -0,0 +1,450 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions of the inter- |
+| active mode, which scans the documents once and then  |
+| answers the commands read from stdin from an index of |
+| them, without scanning again.                         |
+---------------------------------------------------------
+*/
+
+#include <time.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libmdoc.h"
+#include "informative.h"
+#include "input.h"
+#include "output.h"
+#include "print.h"
+#include "fields.h"
+#include "repl.h"
+
+#define PROMPT "mdoc> "
+
+/* The whitespace around the commands and their arguments */
+#define BLANKS " \t\r"
+
+
+/* What the commands are run with */
+struct repl {
+	const struct repl_opts *opts;
+	struct doc_printer *printer;
+	struct mdoc_ctx *ctx;
+	struct mdoc_index *index;
+	/* When the index was scanned */
+	time_t scan_time;
+	/* If not 0, rescan before a query once the index is older */
+	unsigned int watch_secs;
+};
+
+enum repl_cmd {
+	CMD_COUNT,
+	CMD_LIST,
+	CMD_DETAILS,
+	CMD_OPEN,
+	CMD_RESCAN,
+	CMD_WATCH,
+	CMD_HELP,
+	CMD_QUIT,
+	CMDS_NUM
+};
+
+static const char *const cmds_names[CMDS_NUM] = {
+	[CMD_COUNT] = "count",
+	[CMD_LIST] = "list",
+	[CMD_DETAILS] = "details",
+	[CMD_OPEN] = "open",
+	[CMD_RESCAN] = "rescan",
+	[CMD_WATCH] = "watch",
+	[CMD_HELP] = "help",
+	[CMD_QUIT] = "quit"
+};
+
+
+/*--------------------------------*/
+/*   Static Functions Prototype   */
+/*--------------------------------*/
+static int rescan(struct repl *);
+static int rescan_if_stale(struct repl *);
+static struct mdoc_query *make_query(const struct repl *, const char *);
+static char *split_cmd(char *, char **);
+static int parse_cmd(const char *, enum repl_cmd *);
+static int count_cmd(struct repl *, const char *);
+static int print_cmd(struct repl *, const char *, bool);
+static int open_cmd(struct repl *, const char *);
+static int watch_cmd(struct repl *, const char *);
+static void help_cmd();
+static int run_cmd(struct repl *, enum repl_cmd, const char *);
+static void print_prompt(bool);
+static char *read_cmd_line(bool *);
+
+
+
+/*
+ * Read the configurations again and scan the documents into a new
+ * index, the old one is kept if it fails.
+ */
+static int rescan(struct repl *repl)
+{
+	struct mdoc_index *index;
+	struct mdoc_ctx *ctx;
+
+	if (mdoc_ctx_new(&ctx, NULL))
+		return -1;
+
+	if (repl->opts->cache && mdoc_ctx_set_cache(ctx, repl->opts->cache_dir)) {
+		mdoc_ctx_free(ctx);
+		return -1;
+	}
+
+	if (mdoc_index_new(&index, ctx, repl->opts->query_flags)) {
+		mdoc_ctx_free(ctx);
+		return -1;
+	}
+	mdoc_index_free(repl->index);
+	mdoc_ctx_free(repl->ctx);
+
+	repl->ctx = ctx;
+	repl->index = index;
+	repl->scan_time = time(NULL);
+
+	return 0;
+}
+
+
+static int rescan_if_stale(struct repl *repl)
+{
+	if (repl->watch_secs && time(NULL) - repl->scan_time >= repl->watch_secs)
+		return rescan(repl);
+
+	return 0;
+}
+
+
+/*
+ * Return a query for str, or for every document if it's NULL,
+ * by the command line's options.
+ */
+static struct mdoc_query *make_query(const struct repl *repl, const char *str)
+{
+	const struct repl_opts *opts = repl->opts;
+	struct mdoc_query *query;
+	unsigned int i;
+
+	if (mdoc_query_new(&query, str, opts->query_flags))
+		return NULL;
+
+	/* The keys and the filters were checked with the options */
+	if (opts->sort_keys)
+		mdoc_query_set_sort(query, opts->sort_keys);
+	mdoc_query_set_limit(query, opts->limit);
+
+	for (i=0; i<MDOC_FILTERS_NUM; i++)
+		if (opts->filters[i] && mdoc_query_set_filter(query, i, opts->filters[i])) {
+			mdoc_query_free(query);
+			return NULL;
+		}
+
+	return query;
+}
+
+
+/*
+ * Split the line to the command's name, which is returned, and it's
+ * argument, saved in arg or NULL if there's none.
+ */
+static char *split_cmd(char *line, char **arg)
+{
+	char *name = line + strspn(line, BLANKS);
+	char *end;
+
+	*arg = NULL;
+
+	end = name + strcspn(name, BLANKS);
+	if (*end) {
+		*end++ = '\0';
+		*arg = end + strspn(end, BLANKS);
+	}
+
+	/* The argument can have blanks inside it, like the names do */
+	if (*arg) {
+		for (end=*arg + strlen(*arg); end > *arg && strchr(BLANKS, end[-1]); end--)
+			;
+		*end = '\0';
+
+		if (**arg == '\0')
+			*arg = NULL;
+	}
+
+	return name;
+}
+
+
+static int parse_cmd(const char *name, enum repl_cmd *cmd)
+{
+	unsigned int i;
+
+	for (i=0; i<CMDS_NUM; i++)
+		if (strcmp(name, cmds_names[i]) == 0) {
+			*cmd = i;
+			return 0;
+		}
+
+	/* Just like the shells */
+	if (strcmp(name, "exit") == 0) {
+		*cmd = CMD_QUIT;
+		return 0;
+	}
+
+	return -1;
+}
+
+
+static int count_cmd(struct repl *repl, const char *str)
+{
+	const struct record_spec *record = repl->printer->record;
+	struct mdoc_query *query;
+	unsigned int docs_num;
+
+	if (!(query = make_query(repl, str)))
+		return -1;
+
+	mdoc_index_count(repl->index, query, &docs_num);
+	mdoc_query_free(query);
+
+	if (record)
+		print_docs_num_record(docs_num, record, NULL);
+	else
+		print_docs_num(docs_num, repl->printer->color);
+
+	return 0;
+}
+
+
+/*
+ * Print the documents just like the -l or -d options, the records
+ * have their options' default fields unless --fields was given.
+ */
+static int print_cmd(struct repl *repl, const char *str, bool details)
+{
+	struct doc_printer *printer = repl->printer;
+	const struct record_spec *const record = printer->record;
+	struct record_spec cmd_record;
+	struct mdoc_query *query;
+	int retval = -1;
+
+	if (record && !record->fields_num) {
+		cmd_record = *record;
+		parse_fields_spec(&cmd_record, details ? "path,name,mtime,mode,size" : "path");
+		printer->record = &cmd_record;
+	}
+	printer->details = details;
+	printer->printed = 0;
+
+	if ((query = make_query(repl, str))) {
+		if (!mdoc_index_search(repl->index, query, print_doc, printer))
+			retval = 0;
+		mdoc_query_free(query);
+	}
+	printer->record = record;
+
+	return retval;
+}
+
+
+/*
+ * Open the documents just like the -o option, only the found one
+ * unless -n was given.
+ */
+static int open_cmd(struct repl *repl, const char *str)
+{
+	const struct repl_opts *opts = repl->opts;
+	struct mdoc_results *results;
+	struct mdoc_query *query;
+	int retval = -1;
+
+	if (!(query = make_query(repl, str)))
+		return -1;
+
+	/* A single document is opened only if it's the only one found */
+	if (!opts->numerous)
+		mdoc_query_set_limit(query, 0);
+
+	if (!mdoc_index_search_results(repl->index, query, &results)) {
+		if (!opts->numerous && mdoc_results_num(results) > 1) {
+			fprintf(stderr, "%s: can't open file: Several files were found\n",
+					prog_name_inf);
+		} else {
+			/* So the viewer's output doesn't come before the printed one */
+			out_flush();
+			if (!mdoc_open_results(repl->ctx, results, opts->launch,
+								   opts->numerous && opts->batch,
+								   print_opened_doc, &repl->printer->color))
+				retval = 0;
+		}
+		mdoc_results_free(results);
+	}
+	mdoc_query_free(query);
+
+	return retval;
+}
+
+
+/*
+ * Rescan before the queries once the index is older than the
+ * argument's number of seconds, or stop it with 0.
+ */
+static int watch_cmd(struct repl *repl, const char *arg)
+{
+	unsigned long secs;
+	char *end;
+
+	if (!arg || *arg < '0' || *arg > '9' ||
+		(secs = strtoul(arg, &end, 10)) > UINT_MAX || *end != '\0') {
+		fprintf(stderr, "%s: the watch command needs a number of seconds\n",
+				prog_name_inf);
+		return -1;
+	}
+	repl->watch_secs = secs;
+
+	return 0;
+}
+
+
+static void help_cmd()
+{
+	OUT_LITERAL(
+		"count [STRING]    Count the documents with STRING in their names, or all of them\n"
+		"list [STRING]     List the documents with STRING in their names\n"
+		"details [STRING]  Display details on the documents with STRING in their names\n"
+		"open [STRING]     Open the document with STRING in it's name, or them all with -n\n"
+		"rescan            Read the configurations and scan the documents again\n"
+		"watch SECONDS     Rescan before a command once the scan is older, 0 to stop\n"
+		"help              Display this help message\n"
+		"quit              Exit, just like the end of the input\n"
+	);
+}
+
+
+static int run_cmd(struct repl *repl, enum repl_cmd cmd, const char *arg)
+{
+	/* Only the queries need the documents */
+	if (cmd <= CMD_OPEN && rescan_if_stale(repl))
+		return -1;
+
+	switch (cmd) {
+	case CMD_COUNT:
+		return count_cmd(repl, arg);
+	case CMD_LIST:
+		return print_cmd(repl, arg, 0);
+	case CMD_DETAILS:
+		return print_cmd(repl, arg, 1);
+	case CMD_OPEN:
+		return open_cmd(repl, arg);
+	case CMD_RESCAN:
+		return rescan(repl);
+	case CMD_WATCH:
+		return watch_cmd(repl, arg);
+	case CMD_HELP:
+		help_cmd();
+		return 0;
+	case CMD_QUIT:
+	case CMDS_NUM:
+		break;
+	}
+
+	return 0;
+}
+
+
+/*
+ * The prompt goes to stderr, so stdout has only the documents.
+ */
+static void print_prompt(bool tty)
+{
+	if (tty) {
+		fputs(PROMPT, stderr);
+		fflush(stderr);
+	}
+}
+
+
+/*
+ * Return the next line of the commands, or NULL at their end in which
+ * case eof is set. An empty line is returned as NULL too.
+ */
+static char *read_cmd_line(bool *eof)
+{
+	char *line;
+
+	if (!(line = get_line(stdin)))
+		*eof = feof(stdin) || ferror(stdin);
+
+	return line;
+}
+
+
+/*
+ * Scan the documents once, then run the commands read from stdin, a
+ * line each, until it's end or the quit command. A failed command is
+ * reported and the next one is run, but a failed first scan ends it.
+ */
+int run_repl(const struct repl_opts *opts, struct doc_printer *printer)
+{
+	const bool tty = isatty(STDIN_FILENO);
+	struct repl repl = {
+		.opts = opts,
+		.printer = printer,
+		.ctx = NULL,
+		.index = NULL,
+		.watch_secs = 0
+	};
+	enum repl_cmd cmd;
+	bool eof = 0;
+	int retval = 0;
+	char *line;
+	char *name;
+	char *arg;
+
+	if (rescan(&repl))
+		return -1;
+
+	while (!eof) {
+		/* The viewers of the last --detach open aren't left as zombies */
+		mdoc_reap_detached();
+		print_prompt(tty);
+
+		if (!(line = read_cmd_line(&eof)))
+			continue;
+
+		name = split_cmd(line, &arg);
+
+		if (*name == '\0') {
+			cmd = CMDS_NUM;
+		} else if (parse_cmd(name, &cmd)) {
+			fprintf(stderr, "%s: unknown command '%s', try 'help'\n", prog_name_inf, name);
+			cmd = CMDS_NUM;
+		}
+
+		if (cmd != CMDS_NUM && run_cmd(&repl, cmd, arg))
+			retval = -1;
+		free_inf(line);
+
+		/* Every command's output is written before the next one is read */
+		if (out_flush())
+			break;
+		if (cmd == CMD_QUIT)
+			break;
+	}
+	if (tty && eof)
+		fputc('\n', stderr);
+
+	mdoc_index_free(repl.index);
+	mdoc_ctx_free(repl.ctx);
+
+	return retval;
+}
@@ -0,0 +1,789 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for sorting   |
+| the documents lists by one or more keys.              |
+---------------------------------------------------------
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "strman.h"
+#include "informative.h"
+#include "sort.h"
+#include "stats.h"
+#include "trace.h"
+
+/* Below this number of documents a single thread sorts faster */
+#define PARALLEL_SORT_MIN 32768
+#define SORT_THREADS_MAX 16
+
+
+/*
+ * A document node paired with it's binary comparable sort key. All the
+ * needed fields are encoded once into the key, so comparing two entries
+ * is a memcmp() that never touches the scattered nodes.
+ */
+struct sort_entry {
+	const unsigned char *key;
+	size_t key_len;
+	struct doc_list *node;
+};
+
+/* A document kept by top_docs with the buffer of it's sort key */
+struct top_doc {
+	unsigned char *key;
+	size_t key_len;
+	size_t key_size;
+	/* The order the document was found in, to keep ties stable */
+	unsigned long seq;
+	struct doc_list *node;
+};
+
+/*
+ * The top documents by a sort spec, kept in a bounded max-heap so the
+ * worst of them is at the root and is the one replaced by a better one.
+ */
+struct top_docs {
+	const struct sort_spec *spec;
+	struct top_doc *heap;
+	unsigned int len;
+	unsigned int limit;
+	unsigned long seq;
+	/* The candidate document's key */
+	struct top_doc candidate;
+};
+
+/* A slice of the entries which is sorted by a thread of it's own */
+struct sort_chunk {
+	struct sort_entry *entries;
+	struct sort_entry *buf;
+	struct sort_entry *sorted;
+	size_t entries_num;
+	size_t merged;
+};
+
+
+/* Static Functions Prototype */
+static int parse_sort_key(struct sort_key *, const char *, size_t);
+static size_t get_str_key_len(const char *, bool);
+static size_t get_field_key_len(const struct doc_list *, enum sort_field, bool);
+static size_t get_doc_key_len(const struct doc_list *, const struct sort_spec *);
+static unsigned char *encode_doc_key(unsigned char *, const struct doc_list *, const struct sort_spec *);
+static int get_sort_keys_total_len(struct doc_list *, const struct sort_spec *, size_t *);
+static unsigned char *encode_str_key(unsigned char *, const char *, bool, bool);
+static unsigned char *encode_num_key(unsigned char *, uint64_t, bool);
+static unsigned char *encode_field_key(unsigned char *, const struct doc_list *, const struct sort_key *, bool);
+static size_t save_sort_entries(struct doc_list *, const struct sort_spec *, struct sort_entry *, unsigned char *);
+static int cmp_sort_entries(const struct sort_entry *, const struct sort_entry *);
+static struct sort_entry *merge_sort_entries(struct sort_entry *, struct sort_entry *, size_t);
+static void merge_entries_runs(const struct sort_entry *, struct sort_entry *, size_t, size_t, size_t, size_t);
+static void *sort_chunk_thread(void *);
+static unsigned int get_sort_threads_num(size_t);
+static struct sort_entry *sort_entries_parallel(struct sort_entry *, struct sort_entry *, size_t, unsigned int);
+static bool chunk_comes_first(const struct sort_chunk *, unsigned int, unsigned int);
+static void sift_down_chunks(const struct sort_chunk *, unsigned int *, unsigned int, unsigned int);
+static void merge_chunks(struct sort_chunk *, unsigned int, struct sort_entry *);
+static struct doc_list *link_sorted_entries(const struct sort_entry *, size_t);
+static int cmp_keys(const unsigned char *, size_t, const unsigned char *, size_t);
+static int encode_top_doc_key(struct top_doc *, struct doc_list *, const struct sort_spec *);
+static bool top_doc_is_worse(const struct top_doc *, const struct top_doc *);
+static void sift_up_top_docs(struct top_doc *, unsigned int);
+static void sift_down_top_docs(struct top_doc *, unsigned int);
+
+
+
+/*
+ * Parse a comma separated list of sort keys, e.g. "size,-mtime,name".
+ * A leading '-' sorts by that key in descending order.
+ */
+int parse_sort_spec(struct sort_spec *spec, const char *str)
+{
+	const char *end;
+	size_t len;
+
+	for (spec->keys_num=0; ; str=end+1) {
+		if (!(end = strchr(str, ',')))
+			end = str + strlen(str);
+
+		len = end - str;
+
+		if (spec->keys_num == SORT_KEYS_MAX ||
+		    parse_sort_key(&spec->keys[spec->keys_num++], str, len))
+			return -1;
+
+		if (*end == '\0')
+			break;
+	}
+
+	return 0;
+}
+
+
+static int parse_sort_key(struct sort_key *key, const char *str, size_t len)
+{
+	const char *const names[] = {
+		[SORT_NAME] = "name",
+		[SORT_PATH] = "path",
+		[SORT_SIZE] = "size",
+		[SORT_MTIME] = "mtime"
+	};
+	unsigned int i;
+
+	if ((key->descending = (len && *str == '-'))) {
+		str++;
+		len--;
+	}
+
+	for (i=0; i<sizeof(names)/sizeof(names[0]); i++)
+		if (strlen(names[i]) == len && strncmp(names[i], str, len) == 0) {
+			key->field = i;
+			return 0;
+		}
+
+	return -1;
+}
+
+
+/*
+ * Return 1 if any of the keys needs the documents metadata,
+ * otherwise 0.
+ */
+bool sort_spec_needs_stat(const struct sort_spec *spec)
+{
+	unsigned int i;
+
+	for (i=0; i<spec->keys_num; i++)
+		if (spec->keys[i].field == SORT_SIZE ||
+		    spec->keys[i].field == SORT_MTIME)
+			return 1;
+
+	return 0;
+}
+
+
+/*
+ * Return the length of str's key, or the maximum one for the
+ * natural order keys since their length varies.
+ */
+static size_t get_str_key_len(const char *str, bool natural)
+{
+	const size_t len = strlen(str);
+
+	return natural ? NATURAL_KEY_MAX_LEN(len) : len + 1;
+}
+
+
+static size_t get_field_key_len(const struct doc_list *ptr, enum sort_field field,
+								bool natural)
+{
+	switch (field) {
+	case SORT_NAME:
+		return get_str_key_len(ptr->name, natural);
+	case SORT_PATH:
+		return get_str_key_len(ptr->path, natural);
+	default:
+		return sizeof(uint64_t);
+	}
+}
+
+
+/*
+ * Fetch the metadata the keys need and count the size of the buffer
+ * needed for holding all the encoded keys.
+ */
+static int get_sort_keys_total_len(struct doc_list *ptr,
+								   const struct sort_spec *spec,
+								   size_t *total_len)
+{
+	struct doc_list *doc = NULL;
+
+	/* Timed all at once, a clock read per stat() would cost as much */
+	if (sort_spec_needs_stat(spec)) {
+		stats_enter(STATS_METADATA);
+		for (doc=ptr; doc && get_doc_stat(doc); doc=doc->next)
+			;
+		stats_leave();
+	}
+	if (doc)
+		return -1;
+
+	for (*total_len=0; ptr; ptr=ptr->next)
+		*total_len += get_doc_key_len(ptr, spec);
+
+	return 0;
+}
+
+
+static size_t get_doc_key_len(const struct doc_list *ptr, const struct sort_spec *spec)
+{
+	unsigned int i;
+	size_t len;
+
+	for (len=0, i=0; i<spec->keys_num; i++)
+		len += get_field_key_len(ptr, spec->keys[i].field, spec->natural);
+
+	return len;
+}
+
+
+/*
+ * Encode str's collation key terminated with a null byte. Inverting every
+ * byte, the null byte included, reverses the order of the keys.
+ */
+static unsigned char *encode_str_key(unsigned char *key, const char *str,
+									 bool descending, bool natural)
+{
+	const size_t len = natural ? 
+		natural_collation_key((char *) key, str) + 1 :
+		alpha_collation_key((char *) key, str) + 1;
+	size_t i;
+
+	if (descending)
+		for (i=0; i<len; i++)
+			key[i] = ~key[i];
+
+	return key + len;
+}
+
+
+/*
+ * Encode num in big endian so it compares correctly with memcmp().
+ */
+static unsigned char *encode_num_key(unsigned char *key, uint64_t num,
+									 bool descending)
+{
+	unsigned int i;
+
+	if (descending)
+		num = ~num;
+
+	for (i=0; i<sizeof(num); i++)
+		key[i] = num >> (8 * (sizeof(num) - 1 - i));
+
+	return key + sizeof(num);
+}
+
+
+static unsigned char *encode_field_key(unsigned char *key,
+									   const struct doc_list *ptr,
+									   const struct sort_key *sort_key,
+									   bool natural)
+{
+	switch (sort_key->field) {
+	case SORT_NAME:
+		return encode_str_key(key, ptr->name, sort_key->descending, natural);
+	case SORT_PATH:
+		return encode_str_key(key, ptr->path, sort_key->descending, natural);
+	case SORT_SIZE:
+		return encode_num_key(key, ptr->stbuf->st_size, sort_key->descending);
+	case SORT_MTIME:
+		/* Flipping the sign bit keeps the negative times first */
+		return encode_num_key(key, (uint64_t) ptr->stbuf->st_mtime ^ (UINT64_C(1) << 63),
+							  sort_key->descending);
+	}
+
+	return key;
+}
+
+
+/*
+ * Encode all the spec's keys of the document one after another
+ * and return the end of the encoded key.
+ */
+static unsigned char *encode_doc_key(unsigned char *key,
+									 const struct doc_list *ptr,
+									 const struct sort_spec *spec)
+{
+	unsigned int i;
+
+	for (i=0; i<spec->keys_num; i++)
+		key = encode_field_key(key, ptr, &spec->keys[i], spec->natural);
+
+	return key;
+}
+
+
+/*
+ * Save the list nodes into entries and encode their keys into the keys
+ * buffer. Return the number of the saved entries.
+ */
+static size_t save_sort_entries(struct doc_list *ptr,
+								const struct sort_spec *spec,
+								struct sort_entry *entries,
+								unsigned char *keys)
+{
+	unsigned char *key_end;
+	size_t n;
+
+	for (n=0; ptr; ptr=ptr->next, n++) {
+		key_end = encode_doc_key(keys, ptr, spec);
+
+		entries[n].node = ptr;
+		entries[n].key = keys;
+		entries[n].key_len = key_end - keys;
+		keys = key_end;
+	}
+
+	return n;
+}
+
+
+static int cmp_keys(const unsigned char *a, size_t a_len,
+					const unsigned char *b, size_t b_len)
+{
+	const size_t min_len = (a_len < b_len) ? a_len : b_len;
+	int retval;
+
+	if ((retval = memcmp(a, b, min_len)))
+		return retval;
+
+	return (a_len > b_len) - (a_len < b_len);
+}
+
+
+static int cmp_sort_entries(const struct sort_entry *a, const struct sort_entry *b)
+{
+	return cmp_keys(a->key, a->key_len, b->key, b->key_len);
+}
+
+
+/*
+ * Bottom-up merge sort of entries using buf (of the same size) for
+ * merging. It's stable, so documents with equal keys stay in the
+ * order they were found in. Return the one that ended up sorted.
+ */
+static struct sort_entry *merge_sort_entries(struct sort_entry *entries,
+											 struct sort_entry *buf,
+											 size_t entries_num)
+{
+	struct sort_entry *src = entries;
+	struct sort_entry *dst = buf;
+	struct sort_entry *tmp;
+	size_t width, i;
+
+	for (width=1; width<entries_num; width*=2) {
+		for (i=0; i<entries_num; i+=2*width)
+			merge_entries_runs(src, dst, i, i + width, i + 2*width, entries_num);
+
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	return src;
+}
+
+
+/*
+ * Merge the sorted runs src[begin, mid) and src[mid, end) into dst.
+ */
+static void merge_entries_runs(const struct sort_entry *src,
+							   struct sort_entry *dst,
+							   size_t begin, size_t mid, size_t end,
+							   size_t entries_num)
+{
+	size_t left, right, i;
+
+	if (mid > entries_num)
+		mid = entries_num;
+	if (end > entries_num)
+		end = entries_num;
+
+	for (i=left=begin, right=mid; i<end; i++) {
+		/* Taking from the left run on equality keeps the sort stable */
+		if (left < mid && (right >= end ||
+		    cmp_sort_entries(&src[left], &src[right]) <= 0))
+			dst[i] = src[left++];
+		else
+			dst[i] = src[right++];
+	}
+}
+
+
+static void *sort_chunk_thread(void *arg)
+{
+	struct sort_chunk *chunk = arg;
+	const uint64_t trace_begin = TRACE_BEGIN();
+
+	chunk->sorted = merge_sort_entries(chunk->entries, chunk->buf,
+									   chunk->entries_num);
+	TRACE_END("sort chunk", NULL, trace_begin);
+	/* It's counters are gone when it exits */
+	stats_flush_thread();
+
+	return NULL;
+}
+
+
+static unsigned int get_sort_threads_num(size_t entries_num)
+{
+	long cpus;
+
+	if (entries_num < PARALLEL_SORT_MIN)
+		return 1;
+
+	if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+		return 1;
+
+	return (cpus > SORT_THREADS_MAX) ? SORT_THREADS_MAX : cpus;
+}
+
+
+/*
+ * Sort entries in chunks, one thread per chunk, then do a k-way merge
+ * of the sorted chunks. Return the array holding the sorted entries.
+ */
+static struct sort_entry *sort_entries_parallel(struct sort_entry *entries,
+												struct sort_entry *buf,
+												size_t entries_num,
+												unsigned int threads_num)
+{
+	const size_t chunk_len = (entries_num + threads_num - 1) / threads_num;
+	struct sort_chunk chunks[SORT_THREADS_MAX];
+	pthread_t threads[SORT_THREADS_MAX];
+	bool started[SORT_THREADS_MAX];
+	uint64_t trace_begin;
+	unsigned int i;
+	size_t begin;
+
+	for (i=0, begin=0; i<threads_num; i++, begin+=chunk_len) {
+		chunks[i].entries = &entries[begin];
+		chunks[i].buf = &buf[begin];
+		chunks[i].entries_num = (entries_num - begin < chunk_len) ?
+			entries_num - begin : chunk_len;
+		chunks[i].merged = 0;
+
+		/* If a thread can't be created, sort it's chunk right away */
+		if (!(started[i] = !pthread_create(&threads[i], NULL,
+		                                   sort_chunk_thread, &chunks[i])))
+			sort_chunk_thread(&chunks[i]);
+	}
+	for (i=0; i<threads_num; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+
+	/*
+	 * Depending on it's length a chunk may end up sorted in either entries
+	 * or buf, so move them all to entries before merging them into buf.
+	 */
+	for (i=0; i<threads_num; i++)
+		if (chunks[i].sorted != chunks[i].entries) {
+			memcpy(chunks[i].entries, chunks[i].sorted,
+			       sizeof(struct sort_entry) * chunks[i].entries_num);
+			chunks[i].sorted = chunks[i].entries;
+		}
+
+	trace_begin = TRACE_BEGIN();
+	merge_chunks(chunks, threads_num, buf);
+	TRACE_END("merge", NULL, trace_begin);
+
+	return buf;
+}
+
+
+/*
+ * Return 1 if the next entry of chunk a should be merged before
+ * the next entry of chunk b, otherwise 0.
+ */
+static bool chunk_comes_first(const struct sort_chunk *chunks,
+							  unsigned int a, unsigned int b)
+{
+	const int retval = cmp_sort_entries(&chunks[a].sorted[chunks[a].merged],
+	                                    &chunks[b].sorted[chunks[b].merged]);
+
+	/* Equal keys are taken from the earlier chunk to keep the sort stable */
+	return retval < 0 || (retval == 0 && a < b);
+}
+
+
+static void sift_down_chunks(const struct sort_chunk *chunks,
+							 unsigned int *heap,
+							 unsigned int heap_len,
+							 unsigned int i)
+{
+	unsigned int smallest, child, tmp;
+
+	for (;; i=smallest) {
+		smallest = i;
+
+		for (child=2*i+1; child<=2*i+2 && child<heap_len; child++)
+			if (chunk_comes_first(chunks, heap[child], heap[smallest]))
+				smallest = child;
+
+		if (smallest == i)
+			break;
+
+		tmp = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = tmp;
+	}
+}
+
+
+/*
+ * Merge the sorted chunks into dst using a min-heap of the chunks
+ * ordered by their next entry.
+ */
+static void merge_chunks(struct sort_chunk *chunks, unsigned int chunks_num,
+						 struct sort_entry *dst)
+{
+	unsigned int heap[SORT_THREADS_MAX];
+	unsigned int heap_len = 0;
+	struct sort_chunk *chunk;
+	unsigned int i;
+
+	for (i=0; i<chunks_num; i++)
+		if (chunks[i].entries_num)
+			heap[heap_len++] = i;
+
+	for (i=heap_len/2; i-->0;)
+		sift_down_chunks(chunks, heap, heap_len, i);
+
+	while (heap_len) {
+		chunk = &chunks[heap[0]];
+		*dst++ = chunk->sorted[chunk->merged++];
+
+		if (chunk->merged == chunk->entries_num)
+			heap[0] = heap[--heap_len];
+
+		sift_down_chunks(chunks, heap, heap_len, 0);
+	}
+}
+
+
+static struct doc_list *link_sorted_entries(const struct sort_entry *entries,
+											size_t entries_num)
+{
+	size_t i;
+
+	for (i=0; i<entries_num-1; i++)
+		entries[i].node->next = entries[i+1].node;
+
+	entries[i].node->next = NULL;
+
+	return entries[0].node;
+}
+
+
+/*
+ * Return a pointer to ptr sorted by spec's keys, or NULL on
+ * failure in which case ptr is left in it's original order.
+ */
+struct doc_list *sort_doc_list(struct doc_list *ptr, const struct sort_spec *spec)
+{
+	const size_t entries_num = count_doc_list_nodes(ptr);
+	const uint64_t trace_begin = TRACE_BEGIN();
+	struct doc_list *sorted = NULL;
+	struct sort_entry *entries;
+	struct sort_entry *result;
+	unsigned int threads_num;
+	unsigned char *keys;
+	size_t keys_len;
+
+	if (!entries_num || get_sort_keys_total_len(ptr, spec, &keys_len))
+		goto err_out;
+
+	/* The documents' metadata is fetched in one batch for the keys */
+	TRACE_END(sort_spec_needs_stat(spec) ? "metadata" : "sort keys", NULL, trace_begin);
+
+	/* The second half of entries is the merging buffer */
+	if (!(entries = reallocarray_inf(NULL, entries_num, 2 * sizeof(struct sort_entry))))
+		goto err_out;
+
+	if (!(keys = malloc_site_inf(keys_len, MEM_SITE_KEY)))
+		goto err_free_entries;
+
+	save_sort_entries(ptr, spec, entries, keys);
+
+	if ((threads_num = get_sort_threads_num(entries_num)) > 1)
+		result = sort_entries_parallel(entries, &entries[entries_num],
+		                               entries_num, threads_num);
+	else
+		result = merge_sort_entries(entries, &entries[entries_num], entries_num);
+
+	sorted = link_sorted_entries(result, entries_num);
+	TRACE_END("sort", NULL, trace_begin);
+
+	free_inf(keys);
+err_free_entries:
+	free_inf(entries);
+err_out:
+	if (!sorted)
+		prev_error = 1;
+
+	return sorted;
+}
+
+
+struct top_docs *alloc_top_docs(const struct sort_spec *spec, unsigned int limit)
+{
+	struct top_docs *top;
+
+	if ((top = malloc_inf(sizeof(struct top_docs)))) {
+		if (!(top->heap = reallocarray_inf(NULL, limit, sizeof(struct top_doc)))) {
+			free_inf(top);
+			return NULL;
+		}
+		top->spec = spec;
+		top->len = 0;
+		top->limit = limit;
+		top->seq = 0;
+		top->candidate.key = NULL;
+		top->candidate.key_size = 0;
+	}
+
+	return top;
+}
+
+
+void free_top_docs(struct top_docs *top)
+{
+	unsigned int i;
+
+	for (i=0; i<top->len; i++) {
+		free_doc_list(top->heap[i].node);
+		free_inf(top->heap[i].key);
+	}
+	free_inf(top->candidate.key);
+	free_inf(top->heap);
+	free_inf(top);
+}
+
+
+/*
+ * Encode the document's key into doc's key buffer, growing it if needed.
+ */
+static int encode_top_doc_key(struct top_doc *doc, struct doc_list *node,
+							  const struct sort_spec *spec)
+{
+	unsigned char *key;
+	size_t key_size;
+
+	if (sort_spec_needs_stat(spec) && !get_doc_stat(node))
+		return -1;
+
+	if ((key_size = get_doc_key_len(node, spec)) > doc->key_size) {
+		if (!(key = realloc_site_inf(doc->key, key_size, MEM_SITE_KEY)))
+			return -1;
+
+		doc->key = key;
+		doc->key_size = key_size;
+	}
+	doc->key_len = encode_doc_key(doc->key, node, spec) - doc->key;
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if a comes after b in the sorted order, otherwise 0.
+ */
+static bool top_doc_is_worse(const struct top_doc *a, const struct top_doc *b)
+{
+	const int retval = cmp_keys(a->key, a->key_len, b->key, b->key_len);
+
+	/* Of the documents with equal keys the later found one comes after */
+	return retval > 0 || (retval == 0 && a->seq > b->seq);
+}
+
+
+static void sift_up_top_docs(struct top_doc *heap, unsigned int i)
+{
+	struct top_doc tmp;
+
+	for (; i && top_doc_is_worse(&heap[i], &heap[(i-1)/2]); i=(i-1)/2) {
+		tmp = heap[i];
+		heap[i] = heap[(i-1)/2];
+		heap[(i-1)/2] = tmp;
+	}
+}
+
+
+static void sift_down_top_docs(struct top_doc *heap, unsigned int len)
+{
+	unsigned int i, worst, child;
+	struct top_doc tmp;
+
+	for (i=0; ; i=worst) {
+		worst = i;
+
+		for (child=2*i+1; child<=2*i+2 && child<len; child++)
+			if (top_doc_is_worse(&heap[child], &heap[worst]))
+				worst = child;
+
+		if (worst == i)
+			break;
+
+		tmp = heap[i];
+		heap[i] = heap[worst];
+		heap[worst] = tmp;
+	}
+}
+
+
+/*
+ * Offer the found document to top. If it's kept, top takes the ownership
+ * of it, otherwise it's freed along with the document it replaced. 
+ * Return -1 on failure in which case node is left to the caller.
+ */
+int add_top_doc(struct top_docs *top, struct doc_list *node)
+{
+	struct top_doc *const candidate = &top->candidate;
+	struct top_doc replaced;
+
+	if (encode_top_doc_key(candidate, node, top->spec))
+		return -1;
+
+	candidate->node = node;
+	candidate->seq = top->seq++;
+
+	if (top->len < top->limit) {
+		top->heap[top->len] = *candidate;
+		sift_up_top_docs(top->heap, top->len++);
+		/* The candidate's key buffer now belongs to the heap */
+		candidate->key = NULL;
+		candidate->key_size = 0;
+
+	} else if (top_doc_is_worse(&top->heap[0], candidate)) {
+		replaced = top->heap[0];
+		top->heap[0] = *candidate;
+		sift_down_top_docs(top->heap, top->len);
+		/* Reuse the replaced document's key buffer for the next candidate */
+		candidate->key = replaced.key;
+		candidate->key_size = replaced.key_size;
+		free_doc_list(replaced.node);
+
+	} else {
+		free_doc_list(node);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Return the kept documents as a list sorted by top's spec, which no 
+ * longer belongs to top. Documents with equal keys stay in the order 
+ * they were found in.
+ */
+struct doc_list *get_top_docs_list(struct top_docs *top)
+{
+	struct doc_list *list = NULL;
+
+	/* Popping the worst document each time builds the list from it's end */
+	while (top->len) {
+		top->heap[0].node->next = list;
+		list = top->heap[0].node;
+		free_inf(top->heap[0].key);
+
+		top->heap[0] = top->heap[--top->len];
+		sift_down_top_docs(top->heap, top->len);
+	}
+
+	return list;
+}
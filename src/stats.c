@@ -0,0 +1,212 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for timing    |
+| the run's phases and summing the counters of the      |
+| --stats option.                                       |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "informative.h"
+#include "stats.h"
+#include "memstats.h"
+
+/* The deepest nesting of the phases, e.g. the metadata inside the sort */
+#define STATS_DEPTH_MAX 8
+
+
+struct stats_time {
+	long long wall_ns;
+	long long cpu_ns;
+};
+
+
+_Thread_local unsigned long long stats_counts[STATS_COUNTERS_NUM];
+
+/* The counters of the threads that were flushed */
+static unsigned long long total_counts[STATS_COUNTERS_NUM];
+static pthread_mutex_t total_counts_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * The phases are only timed on the thread that enabled the stats, the
+ * main one, so they're kept without any locking. The other threads'
+ * stats_enter() and stats_leave() do nothing, e.g. a program's threads
+ * that use the library. The time is charged to the innermost phase, so
+ * the phases never overlap.
+ */
+static bool enabled;
+static pthread_t phases_thread;
+static enum stats_phase phases_stack[STATS_DEPTH_MAX];
+static unsigned int phases_depth;
+static struct stats_time phases_times[STATS_PHASES_NUM];
+static struct stats_time start_time;
+static struct stats_time last_time;
+
+static const char *const phases_names[STATS_PHASES_NUM] = {
+	[STATS_CONFIG] = "config",
+	[STATS_SCAN] = "scan",
+	[STATS_METADATA] = "metadata",
+	[STATS_SORT] = "sort",
+	[STATS_OUTPUT] = "output",
+	[STATS_EXEC] = "exec",
+	[STATS_HASH] = "hash"
+};
+
+static const char *const counters_names[STATS_COUNTERS_NUM] = {
+	[STATS_DIRS_OPENED] = "directories opened",
+	[STATS_ENTRIES_READ] = "entries read",
+	[STATS_STATS] = "stats issued",
+	[STATS_MATCHES] = "matches",
+	[STATS_WRITES] = "writes",
+	[STATS_ALLOCS] = "allocations",
+	[STATS_ALLOC_BYTES] = "bytes allocated",
+	[STATS_HASHED_BYTES] = "bytes hashed"
+};
+
+
+/* Static Functions Prototype */
+static long long clock_ns(clockid_t);
+static struct stats_time get_stats_time(void);
+static void charge_phase(void);
+static void print_stats_time(const char *, struct stats_time);
+
+
+
+static long long clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clock, &ts))
+		return 0;
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/*
+ * The CPU time is the whole process', the sort's threads included.
+ */
+static struct stats_time get_stats_time(void)
+{
+	struct stats_time now;
+
+	now.wall_ns = clock_ns(CLOCK_MONOTONIC);
+	now.cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+	return now;
+}
+
+
+void stats_enable(void)
+{
+	enabled = 1;
+	phases_thread = pthread_self();
+	start_time = last_time = get_stats_time();
+}
+
+
+bool stats_enabled(void)
+{
+	return enabled;
+}
+
+
+/*
+ * Charge the time since the last change to the current phase.
+ */
+static void charge_phase(void)
+{
+	const struct stats_time now = get_stats_time();
+	/* Too deep phases are charged to their parent */
+	const unsigned int top = (phases_depth < STATS_DEPTH_MAX) ? 
+		phases_depth : STATS_DEPTH_MAX;
+	struct stats_time *phase;
+
+	if (top) {
+		phase = &phases_times[phases_stack[top-1]];
+		phase->wall_ns += now.wall_ns - last_time.wall_ns;
+		phase->cpu_ns += now.cpu_ns - last_time.cpu_ns;
+	}
+	last_time = now;
+}
+
+
+void stats_enter(enum stats_phase phase)
+{
+	if (!enabled || !pthread_equal(pthread_self(), phases_thread))
+		return;
+
+	charge_phase();
+
+	if (phases_depth < STATS_DEPTH_MAX)
+		phases_stack[phases_depth] = phase;
+	phases_depth++;
+}
+
+
+void stats_leave(void)
+{
+	if (!enabled || !phases_depth || !pthread_equal(pthread_self(), phases_thread))
+		return;
+
+	charge_phase();
+	phases_depth--;
+}
+
+
+void stats_flush_thread(void)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&total_counts_lock);
+
+	for (i=0; i<STATS_COUNTERS_NUM; i++) {
+		total_counts[i] += stats_counts[i];
+		stats_counts[i] = 0;
+	}
+	pthread_mutex_unlock(&total_counts_lock);
+}
+
+
+static void print_stats_time(const char *name, struct stats_time time)
+{
+	fprintf(stderr, "  %-10s %12.3f %12.3f\n", name,
+			time.wall_ns / 1e6, time.cpu_ns / 1e6);
+}
+
+
+/*
+ * Print the phases' times, the counters of all the threads and the
+ * memory accounting on stderr.
+ * Must be called by the main thread after the others exited.
+ */
+void stats_print(void)
+{
+	struct stats_time total;
+	unsigned int i;
+
+	if (!enabled)
+		return;
+
+	charge_phase();
+	stats_flush_thread();
+
+	total.wall_ns = last_time.wall_ns - start_time.wall_ns;
+	total.cpu_ns = last_time.cpu_ns - start_time.cpu_ns;
+
+	fprintf(stderr, "%s: statistics\n", prog_name_inf);
+	fprintf(stderr, "  %-10s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+
+	for (i=0; i<STATS_PHASES_NUM; i++)
+		print_stats_time(phases_names[i], phases_times[i]);
+	print_stats_time("total", total);
+
+	for (i=0; i<STATS_COUNTERS_NUM; i++)
+		fprintf(stderr, "  %-19s %llu\n", counters_names[i], total_counts[i]);
+
+	memstats_print();
+}
@@ -13,6 +13,16 @@
 #include "informative.h"
 #include "strman.h"
 
+/* Any value above 'z' will do, see alpha_collation_key() */
+#define COLLATION_NON_ALPHA 0x7f
+
+/*
+ * The natural_collation_key() prefixes, below any letter so the
+ * other characters come first, then the numbers, then the letters.
+ */
+#define NATURAL_KEY_OTHER 0x01
+#define NATURAL_KEY_NUMBER 0x02
+
 
 /*
  * Make a small letters copy of str.
@@ -107,6 +117,80 @@ bool alpha_cmp(const char *assumed_smaller, const char *word_to_check)
 }
 
 
+/*
+ * Write into key a collation key of str and return it's length. Comparing 
+ * two keys with strcmp() gives the same order alpha_cmp() gives for the 
+ * small letters copies of the strings, so the key can be computed once per 
+ * string and reused on every comparison.
+ */
+size_t alpha_collation_key(char *key, const char *str) 
+{
+	size_t i;
+
+	for (i=0; str[i]!='\0'; i++) {
+		/* alpha_cmp() sees all the non alphabetical characters as 
+		   equal and places them after the alphabetical ones.     */
+		if (isalpha((unsigned char) str[i]))
+			key[i] = tolower((unsigned char) str[i]);
+		else
+			key[i] = COLLATION_NON_ALPHA;
+	}
+	key[i] = '\0';
+
+	return i;
+}
+
+
+/*
+ * Write into key a natural order collation key of str and return it's
+ * length, which is at most NATURAL_KEY_MAX_LEN(strlen(str)). Unlike the
+ * alpha_collation_key() keys, numbers are compared by their values, e.g.
+ * "chapter2" comes before "chapter10", and the other non alphabetical 
+ * characters are compared by their values too. The keys are compared 
+ * with memcmp() and a key that's a prefix of another comes first.
+ */
+size_t natural_collation_key(char *key, const char *str) 
+{
+	const unsigned char *s = (const unsigned char *) str;
+	unsigned char *k = (unsigned char *) key;
+	size_t digits_len;
+
+	while (*s) {
+		if (isdigit(*s)) {
+			/* Skip the leading zeros so only the value counts */
+			while (*s == '0')
+				s++;
+			for (digits_len=0; isdigit(s[digits_len]); digits_len++)
+				;
+			if (digits_len > 0xffff)
+				digits_len = 0xffff;
+			/*
+			 * Prefixing the digits with their number makes
+			 * a longer number compare greater.
+			 */
+			*k++ = NATURAL_KEY_NUMBER;
+			*k++ = digits_len >> 8;
+			*k++ = digits_len & 0xff;
+			memcpy(k, s, digits_len);
+			k += digits_len;
+			s += digits_len;
+			/* Any digits after the first 0xffff start another number */
+		} else if (isalpha(*s)) {
+			*k++ = tolower(*s++);
+		} else if (*s < 0x80) {
+			*k++ = NATURAL_KEY_OTHER;
+			*k++ = *s++;
+		} else {
+			/* Place the non ASCII characters after the letters */
+			*k++ = *s++;
+		}
+	}
+	*k = '\0';
+
+	return k - (unsigned char *) key;
+}
+
+
 unsigned int count_words(const char *line) 
 {
 	unsigned int words;
@@ -160,3 +244,23 @@ char *strcpy_dynamic(const char *src)
 
 	return src_cpy;
 }
+
+
+/*
+ * The 64 bit FNV-1a hash of the len chars of str, of their lower case
+ * if fold_case is set. It's for the hash tables and the file names,
+ * which need it fast rather than unpredictable.
+ */
+uint64_t fnv1a_hash(const char *str, size_t len, bool fold_case)
+{
+	uint64_t hash = 14695981039346656037u;
+	size_t i;
+
+	for (i=0; i<len; i++) {
+		hash ^= fold_case ? (unsigned char) tolower((unsigned char) str[i]) : 
+							(unsigned char) str[i];
+		hash *= 1099511628211u;
+	}
+
+	return hash;
+}
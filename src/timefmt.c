@@ -0,0 +1,198 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for formatting|
+| the documents times without converting every time     |
+| from scratch.                                         |
+---------------------------------------------------------
+*/
+
+#include "informative.h"
+#include "timefmt.h"
+
+#define SECS_PER_DAY 86400
+
+
+/* Static Functions Prototype */
+static bool same_utc_offset(time_t, const struct tm *);
+static int fill_time_cache(struct time_cache *, time_t);
+static char *put_2digits(char *, unsigned int);
+static char *put_int(char *, long);
+static size_t format_time_ctime(const struct tm *, unsigned int, char *);
+static size_t format_time_iso(const struct tm *, unsigned int, char *);
+
+
+
+void init_time_cache(struct time_cache *cache, bool iso)
+{
+	cache->valid = 0;
+	cache->iso = iso;
+}
+
+
+/*
+ * Return 1 if the local time at t has the same UTC offset and day
+ * as tm, otherwise 0.
+ */
+static bool same_utc_offset(time_t t, const struct tm *tm)
+{
+	struct tm other;
+
+	if (!localtime_r(&t, &other))
+		return 0;
+
+	return other.tm_gmtoff == tm->tm_gmtoff && other.tm_mday == tm->tm_mday;
+}
+
+
+/*
+ * Cache the whole local day of t, or only it's second if the UTC offset
+ * changes during that day, e.g. when switching to daylight saving time.
+ */
+static int fill_time_cache(struct time_cache *cache, time_t t)
+{
+	struct tm *const tm = &cache->tm;
+
+	if (!localtime_r_inf(&t, tm))
+		return -1;
+
+	cache->begin = t - (tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec);
+	cache->end = cache->begin + SECS_PER_DAY;
+
+	if (same_utc_offset(cache->begin, tm) && same_utc_offset(cache->end - 1, tm)) {
+		tm->tm_hour = tm->tm_min = tm->tm_sec = 0;
+	} else {
+		cache->begin = t;
+		cache->end = t + 1;
+	}
+	cache->valid = 1;
+
+	return 0;
+}
+
+
+static char *put_2digits(char *buf, unsigned int num)
+{
+	*buf++ = '0' + num / 10 % 10;
+	*buf++ = '0' + num % 10;
+
+	return buf;
+}
+
+
+static char *put_int(char *buf, long num)
+{
+	char digits[20];
+	unsigned int i = sizeof(digits);
+	unsigned long n = (num < 0) ? -(unsigned long) num : (unsigned long) num;
+
+	do {
+		digits[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+
+	if (num < 0)
+		*buf++ = '-';
+
+	for (; i<sizeof(digits); i++)
+		*buf++ = digits[i];
+
+	return buf;
+}
+
+
+/*
+ * The same format as ctime() without it's newline,
+ * e.g. "Wed Jun 30 21:49:08 1993".
+ */
+static size_t format_time_ctime(const struct tm *tm, unsigned int secs, char *buf)
+{
+	static const char wdays[7][3] = {
+		{'S','u','n'}, {'M','o','n'}, {'T','u','e'}, {'W','e','d'},
+		{'T','h','u'}, {'F','r','i'}, {'S','a','t'}
+	};
+	static const char months[12][3] = {
+		{'J','a','n'}, {'F','e','b'}, {'M','a','r'}, {'A','p','r'},
+		{'M','a','y'}, {'J','u','n'}, {'J','u','l'}, {'A','u','g'},
+		{'S','e','p'}, {'O','c','t'}, {'N','o','v'}, {'D','e','c'}
+	};
+	char *p = buf;
+	unsigned int i;
+
+	for (i=0; i<3; i++)
+		*p++ = wdays[tm->tm_wday][i];
+	*p++ = ' ';
+	for (i=0; i<3; i++)
+		*p++ = months[tm->tm_mon][i];
+	*p++ = ' ';
+	/* The day of the month is padded with a space */
+	*p++ = (tm->tm_mday < 10) ? ' ' : '0' + tm->tm_mday / 10;
+	*p++ = '0' + tm->tm_mday % 10;
+	*p++ = ' ';
+	p = put_2digits(p, secs / 3600);
+	*p++ = ':';
+	p = put_2digits(p, secs / 60 % 60);
+	*p++ = ':';
+	p = put_2digits(p, secs % 60);
+	*p++ = ' ';
+	p = put_int(p, tm->tm_year + 1900L);
+	*p = '\0';
+
+	return p - buf;
+}
+
+
+/*
+ * ISO 8601 with the UTC offset, e.g. "1993-06-30T21:49:08+02:00".
+ */
+static size_t format_time_iso(const struct tm *tm, unsigned int secs, char *buf)
+{
+	const unsigned long offset = ((tm->tm_gmtoff < 0) ? 
+		-(unsigned long) tm->tm_gmtoff : (unsigned long) tm->tm_gmtoff) / 60;
+	char *p = buf;
+
+	p = put_int(p, tm->tm_year + 1900L);
+	*p++ = '-';
+	p = put_2digits(p, tm->tm_mon + 1);
+	*p++ = '-';
+	p = put_2digits(p, tm->tm_mday);
+	*p++ = 'T';
+	p = put_2digits(p, secs / 3600);
+	*p++ = ':';
+	p = put_2digits(p, secs / 60 % 60);
+	*p++ = ':';
+	p = put_2digits(p, secs % 60);
+	*p++ = (tm->tm_gmtoff < 0) ? '-' : '+';
+	p = put_2digits(p, offset / 60);
+	*p++ = ':';
+	p = put_2digits(p, offset % 60);
+	*p = '\0';
+
+	return p - buf;
+}
+
+
+/*
+ * Format t as a local time into buf, which must have room for at least
+ * TIME_STR_MAX bytes. Return the length of the formatted time or 0 on
+ * failure.
+ */
+size_t format_time(struct time_cache *cache, time_t t, char *buf)
+{
+	unsigned int secs;
+
+	if (!cache->valid || t < cache->begin || t >= cache->end)
+		if (fill_time_cache(cache, t))
+			return 0;
+
+	/* The seconds since the cached day's (or second's) midnight */
+	secs = (unsigned int) cache->tm.tm_hour * 3600 + 
+		   (unsigned int) cache->tm.tm_min * 60 + 
+		   (unsigned int) cache->tm.tm_sec + (unsigned int) (t - cache->begin);
+
+	if (cache->iso)
+		return format_time_iso(&cache->tm, secs, buf);
+	else
+		return format_time_ctime(&cache->tm, secs, buf);
+}
@@ -0,0 +1,250 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for recording |
+| the spans of the --trace option in per-thread ring    |
+| buffers and writing them as Chrome Trace Event JSON,  |
+| which Perfetto and chrome://tracing can open.         |
+---------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "informative.h"
+#include "trace.h"
+
+/* The events a thread keeps, the older ones are overwritten. A power of 2 */
+#define TRACE_RING_EVENTS 16384
+/* The longer args keep only their end, where a path's names are */
+#define TRACE_ARG_MAX 128
+
+
+struct trace_event {
+	uint64_t begin;
+	uint64_t end;
+	const char *name;
+	char arg[TRACE_ARG_MAX];
+};
+
+struct trace_ring {
+	struct trace_event *events;
+	/* All the recorded events, including the overwritten ones */
+	unsigned long long count;
+	pid_t tid;
+	struct trace_ring *next;
+};
+
+
+bool trace_on = 0;
+
+static FILE *trace_fp;
+static uint64_t trace_start_time;
+
+/* The rings outlive their threads, so they can be written at the end */
+static struct trace_ring *rings;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct trace_ring *thread_ring;
+/* If a thread's ring couldn't be allocated, it's events are dropped */
+static _Thread_local bool thread_ring_failed;
+
+
+/* Static Functions Prototype */
+static struct trace_ring *get_thread_ring(void);
+static void copy_event_arg(char *, const char *);
+static void write_json_str(FILE *, const char *);
+static void write_ring(FILE *, const struct trace_ring *, pid_t, bool *);
+static void free_rings(void);
+
+
+
+uint64_t trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+
+/*
+ * Open the file the trace is written to at the end and start recording.
+ */
+int trace_start(const char *path)
+{
+	if (!(trace_fp = fopen_inf(path, "w")))
+		return -1;
+
+	trace_start_time = trace_now();
+	trace_on = 1;
+
+	return 0;
+}
+
+
+static struct trace_ring *get_thread_ring(void)
+{
+	struct trace_ring *ring;
+
+	if (thread_ring || thread_ring_failed)
+		return thread_ring;
+
+	if (!(ring = malloc_inf(sizeof(struct trace_ring))) ||
+		!(ring->events = malloc_inf(sizeof(struct trace_event) * TRACE_RING_EVENTS))) {
+		free_inf(ring);
+		thread_ring_failed = 1;
+		return NULL;
+	}
+	ring->count = 0;
+	ring->tid = syscall(SYS_gettid);
+
+	pthread_mutex_lock(&rings_lock);
+	ring->next = rings;
+	rings = ring;
+	pthread_mutex_unlock(&rings_lock);
+
+	return thread_ring = ring;
+}
+
+
+static void copy_event_arg(char *dest, const char *arg)
+{
+	size_t len;
+
+	if (!arg) {
+		*dest = '\0';
+		return;
+	}
+	if ((len = strlen(arg)) >= TRACE_ARG_MAX)
+		arg += len - (TRACE_ARG_MAX - 1);
+
+	strcpy(dest, arg);
+}
+
+
+/*
+ * Record the span of name that began at begin and ends now, in the
+ * calling thread's ring. Only the thread itself writes to it's ring.
+ */
+void trace_event(const char *name, const char *arg, uint64_t begin)
+{
+	struct trace_ring *ring;
+	struct trace_event *event;
+
+	if (!(ring = get_thread_ring()))
+		return;
+
+	event = &ring->events[ring->count++ & (TRACE_RING_EVENTS - 1)];
+	event->begin = begin;
+	event->end = trace_now();
+	event->name = name;
+	copy_event_arg(event->arg, arg);
+}
+
+
+static void write_json_str(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(fp, "\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			fprintf(fp, "\\u%04x", *str);
+		else
+			fputc(*str, fp);
+	}
+	fputc('"', fp);
+}
+
+
+/*
+ * Write the ring's events, oldest first, as complete ("X") events
+ * and the thread's name as a metadata event.
+ */
+static void write_ring(FILE *fp, const struct trace_ring *ring, pid_t pid,
+					   bool *first)
+{
+	const unsigned long long kept = (ring->count < TRACE_RING_EVENTS) ?
+		ring->count : TRACE_RING_EVENTS;
+	const struct trace_event *event;
+	unsigned long long i;
+
+	fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+			"\"args\":{\"name\":\"%s\"}}", *first ? "" : ",", (int) pid,
+			(int) ring->tid, ring->tid == pid ? "main" : "worker");
+	*first = 0;
+
+	for (i=ring->count-kept; i<ring->count; i++) {
+		event = &ring->events[i & (TRACE_RING_EVENTS - 1)];
+
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+				"\"pid\":%d,\"tid\":%d", event->name,
+				(event->begin - trace_start_time) / 1e3,
+				(event->end - event->begin) / 1e3, (int) pid, (int) ring->tid);
+
+		if (*event->arg) {
+			fputs(",\"args\":{\"arg\":", fp);
+			write_json_str(fp, event->arg);
+			fputc('}', fp);
+		}
+		fputc('}', fp);
+	}
+}
+
+
+static void free_rings(void)
+{
+	struct trace_ring *next;
+
+	for (; rings; rings=next) {
+		next = rings->next;
+		free_inf(rings->events);
+		free_inf(rings);
+	}
+}
+
+
+/*
+ * Stop recording and write all the threads' rings to the trace file.
+ * Must be called after the other threads exited.
+ */
+int trace_finish(void)
+{
+	unsigned long long dropped = 0;
+	const struct trace_ring *ring;
+	const pid_t pid = getpid();
+	bool first = 1;
+	int retval;
+
+	if (!trace_on)
+		return 0;
+
+	trace_on = 0;
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_fp);
+
+	for (ring=rings; ring; ring=ring->next) {
+		write_ring(trace_fp, ring, pid, &first);
+
+		if (ring->count > TRACE_RING_EVENTS)
+			dropped += ring->count - TRACE_RING_EVENTS;
+	}
+	fprintf(trace_fp, "\n],\"otherData\":{\"dropped_events\":\"%llu\"}}\n", dropped);
+
+	free_rings();
+
+	if ((retval = ferror(trace_fp)))
+		error_inf("can't write the trace");
+
+	if (fclose_inf(trace_fp))
+		retval = -1;
+
+	return retval ? -1 : 0;
+}
@@ -0,0 +1,332 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for building  |
+| the viewers' argv and mapping the documents' extens-  |
+| ions to their viewers.                                |
+---------------------------------------------------------
+*/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "informative.h"
+#include "strman.h"
+#include "viewers.h"
+
+#define VIEWERS_TABLE_MIN_SIZE 16
+
+
+struct viewer_entry {
+	/* Lower case, points into the configurations */
+	const char *ext;
+	unsigned int viewer;
+};
+
+/* An open addressing hash table of the extensions */
+struct viewer_map {
+	struct viewer *viewers;
+	unsigned int viewers_num;
+	struct viewer_entry *table;
+	/* Always a power of 2, so the hash is masked instead of divided */
+	unsigned int table_size;
+	unsigned int entries_num;
+};
+
+
+/* Static Functions Prototype */
+static bool ext_equal(const char *, const char *, size_t);
+static struct viewer_entry *find_entry(struct viewer_entry *, unsigned int,
+									   const char *, size_t);
+static int grow_table(struct viewer_map *);
+static int add_ext(struct viewer_map *, const char *, unsigned int);
+static char *next_word(char **);
+static char *strip_ext(char *);
+static const char *get_ext(const char *, size_t *);
+
+
+
+/*
+ * Build the viewer's argv once for all the documents: the program and
+ * it's arguments, followed by room for a document's path and the NULL.
+ * The arguments are split in place and nothing is copied, so they and
+ * the program must outlive the viewer.
+ */
+int build_viewer(struct viewer *viewer, char *program, char *args)
+{
+	/* The 3 stands for the program, the document's path and the NULL */
+	unsigned int argc = 3;
+	unsigned int ret;
+	char *words;
+
+	if (args)
+		argc += count_words(args);
+
+	if (!(viewer->argv = malloc_inf(sizeof(char *) * argc)))
+		return -1;
+
+	viewer->argc = 0;
+	viewer->argv[viewer->argc++] = program;
+
+	for (words=args; words && (ret = space_to_null(words)); words+=ret)
+		/* In case someone wrote more than one space */
+		if (*words != '\0')
+			viewer->argv[viewer->argc++] = words;
+
+	viewer->argv[viewer->argc] = NULL;
+	viewer->argv[viewer->argc+1] = NULL;
+
+	return 0;
+}
+
+
+void free_viewer(struct viewer *viewer)
+{
+	free_inf(viewer->argv);
+}
+
+
+struct viewer_map *alloc_viewer_map(void)
+{
+	struct viewer_map *map;
+
+	if ((map = malloc_inf(sizeof(struct viewer_map)))) {
+		map->viewers = NULL;
+		map->viewers_num = 0;
+		map->table = NULL;
+		map->table_size = 0;
+		map->entries_num = 0;
+	}
+
+	return map;
+}
+
+
+void free_viewer_map(struct viewer_map *map)
+{
+	unsigned int i;
+
+	for (i=0; i<map->viewers_num; i++)
+		free_viewer(&map->viewers[i]);
+
+	free_inf(map->viewers);
+	free_inf(map->table);
+	free_inf(map);
+}
+
+
+/*
+ * Return 1 if the lower case ext_lower equals the first len
+ * chars of ext, ignoring their case. Otherwise 0.
+ */
+static bool ext_equal(const char *ext_lower, const char *ext, size_t len)
+{
+	size_t i;
+
+	for (i=0; i<len; i++)
+		if (ext_lower[i] != tolower((unsigned char) ext[i]))
+			return 0;
+
+	return ext_lower[len] == '\0';
+}
+
+
+/*
+ * Return the ext's entry or the empty one where it belongs.
+ */
+static struct viewer_entry *find_entry(struct viewer_entry *table,
+									   unsigned int size,
+									   const char *ext, size_t len)
+{
+	const unsigned int mask = size - 1;
+	unsigned int i;
+
+	for (i=fnv1a_hash(ext, len, 1)&mask; table[i].ext; i=(i+1)&mask)
+		if (ext_equal(table[i].ext, ext, len))
+			break;
+
+	return &table[i];
+}
+
+
+/*
+ * Double the table's size, keeping it at most half full.
+ */
+static int grow_table(struct viewer_map *map)
+{
+	const unsigned int new_size = map->table_size ?
+		map->table_size * 2 : VIEWERS_TABLE_MIN_SIZE;
+	struct viewer_entry *new_table;
+	unsigned int i;
+
+	if (!(new_table = calloc_inf(new_size, sizeof(struct viewer_entry))))
+		return -1;
+
+	for (i=0; i<map->table_size; i++)
+		if (map->table[i].ext)
+			*find_entry(new_table, new_size, map->table[i].ext,
+						strlen(map->table[i].ext)) = map->table[i];
+
+	free_inf(map->table);
+	map->table = new_table;
+	map->table_size = new_size;
+
+	return 0;
+}
+
+
+/*
+ * Map the ext to the viewer. A later line overrides an earlier
+ * one with the same extension.
+ */
+static int add_ext(struct viewer_map *map, const char *ext, unsigned int viewer)
+{
+	struct viewer_entry *entry;
+
+	if ((map->entries_num + 1) * 2 > map->table_size)
+		if (grow_table(map))
+			return -1;
+
+	entry = find_entry(map->table, map->table_size, ext, strlen(ext));
+
+	if (!entry->ext)
+		map->entries_num++;
+
+	entry->ext = ext;
+	entry->viewer = viewer;
+
+	return 0;
+}
+
+
+/*
+ * Return the next word in *str, terminated with a null byte, and
+ * advance *str after it. Return NULL if there are no more words.
+ */
+static char *next_word(char **str)
+{
+	char *word = *str;
+
+	while (isspace((unsigned char) *word))
+		word++;
+
+	if (*word == '\0')
+		return NULL;
+
+	for (*str=word; **str && !isspace((unsigned char) **str); (*str)++)
+		;
+	if (**str)
+		*(*str)++ = '\0';
+
+	return word;
+}
+
+
+static char *strip_ext(char *ext)
+{
+	char *end;
+
+	while (isspace((unsigned char) *ext))
+		ext++;
+
+	for (end=ext+strlen(ext); end>ext && isspace((unsigned char) end[-1]); end--)
+		;
+	*end = '\0';
+
+	return ext;
+}
+
+
+/*
+ * Map the comma separated extensions without the dots, e.g. "djvu,ps",
+ * to the viewer of the command, e.g. "zathura --fork". Both are parsed
+ * in place and must outlive the map.
+ */
+int add_viewer(struct viewer_map *map, char *exts, char *command)
+{
+	struct viewer *viewers;
+	char *program;
+	char *ext;
+
+	if (!(program = next_word(&command))) {
+		error_inf("the viewer of '%s' is missing in the configurations", exts);
+		return -1;
+	}
+	if (!(viewers = reallocarray_inf(map->viewers, map->viewers_num + 1,
+									 sizeof(struct viewer))))
+		return -1;
+	map->viewers = viewers;
+
+	if (build_viewer(&map->viewers[map->viewers_num], program, command))
+		return -1;
+
+	map->viewers_num++;
+	convert_to_lower(exts);
+
+	while ((ext = strsep(&exts, ","))) {
+		/* Allow spaces around the commas, e.g. "djvu, ps" */
+		ext = strip_ext(ext);
+
+		if (*ext != '\0' && add_ext(map, ext, map->viewers_num - 1))
+			return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * Parse a line of the form "EXTS PROGRAM [ARGS...]" in place,
+ * e.g. "djvu,ps zathura --fork".
+ */
+int add_viewer_line(struct viewer_map *map, char *line)
+{
+	char *exts;
+
+	if (!(exts = next_word(&line)))
+		return 0;
+
+	return add_viewer(map, exts, line);
+}
+
+
+/*
+ * Return the extension of the path's base name without the dot and set
+ * len to it's length, or NULL if it has none, e.g. ".bashrc".
+ */
+static const char *get_ext(const char *path, size_t *len)
+{
+	const char *name;
+	const char *dot;
+
+	name = (name = strrchr(path, '/')) ? name + 1 : path;
+
+	if (!(dot = strrchr(name, '.')) || dot == name || dot[1] == '\0')
+		return NULL;
+
+	*len = strlen(dot + 1);
+
+	return dot + 1;
+}
+
+
+/*
+ * Return the viewer of the path's extension, ignoring it's case,
+ * or NULL if there's none.
+ */
+const struct viewer *find_viewer(const struct viewer_map *map, const char *path)
+{
+	const struct viewer_entry *entry;
+	const char *ext;
+	size_t len;
+
+	if (!map->entries_num || !(ext = get_ext(path, &len)))
+		return NULL;
+
+	entry = find_entry(map->table, map->table_size, ext, len);
+
+	return entry->ext ? &map->viewers[entry->viewer] : NULL;
+}
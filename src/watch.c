@@ -0,0 +1,794 @@
+/*
+---------------------------------------------------------
+| License: GNU GPL-3.0                                  |
+---------------------------------------------------------
+| This source file contains the functions for watching  |
+| the searched directories with inotify, so the new     |
+| documents are found as soon as they appear instead of |
+| scanning all the directories again.                   |
+---------------------------------------------------------
+*/
+
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "informative.h"
+#include "strman.h"
+#include "config.h"
+#include "mdoc.h"
+#include "stats.h"
+#include "watch.h"
+
+/* The events that can make a document appear or go away */
+#define WATCH_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | \
+					IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/* How often the directories that couldn't be watched are checked */
+#define POLL_INTERVAL_MS 2000
+
+#define PATH_SET_MIN_SIZE 64
+#define WD_DIRS_MIN_SIZE 64
+
+/* Room for many events per read(), none is bigger than this */
+#define EVENTS_BUF_SIZE (64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+
+
+/* A searched directory, watched with inotify or else polled by it's stamp */
+struct watched_dir {
+	/* NULL once it's removed */
+	char *path;
+	const struct docs_root *root;
+	dev_t root_dev;
+	/* It's depth in the root */
+	int depth;
+	/* The inotify watch, or -1 if it's polled */
+	int wd;
+	dev_t dev;
+	ino_t ino;
+	/* It's tv_nsec is -1 if it has to be read again anyway */
+	struct timespec mtime;
+	/* Once it's removed, the index plus 1 of the next removed one, 0 for none */
+	size_t next_free;
+};
+
+struct path_entry {
+	/* NULL if the entry is free */
+	const char *path;
+	size_t value;
+};
+
+/* An open addressing hash table of paths, with linear probing */
+struct path_set {
+	struct path_entry *table;
+	/* Always a power of 2, so the hash is masked instead of divided */
+	size_t size;
+	size_t num;
+};
+
+struct doc_watch {
+	/* The inotify instance, or -1 if every directory is polled */
+	int fd;
+	struct watched_dir *dirs;
+	size_t dirs_num;
+	size_t dirs_size;
+	/* The index plus 1 of the last removed directory, reused first, 0 for none */
+	size_t free_dirs;
+	size_t polled_num;
+	/* The directories' indexes by their paths, which are the directories' own */
+	struct path_set dirs_set;
+	/* The directories' indexes plus 1 by their watches, 0 for none */
+	size_t *wd_dirs;
+	size_t wd_size;
+	/* The documents passed on so far, their paths are the set's own */
+	struct path_set docs_set;
+};
+
+
+/* Static Functions Prototype */
+static struct path_entry *find_path_entry(const struct path_set *, const char *);
+static int grow_path_set(struct path_set *);
+static int add_path(struct path_set *, const char *, size_t);
+static const char *remove_path(struct path_set *, const char *);
+static int grow_dirs(struct doc_watch *);
+static int grow_wd_dirs(struct doc_watch *, int);
+static void set_dir_mtime(struct watched_dir *, const struct timespec *);
+static void remove_dir(struct doc_watch *, size_t);
+static void forget_docs_tree(struct doc_watch *, const char *);
+static void remove_dir_tree(struct doc_watch *, const char *);
+static int skip_vanished(void);
+static int search_new_entry(struct search_ctx *, const struct watched_dir *, const char *);
+static bool known_dir(const struct doc_watch *, const char *, const char *, int *);
+static bool linked_entry(const char *, const char *);
+static int forget_entry(struct doc_watch *, const char *, const char *, bool);
+static int rescan_dir(struct doc_watch *, struct search_ctx *, size_t);
+static int rescan_dirs(struct doc_watch *, struct search_ctx *);
+static int check_polled_dirs(struct doc_watch *, struct search_ctx *);
+static int handle_event(struct doc_watch *, struct search_ctx *, const struct inotify_event *);
+static int read_events(struct doc_watch *, struct search_ctx *, char *, size_t);
+static long long get_time_ms(void);
+
+
+
+/*
+ * Return the entry of the path, or the free entry it'd be added to.
+ */
+static struct path_entry *find_path_entry(const struct path_set *set, const char *path)
+{
+	const size_t mask = set->size - 1;
+	size_t i;
+
+	for (i=fnv1a_hash(path, strlen(path), 0) & mask; set->table[i].path; i=(i + 1) & mask)
+		if (strcmp(set->table[i].path, path) == 0)
+			break;
+
+	return &set->table[i];
+}
+
+
+static int grow_path_set(struct path_set *set)
+{
+	struct path_set grown = {.size = 2 * set->size, .num = set->num};
+	size_t i;
+
+	if (!(grown.table = calloc_inf(grown.size, sizeof(struct path_entry))))
+		return -1;
+
+	for (i=0; i<set->size; i++)
+		if (set->table[i].path)
+			*find_path_entry(&grown, set->table[i].path) = set->table[i];
+
+	free_inf(set->table);
+	*set = grown;
+
+	return 0;
+}
+
+
+/*
+ * Add the path, which isn't in the set yet, with it's value. The
+ * path isn't copied, so it must outlive it's entry.
+ */
+static int add_path(struct path_set *set, const char *path, size_t value)
+{
+	struct path_entry *entry;
+
+	/* Kept at most half full, so the probes stay short */
+	if (2 * (set->num + 1) > set->size && grow_path_set(set))
+		return -1;
+
+	entry = find_path_entry(set, path);
+	entry->path = path;
+	entry->value = value;
+	set->num++;
+
+	return 0;
+}
+
+
+/*
+ * Remove the path and return the set's pointer to it, or NULL if it
+ * wasn't in the set. The entries after it are moved back into the
+ * hole when it's on their probe, so no probe is cut short.
+ */
+static const char *remove_path(struct path_set *set, const char *path)
+{
+	const size_t mask = set->size - 1;
+	struct path_entry *entry = find_path_entry(set, path);
+	const char *removed = entry->path;
+	size_t hole;
+	size_t home;
+	size_t i;
+
+	if (!removed)
+		return NULL;
+
+	hole = entry - set->table;
+
+	for (i=(hole + 1) & mask; set->table[i].path; i=(i + 1) & mask) {
+		home = fnv1a_hash(set->table[i].path, strlen(set->table[i].path), 0) & mask;
+
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			set->table[hole] = set->table[i];
+			hole = i;
+		}
+	}
+	set->table[hole].path = NULL;
+	set->num--;
+
+	return removed;
+}
+
+
+struct doc_watch *alloc_doc_watch(void)
+{
+	struct doc_watch *watch;
+
+	if (!(watch = calloc_inf(1, sizeof(struct doc_watch))))
+		return NULL;
+
+	watch->fd = -1;
+	watch->dirs_set.size = PATH_SET_MIN_SIZE;
+	watch->docs_set.size = PATH_SET_MIN_SIZE;
+
+	if (!(watch->dirs_set.table = calloc_inf(PATH_SET_MIN_SIZE, sizeof(struct path_entry))) ||
+		!(watch->docs_set.table = calloc_inf(PATH_SET_MIN_SIZE, sizeof(struct path_entry)))) {
+		free_doc_watch(watch);
+		return NULL;
+	}
+
+	/* Without an inotify instance, e.g. over the user's limit, every directory is polled */
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	return watch;
+}
+
+
+void free_doc_watch(struct doc_watch *watch)
+{
+	size_t i;
+
+	if (!watch)
+		return;
+
+	for (i=0; i<watch->dirs_num; i++)
+		free_inf(watch->dirs[i].path);
+	free_inf(watch->dirs);
+
+	for (i=0; watch->docs_set.table && i<watch->docs_set.size; i++)
+		free_inf((char *) watch->docs_set.table[i].path);
+
+	free_inf(watch->docs_set.table);
+	free_inf(watch->dirs_set.table);
+	free_inf(watch->wd_dirs);
+
+	if (watch->fd != -1)
+		close(watch->fd);
+
+	free_inf(watch);
+}
+
+
+static int grow_dirs(struct doc_watch *watch)
+{
+	struct watched_dir *dirs;
+	size_t size;
+
+	if (watch->dirs_num < watch->dirs_size)
+		return 0;
+
+	size = watch->dirs_size ? 2 * watch->dirs_size : PATH_SET_MIN_SIZE;
+	if (!(dirs = reallocarray_inf(watch->dirs, size, sizeof(struct watched_dir))))
+		return -1;
+
+	watch->dirs = dirs;
+	watch->dirs_size = size;
+
+	return 0;
+}
+
+
+static int grow_wd_dirs(struct doc_watch *watch, int wd)
+{
+	size_t *wd_dirs;
+	size_t size;
+
+	if ((size_t) wd < watch->wd_size)
+		return 0;
+
+	for (size=watch->wd_size ? watch->wd_size : WD_DIRS_MIN_SIZE; size<=(size_t) wd; size*=2)
+		;
+	if (!(wd_dirs = reallocarray_inf(watch->wd_dirs, size, sizeof(size_t))))
+		return -1;
+
+	memset(&wd_dirs[watch->wd_size], 0, (size - watch->wd_size) * sizeof(size_t));
+	watch->wd_dirs = wd_dirs;
+	watch->wd_size = size;
+
+	return 0;
+}
+
+
+/*
+ * A change in the same tick of the clock as the read doesn't change the
+ * mtime, so a directory changed that recently is read again next time.
+ */
+static void set_dir_mtime(struct watched_dir *dir, const struct timespec *mtime)
+{
+	dir->mtime = *mtime;
+
+	if (mtime->tv_sec >= time(NULL) - 1)
+		dir->mtime.tv_nsec = -1;
+}
+
+
+/*
+ * Watch the directory at path, open at fd, before it's read, so none of
+ * the documents added while it's read is missed. It's the dir_fn of the
+ * watched searches, their dir_arg is the doc_watch. A directory that
+ * can't be watched, e.g. when the user is out of inotify watches, is
+ * polled by it's stamp instead.
+ */
+int watch_dir(const struct search_ctx *search, const char *path, int fd, int depth)
+{
+	struct doc_watch *watch = search->dir_arg;
+	const struct path_entry *entry;
+	struct watched_dir *dir;
+	struct stat stbuf;
+	const size_t len = strlen(path) + 1;
+	size_t next_free;
+	char *path_cp;
+	int wd = -1;
+	size_t i;
+
+	if (fstat_inf(fd, &stbuf))
+		return -1;
+
+	/* e.g. when a polled directory is read again, unless it was replaced since */
+	if ((entry = find_path_entry(&watch->dirs_set, path))->path) {
+		dir = &watch->dirs[entry->value];
+		if (dir->dev == stbuf.st_dev && dir->ino == stbuf.st_ino)
+			return 0;
+
+		remove_dir_tree(watch, path);
+	}
+
+	/* The slot of a removed directory is reused, so the array only grows with the tree */
+	if (watch->free_dirs) {
+		i = watch->free_dirs - 1;
+		next_free = watch->dirs[i].next_free;
+	} else if (grow_dirs(watch)) {
+		return -1;
+	} else {
+		i = watch->dirs_num;
+		next_free = 0;
+	}
+
+	if (!(path_cp = malloc_site_inf(sizeof(char) * len, MEM_SITE_PATH)))
+		return -1;
+	memcpy(path_cp, path, len);
+
+	if (watch->fd != -1)
+		wd = inotify_add_watch(watch->fd, path, WATCH_MASK);
+
+	if ((wd != -1 && grow_wd_dirs(watch, wd)) ||
+		add_path(&watch->dirs_set, path_cp, i)) {
+		/* Unless another path of the directory has the same watch */
+		if (wd != -1 && ((size_t) wd >= watch->wd_size || !watch->wd_dirs[wd]))
+			inotify_rm_watch(watch->fd, wd);
+		free_inf(path_cp);
+		return -1;
+	}
+
+	dir = &watch->dirs[i];
+	dir->path = path_cp;
+	dir->root = search->root;
+	dir->root_dev = search->root_dev;
+	dir->depth = depth;
+	dir->wd = wd;
+	dir->dev = stbuf.st_dev;
+	dir->ino = stbuf.st_ino;
+	set_dir_mtime(dir, &stbuf.st_mtim);
+	dir->next_free = 0;
+
+	if (wd == -1)
+		watch->polled_num++;
+	else if (!watch->wd_dirs[wd])
+		watch->wd_dirs[wd] = i + 1;
+
+	if (i == watch->dirs_num)
+		watch->dirs_num++;
+	else
+		watch->free_dirs = next_free;
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the document at path wasn't passed on yet and mark it
+ * as passed, 0 if it was, or -1 on failure.
+ */
+int watch_new_doc(struct doc_watch *watch, const char *path)
+{
+	const size_t len = strlen(path) + 1;
+	char *path_cp;
+
+	if (find_path_entry(&watch->docs_set, path)->path)
+		return 0;
+
+	if (!(path_cp = malloc_site_inf(sizeof(char) * len, MEM_SITE_PATH)))
+		return -1;
+	memcpy(path_cp, path, len);
+
+	if (add_path(&watch->docs_set, path_cp, 0)) {
+		free_inf(path_cp);
+		return -1;
+	}
+
+	return 1;
+}
+
+
+static void remove_dir(struct doc_watch *watch, size_t i)
+{
+	struct watched_dir *dir = &watch->dirs[i];
+
+	if (dir->wd == -1) {
+		watch->polled_num--;
+	} else if (watch->wd_dirs[dir->wd] == i + 1) {
+		watch->wd_dirs[dir->wd] = 0;
+		/* It fails harmlessly if the watch is already gone */
+		inotify_rm_watch(watch->fd, dir->wd);
+	}
+	remove_path(&watch->dirs_set, dir->path);
+
+	free_inf(dir->path);
+	dir->path = NULL;
+
+	dir->next_free = watch->free_dirs;
+	watch->free_dirs = i + 1;
+}
+
+
+/*
+ * Forget the passed documents under the directory at path, so they're
+ * passed on again if they come back.
+ */
+static void forget_docs_tree(struct doc_watch *watch, const char *path)
+{
+	struct path_set *set = &watch->docs_set;
+	const size_t len = strlen(path);
+	const char *doc_path;
+	size_t i;
+
+	/* A removal moves a later entry into the hole, which is checked again */
+	for (i=0; i<set->size; i++)
+		while ((doc_path = set->table[i].path) && strncmp(doc_path, path, len) == 0 &&
+			   doc_path[len] == '/')
+			free_inf((char *) remove_path(set, doc_path));
+}
+
+
+/*
+ * Remove the directory at path with all of it's sub directories and
+ * forget their documents, e.g. once it was moved and their paths are
+ * wrong. The path may be the directory's own, so it's removed last.
+ */
+static void remove_dir_tree(struct doc_watch *watch, const char *path)
+{
+	const size_t len = strlen(path);
+	struct path_entry *entry;
+	size_t i;
+
+	forget_docs_tree(watch, path);
+
+	for (i=0; i<watch->dirs_num; i++)
+		if (watch->dirs[i].path && strncmp(watch->dirs[i].path, path, len) == 0 &&
+			watch->dirs[i].path[len] == '/')
+			remove_dir(watch, i);
+
+	if ((entry = find_path_entry(&watch->dirs_set, path))->path)
+		remove_dir(watch, entry->value);
+}
+
+
+/*
+ * After a failed search of a new entry, return 0 if it only missed what
+ * was removed or made unreadable since, which doesn't fail the watch,
+ * otherwise -1.
+ */
+static int skip_vanished(void)
+{
+	const int err = get_last_errno_inf();
+
+	if (!*get_last_error_inf() || (err != ENOENT && err != ENOTDIR && err != EACCES))
+		return -1;
+
+	prev_error = 0;
+	clear_error_inf();
+
+	return 0;
+}
+
+
+/*
+ * Search the new entry of the directory, by the directory's root. The
+ * documents are passed to search->stream, the directories are watched.
+ */
+static int search_new_entry(struct search_ctx *search, const struct watched_dir *dir,
+							const char *name)
+{
+	search->root = dir->root;
+	search->root_dev = dir->root_dev;
+
+	if (search_dir_entry(search, dir->path, name, dir->depth))
+		return skip_vanished();
+
+	return 0;
+}
+
+
+/*
+ * Return 1 if the entry of the directory at dir_path is a known directory,
+ * otherwise 0. On failure *failed is set to -1.
+ */
+static bool known_dir(const struct doc_watch *watch, const char *dir_path,
+					  const char *name, int *failed)
+{
+	bool known;
+	char *path;
+
+	if (!(path = get_entry_path(dir_path, name))) {
+		*failed = -1;
+		return 0;
+	}
+	known = find_path_entry(&watch->dirs_set, path)->path;
+	free_inf(path);
+
+	return known;
+}
+
+
+/*
+ * Return 1 if the just created entry of the directory at dir_path is a
+ * link to an existing file, which is never written. The other files are
+ * searched for once they're written and closed.
+ */
+static bool linked_entry(const char *dir_path, const char *name)
+{
+	struct stat stbuf;
+	bool linked = 0;
+	char *path;
+
+	if ((path = get_entry_path(dir_path, name))) {
+		STATS_COUNT(STATS_STATS, 1);
+
+		if (!lstat(path, &stbuf))
+			linked = !S_ISREG(stbuf.st_mode) || stbuf.st_nlink > 1;
+		free_inf(path);
+	}
+
+	return linked;
+}
+
+
+/*
+ * Forget the removed entry of the directory at dir_path, so it's passed
+ * on again if it comes back.
+ */
+static int forget_entry(struct doc_watch *watch, const char *dir_path,
+						const char *name, bool is_dir)
+{
+	char *path;
+
+	if (!(path = get_entry_path(dir_path, name)))
+		return -1;
+
+	if (is_dir)
+		remove_dir_tree(watch, path);
+	else
+		free_inf((char *) remove_path(&watch->docs_set, path));
+
+	free_inf(path);
+
+	return 0;
+}
+
+
+/*
+ * Read the i'th directory again and search it's unknown entries, e.g.
+ * after it changed while it wasn't watched.
+ */
+static int rescan_dir(struct doc_watch *watch, struct search_ctx *search, size_t i)
+{
+	const struct watched_dir dir = watch->dirs[i];
+	struct dirent *entry;
+	int retval = 0;
+	DIR *dp;
+
+	STATS_COUNT(STATS_DIRS_OPENED, 1);
+
+	/* If it's gone, it's removal is left to it's own check or event */
+	if (!(dp = opendir(dir.path)))
+		return 0;
+
+	while (!retval && (entry = readdir(dp))) {
+		STATS_COUNT(STATS_ENTRIES_READ, 1);
+
+		/* The known sub directories are watched on their own */
+		if (entry->d_type != DT_REG && known_dir(watch, dir.path, entry->d_name, &retval))
+			continue;
+
+		if (!retval)
+			retval = search_new_entry(search, &dir, entry->d_name);
+	}
+	closedir(dp);
+
+	return retval;
+}
+
+
+/*
+ * Read every directory again, e.g. after their events were lost.
+ */
+static int rescan_dirs(struct doc_watch *watch, struct search_ctx *search)
+{
+	/* The directories found meanwhile were just read */
+	const size_t dirs_num = watch->dirs_num;
+	size_t i;
+
+	for (i=0; i<dirs_num; i++)
+		if (watch->dirs[i].path && rescan_dir(watch, search, i))
+			return -1;
+
+	return 0;
+}
+
+
+/*
+ * Read the polled directories that changed since they were read. The
+ * removed and replaced ones are removed first, so the new ones are
+ * found by their parents, which changed as well.
+ */
+static int check_polled_dirs(struct doc_watch *watch, struct search_ctx *search)
+{
+	const size_t dirs_num = watch->dirs_num;
+	struct watched_dir *dir;
+	struct stat stbuf;
+	size_t i;
+
+	for (i=0; i<dirs_num; i++) {
+		dir = &watch->dirs[i];
+		if (!dir->path || dir->wd != -1)
+			continue;
+
+		STATS_COUNT(STATS_STATS, 1);
+
+		if (stat(dir->path, &stbuf) || stbuf.st_dev != dir->dev || stbuf.st_ino != dir->ino)
+			remove_dir_tree(watch, dir->path);
+	}
+
+	for (i=0; i<dirs_num; i++) {
+		dir = &watch->dirs[i];
+		if (!dir->path || dir->wd != -1)
+			continue;
+
+		STATS_COUNT(STATS_STATS, 1);
+
+		if (stat(dir->path, &stbuf) || (stbuf.st_mtim.tv_sec == dir->mtime.tv_sec &&
+										stbuf.st_mtim.tv_nsec == dir->mtime.tv_nsec))
+			continue;
+
+		/* Before it's read, so the changes while it's read aren't missed */
+		set_dir_mtime(dir, &stbuf.st_mtim);
+
+		if (rescan_dir(watch, search, i))
+			return -1;
+	}
+
+	return 0;
+}
+
+
+static int handle_event(struct doc_watch *watch, struct search_ctx *search,
+						const struct inotify_event *event)
+{
+	struct watched_dir dir;
+	size_t i;
+
+	if (event->mask & IN_Q_OVERFLOW)
+		return rescan_dirs(watch, search);
+
+	if (event->wd < 0 || (size_t) event->wd >= watch->wd_size ||
+		!(i = watch->wd_dirs[event->wd]))
+		return 0;
+
+	/* A copy, the directories may move while the entry is searched */
+	dir = watch->dirs[--i];
+
+	if (event->mask & IN_IGNORED) {
+		remove_dir(watch, i);
+		return 0;
+	}
+
+	/* It's path is wrong once it moved, it's found again by the new parent's event */
+	if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+		remove_dir_tree(watch, dir.path);
+		return 0;
+	}
+
+	if (!event->len)
+		return 0;
+
+	if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+		return forget_entry(watch, dir.path, event->name, event->mask & IN_ISDIR);
+
+	if ((event->mask & IN_CREATE) && !(event->mask & IN_ISDIR) &&
+		!linked_entry(dir.path, event->name))
+		return 0;
+
+	return search_new_entry(search, &dir, event->name);
+}
+
+
+static int read_events(struct doc_watch *watch, struct search_ctx *search,
+					   char *buf, size_t size)
+{
+	const struct inotify_event *event;
+	ssize_t len;
+	char *ptr;
+
+	while ((len = read(watch->fd, buf, size)) > 0)
+		for (ptr=buf; ptr<buf + len; ptr+=sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *) ptr;
+
+			if (handle_event(watch, search, event))
+				return -1;
+		}
+
+	if (len == -1 && errno != EAGAIN && errno != EINTR) {
+		error_inf("can't read the directories' events: %s", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static long long get_time_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+
+/*
+ * Pass every new document of the watched directories to search->stream
+ * as soon as it appears, until it or the watch fails. The stream is also
+ * passed NULL before waiting for the events, e.g. to flush what it got.
+ */
+int run_doc_watch(struct doc_watch *watch, struct search_ctx *search)
+{
+	char buf[EVENTS_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd = {.fd = watch->fd, .events = POLLIN, .revents = 0};
+	long long next_check = get_time_ms() + POLL_INTERVAL_MS;
+	long long timeout;
+	int ready;
+
+	for (;;) {
+		if (search->stream(NULL, search->stream_arg))
+			return -1;
+
+		timeout = -1;
+		if (watch->polled_num && (timeout = next_check - get_time_ms()) < 0)
+			timeout = 0;
+
+		if ((ready = poll(&pfd, watch->fd != -1, (int) timeout)) == -1) {
+			if (errno == EINTR)
+				continue;
+
+			error_inf("can't wait for the directories' events: %s", strerror(errno));
+			return -1;
+		}
+
+		if (ready && read_events(watch, search, buf, sizeof(buf)))
+			return -1;
+
+		if (watch->polled_num && get_time_ms() >= next_check) {
+			if (check_polled_dirs(watch, search))
+				return -1;
+			next_check = get_time_ms() + POLL_INTERVAL_MS;
+		}
+	}
+}